@@ -18,6 +18,7 @@ void ofApp::setup()
     sphere.rotate(180, 0, 0, 1);
     
     b_draw_equi = false;
+    b_cull_tiles = true;
 
 	ofSetVerticalSync(true);
 }
@@ -25,6 +26,25 @@ void ofApp::setup()
 //--------------------------------------------------------------
 void ofApp::update()
 {
+    // tiled files: only read + decode the part of the sphere that is in view (and the tiles around it)
+    if (hpvPlayer.isTiled())
+    {
+        if (b_draw_equi || !b_cull_tiles)
+        {
+            hpvPlayer.setVisibleTiles(~uint64_t(0));
+        }
+        else
+        {
+            ofVec3f dir = cam.getLookAtDir();
+            float yaw = ofRadToDeg(atan2(dir.x, -dir.z));
+            float pitch = ofRadToDeg(asin(ofClamp(dir.y, -1.f, 1.f)));
+            float v_fov = cam.getFov();
+            float h_fov = ofRadToDeg(2.f * atan(tan(ofDegToRad(v_fov) / 2.f) * ofGetWidth() / ofGetHeight()));
+            
+            hpvPlayer.setViewDirection(yaw, pitch, h_fov, v_fov);
+        }
+    }
+    
     HPV::Update();
 }
 
@@ -46,14 +66,15 @@ void ofApp::draw()
         cam.end();
     }
 
+	HPVDecodeStats stats = hpvPlayer.getDecodeStats();
 	std::stringstream ss;
-	ss  << "HDD: " << hpvPlayer.getDecodeStatsPtr()->hdd_read_time / 1e6 << "ms"
+	ss  << "HDD: " << stats.hdd_read_time / 1e6 << "ms"
 		<< std::endl
-		<< "L4Z: " << hpvPlayer.getDecodeStatsPtr()->l4z_decode_time / 1e6 << "ms"
+		<< "L4Z: " << stats.l4z_decode_time / 1e6 << "ms"
 		<< std::endl
-		<< "GPU: " << hpvPlayer.getDecodeStatsPtr()->gpu_upload_time / 1e6 << "ms"
+		<< "GPU: " << stats.gpu_upload_time / 1e6 << "ms"
 		<< std::endl
-		<< "TOT: " << (hpvPlayer.getDecodeStatsPtr()->hdd_read_time + hpvPlayer.getDecodeStatsPtr()->l4z_decode_time + hpvPlayer.getDecodeStatsPtr()->gpu_upload_time) / 1e6
+		<< "TOT: " << (stats.hdd_read_time + stats.l4z_decode_time + stats.gpu_upload_time) / 1e6
 		<< std::endl
 		<< "FRAME: " << hpvPlayer.getCurrentFrame()
 		<< std::endl
@@ -61,11 +82,13 @@ void ofApp::draw()
 		<< std::endl
 		<< "DURATION: " << hpvPlayer.getDuration()
 		<< std::endl
-		<< "DONE: " << hpvPlayer.getIsMovieDone();
+		<< "DONE: " << hpvPlayer.getIsMovieDone()
+		<< std::endl
+		<< "TILES: " << (!hpvPlayer.isTiled() ? "not tiled" : (b_cull_tiles ? "visible only" : "all"));
 
 	ofDrawBitmapString(ss.str(), 50, 100);
     
-    ofDrawBitmapStringHighlight("Press 'e' to toggle between EQUIRECTANGULAR and PERSPECTIVE view", 50, 50);
+    ofDrawBitmapStringHighlight("Press 'e' to toggle between EQUIRECTANGULAR and PERSPECTIVE view, 't' to toggle decoding only the visible tiles", 50, 50);
 }
 
 //--------------------------------------------------------------
@@ -85,4 +108,8 @@ void ofApp::keyReleased(int key)
     {
         b_draw_equi = !b_draw_equi;
     }
+    else if (key == 't')
+    {
+        b_cull_tiles = !b_cull_tiles;
+    }
 }
\ No newline at end of file
@@ -18,4 +18,5 @@ public:
     ofEasyCam cam;
     
     bool b_draw_equi;
+    bool b_cull_tiles;
 };
@@ -0,0 +1,367 @@
+#include "BenchChecks.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "HPVFrameScheduler.h"
+#include "HPVManager.h"
+#include "Timer.h"
+
+#define CHECK_FRAME_RATE            60
+#define CHECK_SCHEDULER_HOURS       1
+#define CHECK_FREE_RUNNING_FPS      100000
+#define CHECK_ALLOCATION_FRAMES     3000        /* frames played with every read mode */
+#define CHECK_ALLOCATION_SEEKS      300         /* random seeks after that */
+#define CHECK_ALLOCATION_CACHE      32          /* frames in the frame cache meanwhile, fewer than the file has */
+#define CHECK_TIMEOUT_S             60
+#define CHECK_TEARING_FPS           500         /* fast enough that frames change while they are copied */
+#define CHECK_CHECKSUM_STRIDE       64          /* one byte per cache line */
+
+static const char * CHECK_READ_MODE_NAMES[] = { "stream", "mmap", "async", "direct" };
+
+/* FNV-1a over every CHECK_CHECKSUM_STRIDE'th byte */
+static uint64_t Checksum(const unsigned char * data, std::size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (std::size_t i = 0; i < size; i += CHECK_CHECKSUM_STRIDE)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/*
+ *  Every operator new of the program is counted, whatever thread it runs on, so the allocations check sees
+ *  the standard containers and std::function copies of the library as well, not just its own buffers
+ */
+static std::atomic<uint64_t> g_num_allocations(0);
+
+void * operator new(std::size_t size)
+{
+    g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void * ptr = malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void * operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void * ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void * ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void * ptr, const std::nothrow_t&) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void * ptr, const std::nothrow_t&) noexcept
+{
+    free(ptr);
+}
+
+/* Prints the failed condition and marks the check as failed, without stopping it */
+#define CHECK(condition) \
+    do { if (!(condition)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); ok = false; } } while (0)
+
+//--------------------------------------------------------------
+bool CheckScheduler()
+{
+    bool ok = true;
+    const double time_per_frame = 1e9 / CHECK_FRAME_RATE;
+
+    // every frame shown exactly when it is due: after an hour the due time is still within 1 ns of the exact one
+    {
+        HPV::HPVFrameScheduler scheduler;
+        uint64_t start = 1000000000ULL;
+        int64_t num_ticks = static_cast<int64_t>(CHECK_SCHEDULER_HOURS) * 3600 * CHECK_FRAME_RATE;
+
+        scheduler.start(start, time_per_frame);
+
+        uint64_t next = start;
+        for (int64_t tick = 0; tick < num_ticks; ++tick)
+        {
+            next = scheduler.present(tick, next);
+        }
+
+        CHECK(std::abs(static_cast<double>(next) - (start + num_ticks * time_per_frame)) <= 1.0);
+        CHECK(0 == scheduler.getNumLateFrames());
+        CHECK(0 == scheduler.getNumDroppedFrames());
+        CHECK(0 == scheduler.getNumRepeatedFrames());
+    }
+
+    // a stall of 5 slots, catching up by showing every frame, then skipping 2 frames
+    {
+        HPV::HPVFrameScheduler scheduler;
+        scheduler.start(0, time_per_frame);
+
+        uint64_t next = scheduler.present(0, 0);
+        next = scheduler.present(1, next + 10);
+
+        // tick 2 is only shown in the slot of tick 7: it is late, and slots 2 to 6 repeated frame 1
+        uint64_t stall = scheduler.getTickTime(7) + 100;
+        scheduler.present(2, stall);
+        CHECK(1 == scheduler.getNumLateFrames());
+        CHECK(5 == scheduler.getNumRepeatedFrames());
+
+        // 3 to 6 are late as well, 7 is on time again
+        for (int64_t tick = 3; tick <= 7; ++tick)
+        {
+            next = scheduler.present(tick, stall + 1000 * tick);
+        }
+
+        CHECK(5 == scheduler.getNumLateFrames());
+        CHECK(scheduler.getTickTime(8) == next);
+        CHECK(0 == scheduler.getNumDroppedFrames());
+
+        // going from 7 straight to 10 drops 8 and 9, and their slots count as repeated
+        scheduler.present(10, scheduler.getTickTime(10));
+        CHECK(2 == scheduler.getNumDroppedFrames());
+        CHECK(7 == scheduler.getNumRepeatedFrames());
+        CHECK(5 == scheduler.getNumLateFrames());
+
+        scheduler.resetCounters();
+        CHECK(0 == scheduler.getNumLateFrames() + scheduler.getNumDroppedFrames() + scheduler.getNumRepeatedFrames());
+    }
+
+    // a speed change halfway through a frame keeps the part of the frame that already ran
+    {
+        HPV::HPVFrameScheduler scheduler;
+        scheduler.start(0, 1000);
+
+        CHECK(1000 == scheduler.present(0, 0));
+
+        // half of tick 0 is left, which takes 1000 ns at half the speed
+        scheduler.setTimePerFrame(500, 2000);
+        CHECK(1500 == scheduler.getTickTime(1));
+        CHECK(3500 == scheduler.getTickTime(2));
+        CHECK(0 == scheduler.getDueTick(1499));
+        CHECK(1 == scheduler.getDueTick(1500));
+
+        scheduler.setTimePerFrame(1500, 500);
+        CHECK(2000 == scheduler.getTickTime(2));
+    }
+
+    // with durations that aren't whole ns, a tick is due exactly from its tick time on
+    {
+        HPV::HPVFrameScheduler scheduler;
+        scheduler.start(123456789, 1e9 / 23.976);
+        scheduler.setTimePerFrame(123456789 + 777, 1e9 / 29.97);
+
+        for (int64_t tick = 0; tick < 100000; ++tick)
+        {
+            uint64_t time = scheduler.getTickTime(tick);
+
+            if (scheduler.getDueTick(time) != tick || scheduler.getDueTick(time - 1) != tick - 1)
+            {
+                fprintf(stderr, "%s:%d: check failed: tick %lld isn't due from %llu on\n", __FILE__, __LINE__,
+                        static_cast<long long>(tick), static_cast<unsigned long long>(time));
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    fprintf(stderr, "scheduler: %s\n", ok ? "ok" : "FAILED");
+
+    return ok;
+}
+
+//--------------------------------------------------------------
+bool CheckAllocations(const std::string& file)
+{
+    bool ok = true;
+
+    for (int mode = 0; mode < 4; ++mode)
+    {
+        HPV::HPVPlayerRef player = HPV::NewPlayer();
+
+        if (!player || !player->open(file, static_cast<HPV::HPVReadMode>(mode)))
+        {
+            fprintf(stderr, "allocations: couldn't open %s with the %s reader\n", file.c_str(), CHECK_READ_MODE_NAMES[mode]);
+            ok = false;
+            continue;
+        }
+
+        // the cache allocates its whole budget here, filling and evicting it later must not
+        player->setFrameCacheSize(CHECK_ALLOCATION_CACHE * player->getBytesPerFrame());
+
+        // forwards and backwards through the whole file, as fast as frames decode
+        player->setLoopMode(HPV_LOOPMODE_PALINDROME);
+        player->play(CHECK_FREE_RUNNING_FPS);
+
+        // from the first frame on: starting a player may allocate (its thread, the first events), playing it may not
+        uint64_t deadline = ns() + CHECK_TIMEOUT_S * 1000000000ULL;
+
+        while (0 == player->getNumPresentedFrames() && ns() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        uint64_t allocations_before = g_num_allocations.load(std::memory_order_relaxed);
+
+        while (player->getNumPresentedFrames() < CHECK_ALLOCATION_FRAMES && ns() < deadline)
+        {
+            // drained like a render loop does, the loop events go through the manager's queue
+            HPV::ManagerSingleton()->processEvents();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        uint64_t num_presented = player->getNumPresentedFrames();
+        player->stop();
+
+        uint32_t state = 0x2545F491u;
+        for (int i = 0; i < CHECK_ALLOCATION_SEEKS; ++i)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+
+            player->seek(static_cast<int64_t>(state % player->getNumberOfFrames()), true);
+            HPV::ManagerSingleton()->processEvents();
+        }
+
+        uint64_t num_allocations = g_num_allocations.load(std::memory_order_relaxed) - allocations_before;
+        uint64_t num_buffer_allocations = player->getNumDecodeAllocations();
+
+        fprintf(stderr, "allocations: %-6s %llu frames, %d seeks, %llu frame cache hits, %llu allocations, %llu decode buffer allocations\n",
+                CHECK_READ_MODE_NAMES[mode], static_cast<unsigned long long>(num_presented), CHECK_ALLOCATION_SEEKS,
+                static_cast<unsigned long long>(player->getNumFrameCacheHits()), static_cast<unsigned long long>(num_allocations),
+                static_cast<unsigned long long>(num_buffer_allocations));
+
+        CHECK(num_presented >= CHECK_ALLOCATION_FRAMES);
+        CHECK(player->getNumFrameCacheHits() > 0);
+        CHECK(0 == num_allocations);
+        CHECK(0 == num_buffer_allocations);
+
+        player->close();
+    }
+
+    HPV::ManagerSingleton()->closeAll();
+
+    fprintf(stderr, "allocations: %s\n", ok ? "ok" : "FAILED");
+
+    return ok;
+}
+
+//--------------------------------------------------------------
+bool CheckTearing(const std::string& file, double seconds)
+{
+    bool ok = true;
+
+    // reference checksums, every frame decoded on its own; frame 0 last, seeking to the frame a player is on does nothing
+    HPV::HPVPlayerRef reference = HPV::NewPlayer();
+
+    if (!reference || !reference->open(file))
+    {
+        fprintf(stderr, "tearing: couldn't open %s\n", file.c_str());
+        return false;
+    }
+
+    int64_t num_frames = static_cast<int64_t>(reference->getNumberOfFrames());
+    std::size_t bytes_per_frame = reference->getBytesPerFrame();
+    std::vector<uint64_t> checksums(num_frames);
+
+    for (int64_t i = 1; i <= num_frames; ++i)
+    {
+        int64_t frame = i % num_frames;
+
+        if (num_frames > 1 && !reference->seek(frame, true))
+        {
+            fprintf(stderr, "tearing: couldn't decode frame %lld\n", static_cast<long long>(frame));
+            return false;
+        }
+
+        checksums[frame] = Checksum(reference->getBufferPtr(), bytes_per_frame);
+    }
+
+    reference->close();
+
+    HPV::HPVPlayerRef player = HPV::NewPlayer();
+
+    if (!player || !player->open(file))
+    {
+        fprintf(stderr, "tearing: couldn't open %s\n", file.c_str());
+        return false;
+    }
+
+    player->setLoopMode(HPV_LOOPMODE_LOOP);
+    player->play(CHECK_TEARING_FPS);
+
+    // this thread is the renderer: copy what is presented, as often as possible
+    std::vector<unsigned char> copy(bytes_per_frame);
+    uint64_t num_copies = 0;
+    uint64_t num_torn = 0;
+    uint64_t end = ns() + static_cast<uint64_t>(seconds * 1e9);
+
+    while (ns() < end)
+    {
+        HPV::HPVAcquiredFrame acquired = player->acquireFrame();
+
+        if (!acquired.buffer)
+        {
+            player->releaseFrame();
+            continue;
+        }
+
+        memcpy(copy.data(), acquired.buffer, bytes_per_frame);
+        int64_t frame = acquired.frame;
+        player->releaseFrame();
+
+        ++num_copies;
+
+        if (frame < 0 || frame >= num_frames || Checksum(copy.data(), bytes_per_frame) != checksums[frame])
+        {
+            ++num_torn;
+        }
+    }
+
+    uint64_t num_presented = player->getNumPresentedFrames();
+    player->close();
+    HPV::ManagerSingleton()->closeAll();
+
+    fprintf(stderr, "tearing: %llu frames presented, %llu copied, %llu torn or labelled with the wrong frame\n",
+            static_cast<unsigned long long>(num_presented), static_cast<unsigned long long>(num_copies), static_cast<unsigned long long>(num_torn));
+
+    CHECK(num_presented > 1);
+    CHECK(num_copies > 0);
+    CHECK(0 == num_torn);
+
+    fprintf(stderr, "tearing: %s\n", ok ? "ok" : "FAILED");
+
+    return ok;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+ *  Pass/fail checks run with -check instead of a benchmark. They need no window and no GL context, so they
+ *  can run on CI. Every failed condition is printed to stderr; a check returns false when any of them failed.
+ */
+
+/* HPVFrameScheduler driven by a fake clock: an hour of ticks, stalls, drops and speed changes */
+bool CheckScheduler();
+
+/*
+ *  Plays and seeks 'file' with every read mode and the frame cache on: once the first frame is shown, no
+ *  operator new may run anywhere in the program and the decode buffers may not grow
+ */
+bool CheckAllocations(const std::string& file);
+
+/*
+ *  Copies and checksums the frames a player hands out through acquireFrame() while it plays 'file' as fast as it
+ *  can, for 'seconds': every copy must match the reference checksum of its frame number. Built with
+ *  -fsanitize=thread this also lets ThreadSanitizer watch the handoff between the decode and the render side.
+ */
+bool CheckTearing(const std::string& file, double seconds);
@@ -0,0 +1,12 @@
+#include "ofMain.h"
+#include "ofAppNoWindow.h"
+#include "ofApp.h"
+
+int main(int argc, char * argv[])
+{
+    /* The benchmark drives the players without drawing: no window, no GL context */
+    ofAppNoWindow window;
+    ofSetupOpenGL(&window, 1024, 512, OF_WINDOW);
+    
+    ofRunApp(new ofApp(std::vector<std::string>(argv + 1, argv + argc)));
+}
@@ -0,0 +1,1070 @@
+#include "ofApp.h"
+
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+/* Players play as fast as they can decode: a frame time far below any real decode time */
+#define BENCH_FREE_RUNNING_FPS      100000
+#define BENCH_WARMUP_MS             250
+#define BENCH_OPEN_FRAME_SIZE       16          /* -open: tiny frames, the length of the file is mostly its index */
+#define BENCH_OPEN_REPEATS          5
+#define BENCH_UPDATE_CALLS          10000
+
+static const char * PATTERN_NAMES[] = { "sequential", "reverse", "palindrome", "random" };
+static const char * TYPE_NAMES[] = { "dxt1", "dxt5", "cocgy" };
+static const char * READ_MODE_NAMES[] = { "stream", "mmap", "async", "direct" };
+static const char * INDEX_MODE_NAMES[] = { "auto", "eager", "lazy" };
+static const char * MODEL_NAMES[] = { "per_player", "pool" };
+static const char * CHECK_NAMES[] = { "scheduler", "allocations", "tearing" };
+
+static inline uint32_t xorshift32(uint32_t state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/*
+ *  Synthetic content: gradients that move with the frame, with a share 'entropy' of the pixels replaced by
+ *  noise. The share sets how well LZ4 can compress the DXT blocks, and so the ratio between read and decode work.
+ */
+static void SyntheticFrame(uint32_t frame, uint32_t width, uint32_t height, float entropy, unsigned char * rgba)
+{
+    uint32_t state = 0x9E3779B9u * (frame + 1);
+    uint32_t threshold = static_cast<uint32_t>(entropy * 4294967295.0);
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            unsigned char * px = rgba + 4 * (static_cast<std::size_t>(y) * width + x);
+            state = xorshift32(state);
+
+            if (entropy > 0.0f && state <= threshold)
+            {
+                state = xorshift32(state);
+                memcpy(px, &state, 4);
+            }
+            else
+            {
+                px[0] = static_cast<unsigned char>((x + 4 * frame) * 255 / width);
+                px[1] = static_cast<unsigned char>(y * 255 / height);
+                px[2] = static_cast<unsigned char>((x + y + 2 * frame) & 0xFF);
+                px[3] = 255;
+            }
+        }
+    }
+}
+
+static BenchLatency Percentiles(std::vector<uint64_t>& samples)
+{
+    BenchLatency latency;
+    latency.count = samples.size();
+
+    if (samples.empty())
+    {
+        return latency;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    std::size_t last = samples.size() - 1;
+    latency.p50 = samples[std::min(last, samples.size() / 2)];
+    latency.p99 = samples[std::min(last, samples.size() * 99 / 100)];
+    latency.p999 = samples[std::min(last, samples.size() * 999 / 1000)];
+    latency.max = samples[last];
+
+    return latency;
+}
+
+static std::string LatencyJSON(const BenchLatency& latency)
+{
+    return ofVAArgsToString("{ \"count\": %zu, \"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f }",
+                            latency.count, latency.p50 / 1e3, latency.p99 / 1e3, latency.p999 / 1e3, latency.max / 1e3);
+}
+
+//--------------------------------------------------------------
+ofApp::ofApp(const std::vector<std::string>& args)
+: m_args(args)
+, m_file_size(0)
+{
+    m_settings.encoder.width = 1920;
+    m_settings.encoder.height = 1080;
+    m_settings.encoder.frame_rate = 60;
+    m_settings.encoder.lz4_level = 0;
+}
+
+//--------------------------------------------------------------
+void ofApp::printUsage()
+{
+    fprintf(stderr,
+           "usage: example-bench [options]\n"
+           "  -size <w>x<h>             frame size, multiples of 4 (1920x1080)\n"
+           "  -type <dxt1|dxt5|cocgy>   compression type (dxt1)\n"
+           "  -entropy <0-1>            share of noise pixels, 0 compresses best and 1 not at all (0.25)\n"
+           "  -frames <n>               frames per file (240)\n"
+           "  -lz4 <0-16>               0 = fast LZ4, otherwise the LZ4 HC level (0)\n"
+           "  -slices <n>               frames in n slices, decompressed in parallel\n"
+           "  -align <bytes>            align frames, e.g. 4096 for -read direct\n"
+           "  -players <n,n,..>         player counts to run every pattern with (1)\n"
+           "  -patterns <p,p,..>        sequential, reverse, palindrome, random (all)\n"
+           "  -read <mode>              stream, mmap, async or direct (stream)\n"
+           "  -index <mode>             frame index of the players: auto, eager or lazy (auto)\n"
+           "  -model <m,m,..>           threading models to run every pattern with: per_player, pool (pool)\n"
+           "  -checksums <0|1>          write version 10 files with a CRC32C per frame (1)\n"
+           "  -threads <n>              decode pool threads (one per core)\n"
+           "  -seconds <s>              length of every run (3)\n"
+           "  -cold <0|1>               drop the files from the page cache before every run, Linux only (0)\n"
+           "  -dir <folder>             where the synthetic files are written (the data folder)\n"
+           "  -json <file>              write the results there instead of to stdout\n"
+           "  -open <n,n,..>            instead of playing, time open(), the first frame and a jump to the middle\n"
+           "                            of files of n frames, with an eager and a lazy index\n"
+           "  -cpu <n>                  instead of benchmarking, measure the CPU time of n players sharing one file, paused\n"
+           "                            and playing at the file's frame rate, with every -model\n"
+           "  -update <n,n,..>          instead of benchmarking, time HPVManager::update() with n players playing one file\n"
+           "                            at its frame rate, with every -model\n"
+           "  -check <c,c,..>           instead of benchmarking, run these checks: scheduler, allocations, tearing\n"
+           "                            (for -seconds). Exits with 1 when one fails\n"
+           "Every player gets its own copy of the file. Results are JSON, latencies in microseconds.\n");
+}
+
+//--------------------------------------------------------------
+bool ofApp::parseArguments()
+{
+    for (std::size_t i = 0; i < m_args.size(); ++i)
+    {
+        const std::string& arg = m_args[i];
+
+        if (i + 1 >= m_args.size())
+        {
+            fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+
+        const std::string& value = m_args[++i];
+
+        if (arg == "-size")
+        {
+            std::vector<std::string> size = ofSplitString(value, "x");
+
+            if (size.size() != 2)
+            {
+                fprintf(stderr, "The size is given as <width>x<height>, e.g. 3840x2160\n");
+                return false;
+            }
+
+            m_settings.encoder.width = ofToInt(size[0]);
+            m_settings.encoder.height = ofToInt(size[1]);
+        }
+        else if (arg == "-type")
+        {
+            if (value == "dxt1")        m_settings.encoder.compression_type = HPV::HPVCompressionType::HPV_TYPE_DXT1_NO_ALPHA;
+            else if (value == "dxt5")   m_settings.encoder.compression_type = HPV::HPVCompressionType::HPV_TYPE_DXT5_ALPHA;
+            else if (value == "cocgy")  m_settings.encoder.compression_type = HPV::HPVCompressionType::HPV_TYPE_SCALED_DXT5_CoCg_Y;
+            else
+            {
+                fprintf(stderr, "Unknown compression type %s\n", value.c_str());
+                return false;
+            }
+        }
+        else if (arg == "-entropy")
+        {
+            m_settings.entropy = ofToFloat(value);
+
+            if (m_settings.entropy < 0.0f || m_settings.entropy > 1.0f)
+            {
+                fprintf(stderr, "The entropy goes from 0 to 1\n");
+                return false;
+            }
+        }
+        else if (arg == "-frames")
+        {
+            m_settings.num_frames = ofToInt(value);
+        }
+        else if (arg == "-lz4")
+        {
+            m_settings.encoder.lz4_level = ofToInt(value);
+        }
+        else if (arg == "-slices")
+        {
+            m_settings.encoder.num_slices = ofToInt(value);
+        }
+        else if (arg == "-align")
+        {
+            m_settings.encoder.frame_alignment = ofToInt(value);
+        }
+        else if (arg == "-players")
+        {
+            m_settings.player_counts.clear();
+
+            for (const std::string& count : ofSplitString(value, ",", true, true))
+            {
+                if (ofToInt(count) <= 0)
+                {
+                    fprintf(stderr, "Player counts have to be at least 1\n");
+                    return false;
+                }
+
+                m_settings.player_counts.push_back(ofToInt(count));
+            }
+        }
+        else if (arg == "-patterns")
+        {
+            m_settings.patterns.clear();
+
+            for (const std::string& name : ofSplitString(value, ",", true, true))
+            {
+                const char ** found = std::find_if(std::begin(PATTERN_NAMES), std::end(PATTERN_NAMES), [&name](const char * p) { return name == p; });
+
+                if (found == std::end(PATTERN_NAMES))
+                {
+                    fprintf(stderr, "Unknown pattern %s\n", name.c_str());
+                    return false;
+                }
+
+                m_settings.patterns.push_back(static_cast<BenchPattern>(found - std::begin(PATTERN_NAMES)));
+            }
+        }
+        else if (arg == "-read")
+        {
+            const char ** found = std::find_if(std::begin(READ_MODE_NAMES), std::end(READ_MODE_NAMES), [&value](const char * m) { return value == m; });
+
+            if (found == std::end(READ_MODE_NAMES))
+            {
+                fprintf(stderr, "Unknown read mode %s\n", value.c_str());
+                return false;
+            }
+
+            m_settings.read_mode = static_cast<HPV::HPVReadMode>(found - std::begin(READ_MODE_NAMES));
+        }
+        else if (arg == "-index")
+        {
+            const char ** found = std::find_if(std::begin(INDEX_MODE_NAMES), std::end(INDEX_MODE_NAMES), [&value](const char * m) { return value == m; });
+
+            if (found == std::end(INDEX_MODE_NAMES))
+            {
+                fprintf(stderr, "Unknown index mode %s\n", value.c_str());
+                return false;
+            }
+
+            m_settings.index_mode = static_cast<HPV::HPVIndexMode>(found - std::begin(INDEX_MODE_NAMES));
+        }
+        else if (arg == "-model")
+        {
+            m_settings.models.clear();
+
+            for (const std::string& name : ofSplitString(value, ",", true, true))
+            {
+                const char ** found = std::find_if(std::begin(MODEL_NAMES), std::end(MODEL_NAMES), [&name](const char * m) { return name == m; });
+
+                if (found == std::end(MODEL_NAMES))
+                {
+                    fprintf(stderr, "Unknown threading model %s\n", name.c_str());
+                    return false;
+                }
+
+                m_settings.models.push_back(static_cast<HPV::HPVThreadingModel>(found - std::begin(MODEL_NAMES)));
+            }
+        }
+        else if (arg == "-checksums")
+        {
+            m_settings.encoder.frame_checksums = (ofToInt(value) != 0);
+        }
+        else if (arg == "-open")
+        {
+            m_settings.open_lengths.clear();
+
+            for (const std::string& length : ofSplitString(value, ",", true, true))
+            {
+                if (ofToInt(length) <= 0)
+                {
+                    fprintf(stderr, "Files have at least 1 frame\n");
+                    return false;
+                }
+
+                m_settings.open_lengths.push_back(ofToInt(length));
+            }
+        }
+        else if (arg == "-cpu")
+        {
+            if (ofToInt(value) <= 0 || ofToInt(value) > static_cast<int>(HPV::MAX_NUMBER_OF_PLAYERS))
+            {
+                fprintf(stderr, "Measure 1 to %u players\n", HPV::MAX_NUMBER_OF_PLAYERS);
+                return false;
+            }
+
+            m_settings.cpu_players = ofToInt(value);
+        }
+        else if (arg == "-update")
+        {
+            m_settings.update_counts.clear();
+
+            for (const std::string& count : ofSplitString(value, ",", true, true))
+            {
+                if (ofToInt(count) <= 0 || ofToInt(count) > static_cast<int>(HPV::MAX_NUMBER_OF_PLAYERS))
+                {
+                    fprintf(stderr, "Player counts have to be 1 to %u\n", HPV::MAX_NUMBER_OF_PLAYERS);
+                    return false;
+                }
+
+                m_settings.update_counts.push_back(ofToInt(count));
+            }
+        }
+        else if (arg == "-check")
+        {
+            m_settings.checks.clear();
+
+            for (const std::string& name : ofSplitString(value, ",", true, true))
+            {
+                const char ** found = std::find_if(std::begin(CHECK_NAMES), std::end(CHECK_NAMES), [&name](const char * c) { return name == c; });
+
+                if (found == std::end(CHECK_NAMES))
+                {
+                    fprintf(stderr, "Unknown check %s\n", name.c_str());
+                    return false;
+                }
+
+                m_settings.checks.push_back(static_cast<BenchCheck>(found - std::begin(CHECK_NAMES)));
+            }
+        }
+        else if (arg == "-threads")
+        {
+            m_settings.num_threads = ofToInt(value);
+        }
+        else if (arg == "-seconds")
+        {
+            m_settings.seconds = ofToDouble(value);
+        }
+        else if (arg == "-cold")
+        {
+            m_settings.cold = (ofToInt(value) != 0);
+        }
+        else if (arg == "-dir")
+        {
+            m_settings.dir = value;
+        }
+        else if (arg == "-json")
+        {
+            m_settings.json_file = value;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    if (m_settings.player_counts.empty() || m_settings.patterns.empty() || m_settings.models.empty() || 0 == m_settings.num_frames || m_settings.seconds <= 0.0)
+    {
+        return false;
+    }
+
+    if (m_settings.dir.empty())
+    {
+        m_settings.dir = ofToDataPath("", true);
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------
+bool ofApp::generateFiles(uint32_t num_files)
+{
+    const HPV::HPVEncoderSettings& settings = m_settings.encoder;
+    std::string base = ofFilePath::join(m_settings.dir, ofVAArgsToString("hpv_bench_%ux%u_%s_%.2f", settings.width, settings.height,
+                                                                        TYPE_NAMES[static_cast<int>(settings.compression_type)], m_settings.entropy));
+
+    fprintf(stderr, "Generating %u frames of %ux%u, entropy %.2f\n", m_settings.num_frames, settings.width, settings.height, m_settings.entropy);
+
+    float entropy = m_settings.entropy;
+    HPV::HPVFrameSource source = [&settings, entropy](uint32_t frame, unsigned char * rgba)
+    {
+        SyntheticFrame(frame, settings.width, settings.height, entropy, rgba);
+        return HPV_RET_ERROR_NONE;
+    };
+
+    HPV::HPVEncoder encoder;
+    std::string first = base + "_0.hpv";
+    m_files.push_back(first);
+
+    if (!encoder.encode(first, m_settings.num_frames, settings, source))
+    {
+        fprintf(stderr, "Couldn't write %s: %s\n", first.c_str(), encoder.getLastError().c_str());
+        return false;
+    }
+
+    m_file_size = encoder.getNumBytesWritten();
+
+    // copies instead of sharing one file, so players don't read each other's frames from the page cache
+    for (uint32_t i = 1; i < num_files; ++i)
+    {
+        std::string copy = base + "_" + ofToString(i) + ".hpv";
+        m_files.push_back(copy);
+
+        if (!ofFile::copyFromTo(first, copy, false, true))
+        {
+            fprintf(stderr, "Couldn't write %s\n", copy.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofApp::removeFiles()
+{
+    for (const std::string& file : m_files)
+    {
+        ofFile::removeFile(file, false);
+    }
+
+    m_files.clear();
+}
+
+//--------------------------------------------------------------
+void ofApp::dropFromCache()
+{
+#if defined(POSIX_FADV_DONTNEED)
+    for (const std::string& file : m_files)
+    {
+        int fd = ::open(file.c_str(), O_RDONLY);
+
+        if (fd >= 0)
+        {
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+#endif
+}
+
+//--------------------------------------------------------------
+BenchResult ofApp::run(HPV::HPVThreadingModel model, BenchPattern pattern, uint32_t num_players)
+{
+    BenchResult result;
+    result.model = model;
+    result.pattern = pattern;
+    result.num_players = num_players;
+    result.seconds = 0.0;
+    result.num_frames = 0;
+    result.num_bytes = 0;
+
+    ThreadSafe_Queue<HPV::HPVFrameTiming> timings;
+    std::vector<HPV::HPVPlayerRef> players;
+
+    // players take the model at open(), the pool is started by the first one that needs it
+    HPV::ManagerSingleton()->setThreadingModel(model, m_settings.num_threads);
+
+    if (m_settings.cold)
+    {
+        dropFromCache();
+    }
+
+    for (uint32_t i = 0; i < num_players; ++i)
+    {
+        HPV::HPVPlayerRef player = HPV::NewPlayer();
+
+        if (!player || !player->open(m_files[i], m_settings.read_mode, m_settings.index_mode))
+        {
+            fprintf(stderr, "Couldn't open %s\n", m_files[i].c_str());
+            HPV::ManagerSingleton()->closeAll();
+            return result;
+        }
+
+        player->enableStats(true);
+        player->setFrameTimingSink(&timings);
+        player->setLoopMode((BenchPattern::BENCH_PALINDROME == pattern) ? HPV_LOOPMODE_PALINDROME : HPV_LOOPMODE_LOOP);
+        player->setPlayDirection(BenchPattern::BENCH_REVERSE != pattern);
+
+        if (BenchPattern::BENCH_RANDOM_SEEK != pattern)
+        {
+            player->play(BENCH_FREE_RUNNING_FPS);
+        }
+
+        players.push_back(player);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_WARMUP_MS));
+
+    HPV::HPVFrameTiming timing;
+    while (timings.try_pop(timing)) {}
+
+    for (HPV::HPVPlayerRef& player : players)
+    {
+        result.num_frames -= player->getNumPresentedFrames();
+        result.num_bytes -= player->getNumBytesRead();
+    }
+
+    uint64_t start = ns();
+    uint64_t end = start + static_cast<uint64_t>(m_settings.seconds * 1e9);
+    std::vector<std::vector<uint64_t>> seek_samples(num_players);
+
+    if (BenchPattern::BENCH_RANDOM_SEEK == pattern)
+    {
+        // one thread per player, every seek waits until its frame is decoded
+        std::vector<std::thread> seekers;
+
+        for (uint32_t i = 0; i < num_players; ++i)
+        {
+            seekers.emplace_back([&players, &seek_samples, i, end]()
+            {
+                HPV::HPVPlayerRef& player = players[i];
+                uint32_t state = 0x2545F491u * (i + 1);
+
+                while (ns() < end)
+                {
+                    state = xorshift32(state);
+                    int64_t frame = state % player->getNumberOfFrames();
+
+                    uint64_t before = ns();
+
+                    if (player->seek(frame, true))
+                    {
+                        seek_samples[i].push_back(ns() - before);
+                    }
+                }
+            });
+        }
+
+        for (std::thread& seeker : seekers)
+        {
+            seeker.join();
+        }
+    }
+    else
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(end - start));
+    }
+
+    result.seconds = (ns() - start) / 1e9;
+
+    for (HPV::HPVPlayerRef& player : players)
+    {
+        result.num_frames += player->getNumPresentedFrames();
+        result.num_bytes += player->getNumBytesRead();
+        player->setFrameTimingSink(nullptr);
+        player->stop();
+    }
+
+    std::vector<uint64_t> read_times;
+    std::vector<uint64_t> decode_times;
+
+    while (timings.try_pop(timing))
+    {
+        read_times.push_back(timing.read_time);
+        decode_times.push_back(timing.decode_time);
+    }
+
+    std::vector<uint64_t> seek_times;
+    for (std::vector<uint64_t>& samples : seek_samples)
+    {
+        seek_times.insert(seek_times.end(), samples.begin(), samples.end());
+    }
+
+    result.read = Percentiles(read_times);
+    result.decode = Percentiles(decode_times);
+    result.seek = Percentiles(seek_times);
+
+    players.clear();
+    HPV::ManagerSingleton()->closeAll();
+
+    return result;
+}
+
+//--------------------------------------------------------------
+BenchOpenResult ofApp::runOpen(uint32_t num_frames)
+{
+    BenchOpenResult result;
+    result.num_frames = num_frames;
+    result.num_bytes = 0;
+
+    HPV::HPVEncoderSettings settings = m_settings.encoder;
+    settings.width = BENCH_OPEN_FRAME_SIZE;
+    settings.height = BENCH_OPEN_FRAME_SIZE;
+
+    std::string file = ofFilePath::join(m_settings.dir, ofVAArgsToString("hpv_bench_open_%u.hpv", num_frames));
+    m_files.push_back(file);
+
+    float entropy = m_settings.entropy;
+    HPV::HPVFrameSource source = [&settings, entropy](uint32_t frame, unsigned char * rgba)
+    {
+        SyntheticFrame(frame, settings.width, settings.height, entropy, rgba);
+        return HPV_RET_ERROR_NONE;
+    };
+
+    HPV::HPVEncoder encoder;
+
+    if (!encoder.encode(file, num_frames, settings, source))
+    {
+        fprintf(stderr, "Couldn't write %s: %s\n", file.c_str(), encoder.getLastError().c_str());
+        return result;
+    }
+
+    result.num_bytes = encoder.getNumBytesWritten();
+
+    // the file was just written, so both indexes read it from the page cache
+    const HPV::HPVIndexMode modes[2] = { HPV::HPVIndexMode::HPV_INDEX_EAGER, HPV::HPVIndexMode::HPV_INDEX_LAZY };
+
+    for (int i = 0; i < 2; ++i)
+    {
+        std::vector<uint64_t> open_times;
+        std::vector<uint64_t> first_frame_times;
+        std::vector<uint64_t> middle_frame_times;
+
+        for (int repeat = 0; repeat < BENCH_OPEN_REPEATS; ++repeat)
+        {
+            HPV::HPVPlayerRef player = HPV::NewPlayer();
+            uint64_t before = ns();
+
+            if (!player || !player->open(file, m_settings.read_mode, modes[i]))
+            {
+                fprintf(stderr, "Couldn't open %s\n", file.c_str());
+                break;
+            }
+
+            open_times.push_back(ns() - before);
+
+            // open() leaves the player on frame 0 without decoding it, and seeking there is a no-op
+            if (player->seek(static_cast<int64_t>(1), true))
+            {
+                first_frame_times.push_back(ns() - before);
+            }
+
+            before = ns();
+
+            if (player->seek(static_cast<int64_t>(num_frames / 2), true))
+            {
+                middle_frame_times.push_back(ns() - before);
+            }
+
+            player->close();
+        }
+
+        result.open[i] = Percentiles(open_times).p50;
+        result.first_frame[i] = Percentiles(first_frame_times).p50;
+        result.middle_frame[i] = Percentiles(middle_frame_times).p50;
+    }
+
+    HPV::ManagerSingleton()->closeAll();
+    removeFiles();
+
+    return result;
+}
+
+//--------------------------------------------------------------
+/* Sum of getCPUTime() of all players */
+static uint64_t TotalCPUTime(const std::vector<HPV::HPVPlayerRef>& players)
+{
+    uint64_t total = 0;
+
+    for (const HPV::HPVPlayerRef& player : players)
+    {
+        total += player->getCPUTime();
+    }
+
+    return total;
+}
+
+//--------------------------------------------------------------
+BenchCPUResult ofApp::runCPU(HPV::HPVThreadingModel model, uint32_t num_players)
+{
+    BenchCPUResult result;
+    result.model = model;
+    result.num_players = num_players;
+    result.paused = 0.0;
+    result.playing = 0.0;
+
+    std::vector<HPV::HPVPlayerRef> players;
+
+    HPV::ManagerSingleton()->setThreadingModel(model, m_settings.num_threads);
+
+    for (uint32_t i = 0; i < num_players; ++i)
+    {
+        HPV::HPVPlayerRef player = HPV::NewPlayer();
+
+        if (!player || !player->open(m_files[0], m_settings.read_mode, m_settings.index_mode))
+        {
+            fprintf(stderr, "Couldn't open %s\n", m_files[0].c_str());
+            HPV::ManagerSingleton()->closeAll();
+            return result;
+        }
+
+        // getCPUTime() is only gathered with stats on
+        player->enableStats(true);
+        player->setLoopMode(HPV_LOOPMODE_LOOP);
+        player->play();
+        player->pause();
+
+        players.push_back(player);
+    }
+
+    // what an idle player costs: its thread or its turns on the pool, waking up to find nothing to do
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_WARMUP_MS));
+
+    uint64_t cpu = TotalCPUTime(players);
+    uint64_t start = ns();
+    std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<uint64_t>(m_settings.seconds * 1e9)));
+    result.paused = (TotalCPUTime(players) - cpu) / 1e6 / ((ns() - start) / 1e9) / num_players;
+
+    for (HPV::HPVPlayerRef& player : players)
+    {
+        player->resume();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_WARMUP_MS));
+
+    cpu = TotalCPUTime(players);
+    start = ns();
+    std::this_thread::sleep_for(std::chrono::nanoseconds(static_cast<uint64_t>(m_settings.seconds * 1e9)));
+    result.playing = (TotalCPUTime(players) - cpu) / 1e6 / ((ns() - start) / 1e9) / num_players;
+
+    players.clear();
+    HPV::ManagerSingleton()->closeAll();
+
+    return result;
+}
+
+//--------------------------------------------------------------
+BenchUpdateResult ofApp::runUpdate(HPV::HPVThreadingModel model, uint32_t num_players)
+{
+    BenchUpdateResult result;
+    result.model = model;
+    result.num_players = num_players;
+    result.num_calls = 0;
+    result.update = 0.0;
+
+    HPV::ManagerSingleton()->setThreadingModel(model, m_settings.num_threads);
+
+    for (uint32_t i = 0; i < num_players; ++i)
+    {
+        HPV::HPVPlayerRef player = HPV::NewPlayer();
+
+        if (!player || !player->open(m_files[0], m_settings.read_mode, m_settings.index_mode))
+        {
+            fprintf(stderr, "Couldn't open %s\n", m_files[0].c_str());
+            HPV::ManagerSingleton()->closeAll();
+            return result;
+        }
+
+        player->setLoopMode(HPV_LOOPMODE_LOOP);
+        player->play();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCH_WARMUP_MS));
+
+    // back to back, so frames come in during the calls the way they would in a render loop
+    uint64_t start = ns();
+
+    for (int i = 0; i < BENCH_UPDATE_CALLS; ++i)
+    {
+        HPV::ManagerSingleton()->update();
+    }
+
+    result.update = static_cast<double>(ns() - start) / BENCH_UPDATE_CALLS;
+    result.num_calls = BENCH_UPDATE_CALLS;
+
+    HPV::ManagerSingleton()->closeAll();
+
+    return result;
+}
+
+//--------------------------------------------------------------
+bool ofApp::runChecks()
+{
+    bool ok = true;
+
+    // the checks that play a file share one, written with the file options
+    bool needs_file = std::any_of(m_settings.checks.begin(), m_settings.checks.end(), [](BenchCheck check) { return BenchCheck::BENCH_CHECK_SCHEDULER != check; });
+
+    if (needs_file && !generateFiles(1))
+    {
+        removeFiles();
+        return false;
+    }
+
+    for (BenchCheck check : m_settings.checks)
+    {
+        switch (check)
+        {
+            case BenchCheck::BENCH_CHECK_SCHEDULER:
+                ok &= CheckScheduler();
+                break;
+            case BenchCheck::BENCH_CHECK_ALLOCATIONS:
+                ok &= CheckAllocations(m_files[0]);
+                break;
+            case BenchCheck::BENCH_CHECK_TEARING:
+                ok &= CheckTearing(m_files[0], m_settings.seconds);
+                break;
+            default:
+                break;
+        }
+    }
+
+    removeFiles();
+
+    return ok;
+}
+
+//--------------------------------------------------------------
+std::string ofApp::toJSON(const std::vector<BenchResult>& results)
+{
+    const HPV::HPVEncoderSettings& settings = m_settings.encoder;
+    std::string json = "{\n";
+
+    // the size the pool is started with, asking the pool itself would start it after per_player runs
+    json += ofVAArgsToString("  \"machine\": { \"cores\": %u, \"decode_threads\": %u },\n",
+                             std::thread::hardware_concurrency(), m_settings.num_threads ? m_settings.num_threads : std::max(1u, std::thread::hardware_concurrency()));
+    json += ofVAArgsToString("  \"file\": { \"width\": %u, \"height\": %u, \"type\": \"%s\", \"entropy\": %.2f, \"frames\": %u, \"lz4_level\": %d, \"slices\": %u, \"alignment\": %u, \"bytes\": %" PRIu64 ", \"read_mode\": \"%s\", \"index\": \"%s\", \"cold\": %s },\n",
+                             settings.width, settings.height, TYPE_NAMES[static_cast<int>(settings.compression_type)], m_settings.entropy,
+                             m_settings.num_frames, settings.lz4_level, settings.num_slices, settings.frame_alignment, m_file_size,
+                             READ_MODE_NAMES[static_cast<int>(m_settings.read_mode)], INDEX_MODE_NAMES[static_cast<int>(m_settings.index_mode)],
+                             m_settings.cold ? "true" : "false");
+    json += "  \"runs\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& result = results[i];
+
+        json += ofVAArgsToString("    { \"model\": \"%s\", \"pattern\": \"%s\", \"players\": %u, \"seconds\": %.3f, \"frames\": %" PRIu64 ", \"fps\": %.1f, \"mb_per_s\": %.1f,\n",
+                                 MODEL_NAMES[static_cast<int>(result.model)], PATTERN_NAMES[static_cast<int>(result.pattern)], result.num_players, result.seconds, result.num_frames,
+                                 result.num_frames / result.seconds, result.num_bytes / result.seconds / 1e6);
+        json += "      \"read_us\": " + LatencyJSON(result.read) + ",\n";
+        json += "      \"decode_us\": " + LatencyJSON(result.decode) + ",\n";
+        json += "      \"seek_us\": " + LatencyJSON(result.seek) + " }";
+        json += (i + 1 < results.size()) ? ",\n" : "\n";
+    }
+
+    json += "  ]\n}\n";
+
+    return json;
+}
+
+//--------------------------------------------------------------
+std::string ofApp::toJSON(const std::vector<BenchOpenResult>& results)
+{
+    const HPV::HPVEncoderSettings& settings = m_settings.encoder;
+    std::string json = "{\n";
+
+    json += ofVAArgsToString("  \"file\": { \"width\": %u, \"height\": %u, \"type\": \"%s\", \"checksums\": %s, \"alignment\": %u, \"read_mode\": \"%s\" },\n",
+                             BENCH_OPEN_FRAME_SIZE, BENCH_OPEN_FRAME_SIZE, TYPE_NAMES[static_cast<int>(settings.compression_type)],
+                             settings.frame_checksums ? "true" : "false", settings.frame_alignment, READ_MODE_NAMES[static_cast<int>(m_settings.read_mode)]);
+    json += "  \"open\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchOpenResult& result = results[i];
+
+        json += ofVAArgsToString("    { \"frames\": %u, \"bytes\": %" PRIu64 ",\n", result.num_frames, result.num_bytes);
+        json += ofVAArgsToString("      \"eager_us\": { \"open\": %.1f, \"first_frame\": %.1f, \"middle_frame\": %.1f },\n",
+                                 result.open[0] / 1e3, result.first_frame[0] / 1e3, result.middle_frame[0] / 1e3);
+        json += ofVAArgsToString("      \"lazy_us\": { \"open\": %.1f, \"first_frame\": %.1f, \"middle_frame\": %.1f } }",
+                                 result.open[1] / 1e3, result.first_frame[1] / 1e3, result.middle_frame[1] / 1e3);
+        json += (i + 1 < results.size()) ? ",\n" : "\n";
+    }
+
+    json += "  ]\n}\n";
+
+    return json;
+}
+
+//--------------------------------------------------------------
+std::string ofApp::toJSON(const std::vector<BenchCPUResult>& results)
+{
+    const HPV::HPVEncoderSettings& settings = m_settings.encoder;
+    std::string json = "{\n";
+
+    json += ofVAArgsToString("  \"machine\": { \"cores\": %u },\n", std::thread::hardware_concurrency());
+    json += ofVAArgsToString("  \"file\": { \"width\": %u, \"height\": %u, \"type\": \"%s\", \"fps\": %u, \"frames\": %u, \"read_mode\": \"%s\" },\n",
+                             settings.width, settings.height, TYPE_NAMES[static_cast<int>(settings.compression_type)], settings.frame_rate,
+                             m_settings.num_frames, READ_MODE_NAMES[static_cast<int>(m_settings.read_mode)]);
+    json += "  \"cpu_ms_per_s\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchCPUResult& result = results[i];
+
+        json += ofVAArgsToString("    { \"model\": \"%s\", \"players\": %u, \"paused\": %.3f, \"playing\": %.3f }",
+                                 MODEL_NAMES[static_cast<int>(result.model)], result.num_players, result.paused, result.playing);
+        json += (i + 1 < results.size()) ? ",\n" : "\n";
+    }
+
+    json += "  ]\n}\n";
+
+    return json;
+}
+
+//--------------------------------------------------------------
+std::string ofApp::toJSON(const std::vector<BenchUpdateResult>& results)
+{
+    const HPV::HPVEncoderSettings& settings = m_settings.encoder;
+    std::string json = "{\n";
+
+    json += ofVAArgsToString("  \"machine\": { \"cores\": %u },\n", std::thread::hardware_concurrency());
+    json += ofVAArgsToString("  \"file\": { \"width\": %u, \"height\": %u, \"type\": \"%s\", \"fps\": %u, \"frames\": %u, \"read_mode\": \"%s\" },\n",
+                             settings.width, settings.height, TYPE_NAMES[static_cast<int>(settings.compression_type)], settings.frame_rate,
+                             m_settings.num_frames, READ_MODE_NAMES[static_cast<int>(m_settings.read_mode)]);
+    json += "  \"update\": [\n";
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchUpdateResult& result = results[i];
+
+        json += ofVAArgsToString("    { \"model\": \"%s\", \"players\": %u, \"calls\": %" PRIu64 ", \"us_per_update\": %.3f }",
+                                 MODEL_NAMES[static_cast<int>(result.model)], result.num_players, result.num_calls, result.update / 1e3);
+        json += (i + 1 < results.size()) ? ",\n" : "\n";
+    }
+
+    json += "  ]\n}\n";
+
+    return json;
+}
+
+//--------------------------------------------------------------
+void ofApp::setup()
+{
+    HPV::hpv_log_set_level(HPV_LOG_LEVEL_WARNING);
+
+    if (!parseArguments())
+    {
+        printUsage();
+        ofExit(EXIT_FAILURE);
+        return;
+    }
+
+    // -check and -open run with the first model, the benchmark runs set theirs
+    HPV::ManagerSingleton()->setThreadingModel(m_settings.models.front(), m_settings.num_threads);
+
+    if (!m_settings.checks.empty())
+    {
+        ofExit(runChecks() ? EXIT_SUCCESS : EXIT_FAILURE);
+        return;
+    }
+
+    std::string json;
+
+    if (!m_settings.open_lengths.empty())
+    {
+        std::vector<BenchOpenResult> results;
+
+        for (uint32_t num_frames : m_settings.open_lengths)
+        {
+            BenchOpenResult result = runOpen(num_frames);
+            results.push_back(result);
+
+            fprintf(stderr, "%10u frames %9.1f MB | open eager %9.1f lazy %7.1f us | first frame eager %9.1f lazy %7.1f us | middle frame eager %7.1f lazy %9.1f us\n",
+                    num_frames, result.num_bytes / 1e6, result.open[0] / 1e3, result.open[1] / 1e3,
+                    result.first_frame[0] / 1e3, result.first_frame[1] / 1e3, result.middle_frame[0] / 1e3, result.middle_frame[1] / 1e3);
+        }
+
+        json = toJSON(results);
+    }
+    else if (m_settings.cpu_players)
+    {
+        // one file for all players: this measures the players, not the disk
+        if (!generateFiles(1))
+        {
+            removeFiles();
+            ofExit(EXIT_FAILURE);
+            return;
+        }
+
+        std::vector<BenchCPUResult> results;
+
+        for (HPV::HPVThreadingModel model : m_settings.models)
+        {
+            BenchCPUResult result = runCPU(model, m_settings.cpu_players);
+            results.push_back(result);
+
+            fprintf(stderr, "%-10s %3u player(s): %8.3f ms/s per player paused, %8.3f ms/s per player playing at %u fps\n",
+                    MODEL_NAMES[static_cast<int>(model)], result.num_players, result.paused, result.playing, m_settings.encoder.frame_rate);
+        }
+
+        removeFiles();
+
+        json = toJSON(results);
+    }
+    else if (!m_settings.update_counts.empty())
+    {
+        if (!generateFiles(1))
+        {
+            removeFiles();
+            ofExit(EXIT_FAILURE);
+            return;
+        }
+
+        std::vector<BenchUpdateResult> results;
+
+        for (HPV::HPVThreadingModel model : m_settings.models)
+        {
+            for (uint32_t num_players : m_settings.update_counts)
+            {
+                BenchUpdateResult result = runUpdate(model, num_players);
+                results.push_back(result);
+
+                fprintf(stderr, "%-10s %3u player(s): %8.3f us per update()\n",
+                        MODEL_NAMES[static_cast<int>(model)], num_players, result.update / 1e3);
+            }
+        }
+
+        removeFiles();
+
+        json = toJSON(results);
+    }
+    else
+    {
+        uint32_t max_players = *std::max_element(m_settings.player_counts.begin(), m_settings.player_counts.end());
+
+        if (!generateFiles(max_players))
+        {
+            removeFiles();
+            ofExit(EXIT_FAILURE);
+            return;
+        }
+
+        std::vector<BenchResult> results;
+
+        for (HPV::HPVThreadingModel model : m_settings.models)
+        {
+            for (BenchPattern pattern : m_settings.patterns)
+            {
+                for (uint32_t num_players : m_settings.player_counts)
+                {
+                    BenchResult result = run(model, pattern, num_players);
+                    results.push_back(result);
+
+                    fprintf(stderr, "%-10s %-10s %3u player(s): %8.1f fps %8.1f MB/s | read p50 %7.1f p99 %7.1f us | decode p50 %7.1f p99 %7.1f us\n",
+                            MODEL_NAMES[static_cast<int>(model)], PATTERN_NAMES[static_cast<int>(pattern)], num_players,
+                            result.num_frames / result.seconds, result.num_bytes / result.seconds / 1e6,
+                            result.read.p50 / 1e3, result.read.p99 / 1e3, result.decode.p50 / 1e3, result.decode.p99 / 1e3);
+                }
+            }
+        }
+
+        removeFiles();
+
+        json = toJSON(results);
+    }
+
+    if (m_settings.json_file.empty())
+    {
+        fputs(json.c_str(), stdout);
+    }
+    else if (!ofBufferToFile(m_settings.json_file, ofBuffer(json.c_str(), json.size())))
+    {
+        fprintf(stderr, "Couldn't write %s\n", m_settings.json_file.c_str());
+        ofExit(EXIT_FAILURE);
+        return;
+    }
+
+    ofExit();
+}
+
+//--------------------------------------------------------------
+void ofApp::update()
+{
+}
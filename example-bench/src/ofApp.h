@@ -0,0 +1,130 @@
+#pragma once
+
+#include "ofMain.h"
+#include "HPVManager.h"
+#include "HPVEncoder.h"
+#include "Log.h"
+#include "Timer.h"
+#include "BenchChecks.h"
+
+/* Access patterns, each run plays or seeks all players with one of these */
+enum class BenchPattern : std::uint8_t
+{
+    BENCH_SEQUENTIAL = 0,
+    BENCH_REVERSE,
+    BENCH_PALINDROME,
+    BENCH_RANDOM_SEEK,
+    BENCH_NUM_PATTERNS = 4
+};
+
+/* Pass/fail checks, run with -check instead of the benchmark */
+enum class BenchCheck : std::uint8_t
+{
+    BENCH_CHECK_SCHEDULER = 0,
+    BENCH_CHECK_ALLOCATIONS,
+    BENCH_CHECK_TEARING,
+    BENCH_NUM_CHECKS = 3
+};
+
+struct BenchSettings
+{
+    HPV::HPVEncoderSettings     encoder;
+    float                       entropy = 0.25f;    /* share of noise pixels: 0 compresses best, 1 not at all */
+    uint32_t                    num_frames = 240;
+    std::vector<uint32_t>       player_counts = { 1 };
+    std::vector<HPV::HPVThreadingModel> models = { HPV::HPVThreadingModel::HPV_THREADS_POOL };
+    std::vector<BenchPattern>   patterns = { BenchPattern::BENCH_SEQUENTIAL, BenchPattern::BENCH_REVERSE, BenchPattern::BENCH_PALINDROME, BenchPattern::BENCH_RANDOM_SEEK };
+    HPV::HPVReadMode            read_mode = HPV::HPVReadMode::HPV_READ_STREAM;
+    HPV::HPVIndexMode           index_mode = HPV::HPVIndexMode::HPV_INDEX_AUTO;
+    std::vector<uint32_t>       open_lengths;       /* not empty: time open() against these file lengths instead of playing */
+    uint32_t                    cpu_players = 0;    /* not 0: measure the CPU time of this many paused and playing players instead */
+    std::vector<uint32_t>       update_counts;      /* not empty: time HPVManager::update() with this many playing players instead */
+    std::vector<BenchCheck>     checks;             /* not empty: run these checks instead of the benchmark */
+    unsigned                    num_threads = 0;
+    double                      seconds = 3.0;
+    bool                        cold = false;       /* drop the files from the page cache before every run */
+    std::string                 dir;
+    std::string                 json_file;
+};
+
+/* Latency percentiles of one run, in ns */
+struct BenchLatency
+{
+    std::size_t     count = 0;
+    uint64_t        p50 = 0;
+    uint64_t        p99 = 0;
+    uint64_t        p999 = 0;
+    uint64_t        max = 0;
+};
+
+struct BenchResult
+{
+    HPV::HPVThreadingModel model;
+    BenchPattern    pattern;
+    uint32_t        num_players;
+    double          seconds;
+    uint64_t        num_frames;
+    uint64_t        num_bytes;
+    BenchLatency    read;
+    BenchLatency    decode;
+    BenchLatency    seek;       /* random seeks: seek() call to decoded frame */
+};
+
+/* Open latency of one file length, medians in ns */
+struct BenchOpenResult
+{
+    uint32_t        num_frames;
+    uint64_t        num_bytes;
+    uint64_t        open[2];            /* open(), eager and lazy index */
+    uint64_t        first_frame[2];     /* open() until the frame after the first is decoded */
+    uint64_t        middle_frame[2];    /* a jump to the middle of the file after that */
+};
+
+/* CPU time of the players of one threading model, in ms per second per player */
+struct BenchCPUResult
+{
+    HPV::HPVThreadingModel model;
+    uint32_t        num_players;
+    double          paused;
+    double          playing;            /* at the frame rate of the file, looping */
+};
+
+/* Cost of HPVManager::update() with a number of playing players */
+struct BenchUpdateResult
+{
+    HPV::HPVThreadingModel model;
+    uint32_t        num_players;
+    uint64_t        num_calls;
+    double          update;             /* mean, in ns */
+};
+
+class ofApp : public ofBaseApp
+{
+public:
+    ofApp(const std::vector<std::string>& args);
+    
+	void setup();
+	void update();
+    
+private:
+    bool parseArguments();
+    void printUsage();
+    
+    bool generateFiles(uint32_t num_files);
+    void removeFiles();
+    void dropFromCache();
+    BenchResult run(HPV::HPVThreadingModel model, BenchPattern pattern, uint32_t num_players);
+    BenchOpenResult runOpen(uint32_t num_frames);
+    BenchCPUResult runCPU(HPV::HPVThreadingModel model, uint32_t num_players);
+    BenchUpdateResult runUpdate(HPV::HPVThreadingModel model, uint32_t num_players);
+    bool runChecks();
+    std::string toJSON(const std::vector<BenchResult>& results);
+    std::string toJSON(const std::vector<BenchOpenResult>& results);
+    std::string toJSON(const std::vector<BenchCPUResult>& results);
+    std::string toJSON(const std::vector<BenchUpdateResult>& results);
+    
+    std::vector<std::string> m_args;
+    BenchSettings m_settings;
+    std::vector<std::string> m_files;
+    uint64_t m_file_size;
+};
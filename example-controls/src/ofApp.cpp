@@ -12,10 +12,14 @@ void ofApp::setup()
     b_draw_stats = b_draw_gui = true;
     hpvPlayer.init(HPV::NewPlayer());
     
+    // keep the last 512 MB of frames, so scrubbing back and forth over the range slider doesn't hit the disk
+    hpvPlayer.setFrameCacheSize(512 * 1024 * 1024);
+    
     if (hpvPlayer.load("bbb_export.hpv"))
     {
         hpvPlayer.setLoopState(OF_LOOP_NORMAL);
         hpvPlayer.setDoubleBuffered(db);
+        hpvPlayer.setVerifyFrames(true);
         hpvPlayer.play();
         
         if (hpvPlayer.getFrameRate() > 60)
@@ -77,20 +81,23 @@ void ofApp::draw()
     
     if (b_draw_stats)
     {
+        HPVDecodeStats stats = hpvPlayer.getDecodeStats();
         std::stringstream ss;
         ss << "DOUBLE BUFFER: " << (db ? "ON" : "OFF")
         << " ('d' toggles)"
         << std::endl
-        << "HDD: " << hpvPlayer.getDecodeStatsPtr()->hdd_read_time / 1e6 << "ms"
+        << "HDD: " << stats.hdd_read_time / 1e6 << "ms"
         << std::endl
-        << "L4Z: " << hpvPlayer.getDecodeStatsPtr()->l4z_decode_time / 1e6 << "ms"
+        << "L4Z: " << stats.l4z_decode_time / 1e6 << "ms"
         << std::endl
-        << "GPU: " << hpvPlayer.getDecodeStatsPtr()->gpu_upload_time / 1e6 << "ms"
+        << "GPU: " << stats.gpu_upload_time / 1e6 << "ms"
         << std::endl
-        << "TOT: " << (hpvPlayer.getDecodeStatsPtr()->hdd_read_time+hpvPlayer.getDecodeStatsPtr()->l4z_decode_time+hpvPlayer.getDecodeStatsPtr()->gpu_upload_time) / 1e6
+        << "TOT: " << (stats.hdd_read_time+stats.l4z_decode_time+stats.gpu_upload_time) / 1e6
         << std::endl
         << "FRAME: " << hpvPlayer.getCurrentFrame()
         << std::endl
+        << "CACHE: " << hpvPlayer.getNumFrameCacheHits() << " hits / " << hpvPlayer.getNumFrameCacheMisses() << " misses"
+        << std::endl
         << "SPEED: " << hpvPlayer.getSpeed()
         << std::endl
         << "DURATION: " << hpvPlayer.getDuration()
@@ -190,6 +197,9 @@ void ofApp::onHPVEvent(const HPVEvent& event)
         case HPV::HPVEventType::HPV_EVENT_LOOP:
             cout << "'" << event.player->getFilename() << "': loop event" << endl;
             break;
+        case HPV::HPVEventType::HPV_EVENT_CORRUPT_FRAME:
+            cout << "'" << event.player->getFilename() << "': corrupt frame" << endl;
+            break;
         case HPV::HPVEventType::HPV_EVENT_NUM_TYPES:
         default:
             break;
@@ -222,7 +232,7 @@ void ofApp::mouseDragged(int x, int y, int button)
         
         if (frame != prev_frame)
         {
-            hpvPlayer.seekToFrame(frame);
+            hpvPlayer.seekToFrameAsync(frame);
             prev_frame = frame;
         }
     }
@@ -342,7 +352,7 @@ void ofApp::mousePressed(int x, int y, int button)
             
             if (frame != prev_frame)
             {
-                hpvPlayer.seekToFrame(frame);
+                hpvPlayer.seekToFrameAsync(frame);
                 prev_frame = frame;
             }
         }
@@ -0,0 +1,223 @@
+#include "ofApp.h"
+
+/* Image types the encoder accepts, everything ofLoadImage() can read */
+static const char * IMAGE_EXTENSIONS[] = { "png", "jpeg", "jpg", "tga", "gif", "bmp", "psd", "hdr", "pic", "ppm", "pgm", "tif", "tiff", "exr" };
+
+//--------------------------------------------------------------
+ofApp::ofApp(const std::vector<std::string>& args)
+: m_args(args)
+{
+}
+
+//--------------------------------------------------------------
+void ofApp::printUsage()
+{
+    printf("usage: example-encoder <image folder> <output.hpv> [options]\n"
+           "  -fps <n>                  frame rate (30)\n"
+           "  -type <dxt1|dxt5|cocgy>   DXT1 no alpha, DXT5 with alpha or scaled DXT5 CoCg_Y (dxt1)\n"
+           "  -lz4 <0-16>               0 = fast LZ4, otherwise the LZ4 HC level (%d)\n"
+           "  -threads <n>              encoder threads (one per core)\n"
+           "  -align <bytes>            start every frame at a multiple of this, e.g. 4096 for unbuffered reads\n"
+           "  -slices <n>               split frames in n slices that are decompressed in parallel\n"
+           "  -tiles <columns>x<rows>   split frames in tiles, to decode only what is visible of 360 video\n"
+           "  -checksums <0|1>          store a CRC32C of every frame so players can detect corruption (1)\n"
+           "The images of the folder are encoded in alphabetical order.\n", HPV_LZ4_COMPRESSION_LEVEL);
+}
+
+//--------------------------------------------------------------
+bool ofApp::parseArguments(HPV::HPVEncoderSettings& settings)
+{
+    std::vector<std::string> positional;
+
+    for (std::size_t i = 0; i < m_args.size(); ++i)
+    {
+        const std::string& arg = m_args[i];
+
+        if (arg.empty() || arg[0] != '-')
+        {
+            positional.push_back(arg);
+            continue;
+        }
+
+        if (i + 1 >= m_args.size())
+        {
+            printf("Missing value for %s\n", arg.c_str());
+            return false;
+        }
+
+        const std::string& value = m_args[++i];
+
+        if (arg == "-fps")
+        {
+            settings.frame_rate = ofToInt(value);
+        }
+        else if (arg == "-type")
+        {
+            if (value == "dxt1")        settings.compression_type = HPV::HPVCompressionType::HPV_TYPE_DXT1_NO_ALPHA;
+            else if (value == "dxt5")   settings.compression_type = HPV::HPVCompressionType::HPV_TYPE_DXT5_ALPHA;
+            else if (value == "cocgy")  settings.compression_type = HPV::HPVCompressionType::HPV_TYPE_SCALED_DXT5_CoCg_Y;
+            else
+            {
+                printf("Unknown compression type %s\n", value.c_str());
+                return false;
+            }
+        }
+        else if (arg == "-lz4")
+        {
+            settings.lz4_level = ofToInt(value);
+        }
+        else if (arg == "-threads")
+        {
+            settings.num_threads = ofToInt(value);
+        }
+        else if (arg == "-align")
+        {
+            settings.frame_alignment = ofToInt(value);
+        }
+        else if (arg == "-slices")
+        {
+            settings.num_slices = ofToInt(value);
+        }
+        else if (arg == "-tiles")
+        {
+            std::vector<std::string> grid = ofSplitString(value, "x");
+
+            if (grid.size() != 2)
+            {
+                printf("Tiles are given as <columns>x<rows>, e.g. 8x4\n");
+                return false;
+            }
+
+            settings.tile_columns = ofToInt(grid[0]);
+            settings.tile_rows = ofToInt(grid[1]);
+        }
+        else if (arg == "-checksums")
+        {
+            settings.frame_checksums = (ofToInt(value) != 0);
+        }
+        else
+        {
+            printf("Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+
+    if (positional.size() != 2)
+    {
+        return false;
+    }
+
+    m_input_dir = positional[0];
+    m_output_file = positional[1];
+
+    return true;
+}
+
+//--------------------------------------------------------------
+void ofApp::setup()
+{
+    HPV::hpv_log_set_level(HPV_LOG_LEVEL_WARNING);
+
+    HPV::HPVEncoderSettings settings;
+
+    if (!parseArguments(settings))
+    {
+        printUsage();
+        ofExit(EXIT_FAILURE);
+        return;
+    }
+
+    ofDirectory dir(m_input_dir);
+
+    for (const char * extension : IMAGE_EXTENSIONS)
+    {
+        dir.allowExt(extension);
+    }
+
+    dir.listDir();
+    dir.sort();
+
+    if (0 == dir.size())
+    {
+        printf("No images found in %s\n", m_input_dir.c_str());
+        ofExit(EXIT_FAILURE);
+        return;
+    }
+
+    std::vector<std::string> files;
+    for (std::size_t i = 0; i < dir.size(); ++i)
+    {
+        files.push_back(dir.getPath(i));
+    }
+
+    // the first image sets the dimensions, the others have to match
+    ofPixels first;
+
+    if (!ofLoadImage(first, files[0]))
+    {
+        printf("Couldn't load %s\n", files[0].c_str());
+        ofExit(EXIT_FAILURE);
+        return;
+    }
+
+    settings.width = static_cast<uint32_t>(first.getWidth());
+    settings.height = static_cast<uint32_t>(first.getHeight());
+
+    printf("Encoding %zu images of %ux%u from %s\n", files.size(), settings.width, settings.height, m_input_dir.c_str());
+
+    // called on the encoder threads: every thread decodes its own images
+    HPV::HPVFrameSource source = [&files, &settings](uint32_t frame, unsigned char * rgba)
+    {
+        ofPixels pixels;
+
+        if (!ofLoadImage(pixels, files[frame]))
+        {
+            return HPV_RET_ERROR;
+        }
+
+        if (pixels.getWidth() != settings.width || pixels.getHeight() != settings.height)
+        {
+            ofLogError() << files[frame] << " is " << pixels.getWidth() << "x" << pixels.getHeight() << ", expected " << settings.width << "x" << settings.height;
+            return HPV_RET_ERROR;
+        }
+
+        pixels.setImageType(OF_IMAGE_COLOR_ALPHA);
+        memcpy(rgba, pixels.getData(), static_cast<std::size_t>(settings.width) * settings.height * 4);
+
+        return HPV_RET_ERROR_NONE;
+    };
+
+    uint32_t last_percent = 101;
+    HPV::HPVEncodeProgress progress = [&last_percent](uint32_t num_written, uint32_t num_frames)
+    {
+        uint32_t percent = static_cast<uint32_t>(100ull * num_written / num_frames);
+
+        if (percent != last_percent)
+        {
+            last_percent = percent;
+            printf("\r%3u%% (%u / %u frames)", percent, num_written, num_frames);
+            fflush(stdout);
+        }
+    };
+
+    HPV::HPVEncoder encoder;
+    uint64_t start = ns();
+
+    if (!encoder.encode(m_output_file, static_cast<uint32_t>(files.size()), settings, source, progress))
+    {
+        printf("\nFailed: %s\n", encoder.getLastError().c_str());
+        ofExit(EXIT_FAILURE);
+        return;
+    }
+
+    double seconds = (ns() - start) / 1e9;
+
+    printf("\nWrote %s: %.1f MB in %.1f s, %.1f frames/s\n", m_output_file.c_str(), encoder.getNumBytesWritten() / 1e6, seconds, files.size() / seconds);
+
+    ofExit();
+}
+
+//--------------------------------------------------------------
+void ofApp::update()
+{
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ofMain.h"
+#include "HPVEncoder.h"
+#include "Log.h"
+#include "Timer.h"
+
+class ofApp : public ofBaseApp
+{
+public:
+    ofApp(const std::vector<std::string>& args);
+    
+	void setup();
+	void update();
+    
+private:
+    bool parseArguments(HPV::HPVEncoderSettings& settings);
+    void printUsage();
+    
+    std::vector<std::string> m_args;
+    std::string m_input_dir;
+    std::string m_output_file;
+};
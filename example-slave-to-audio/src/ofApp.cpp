@@ -9,8 +9,11 @@ void ofApp::setup()
     hpvPlayer.init(HPV::NewPlayer());
     if (hpvPlayer.load("bbb_export.hpv"))
     {
+        // the video shows the frame at the time of the audio, the player predicts which one is next
+        audioClock = std::make_shared<HPV::HPVSystemClock>();
+        hpvPlayer.setClock(audioClock);
         hpvPlayer.setLoopState(OF_LOOP_NORMAL);
-        hpvPlayer.setPaused(true);
+        hpvPlayer.play();
         
         if (hpvPlayer.getFrameRate() > 60)
         {
@@ -33,7 +36,11 @@ void ofApp::setup()
 //--------------------------------------------------------------
 void ofApp::update()
 {
-    hpvPlayer.seekToPos(soundPlayer.getPosition());
+    // the sound position only moves per audio buffer, the player smooths it out
+    if (audioClock)
+    {
+        audioClock->setTime(soundPlayer.getPositionMS() / 1000.0, soundPlayer.isPlaying() ? soundPlayer.getSpeed() : 0.0);
+    }
     HPV::Update();    
 }
 
@@ -17,4 +17,5 @@ public:
     
 	ofxHPVPlayer hpvPlayer;
     ofSoundPlayer soundPlayer;
+    std::shared_ptr<HPV::HPVSystemClock> audioClock;
 };
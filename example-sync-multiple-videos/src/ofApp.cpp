@@ -3,9 +3,8 @@
 int SIDE_WIDTH;
 int SIDE_HEIGHT;
 
-static int64_t prev_frame = 0;
-static int64_t cur_frame = 0;
 static uint8_t offset = 1;
+static bool paused = false;
 
 //--------------------------------------------------------------
 void ofApp::setup()
@@ -33,10 +32,13 @@ void ofApp::setup()
     bottom_left.play();
     bottom_right.play();
     
-    top_left.setPaused(true);
-    top_right.setPaused(true);
-    bottom_left.setPaused(true);
-    bottom_right.setPaused(true);
+    // one clock for all four, a frame is only shown once all of them have it
+    group = HPV::NewPlayerGroup();
+    group->add(top_left.getHPVPlayer());
+    group->add(top_right.getHPVPlayer());
+    group->add(bottom_left.getHPVPlayer());
+    group->add(bottom_right.getHPVPlayer());
+    group->play();
     
     ofSetVerticalSync(false);
     ofSetFrameRate(120);
@@ -50,24 +52,6 @@ void ofApp::update()
 {
     ofSetWindowTitle(ofToString(ofGetFrameRate()));
     
-    
-    if (cur_frame != prev_frame)
-    {
-        top_left.seekToFrame(cur_frame);
-        top_right.seekToFrame(cur_frame);
-        bottom_left.seekToFrame(cur_frame);
-        bottom_right.seekToFrame(cur_frame);
-        
-        prev_frame = cur_frame;
-    }
-    
-    cur_frame++;
-    
-    if (cur_frame >= top_left.getTotalNumFrames())
-    {
-        cur_frame = 0;
-    }
-    
     HPV::Update();
 }
 
@@ -100,14 +84,14 @@ void ofApp::keyPressed(int key)
 {
     if (key == 'a')
     {
-        cur_frame++;
+        paused = true;
+        group->pause();
+        group->seek(group->getPresentedFrame() + 1);
     }
     else if (key == 'p')
     {
-        top_left.setPaused(true);
-        top_right.setPaused(true);
-        bottom_left.setPaused(true);
-        bottom_right.setPaused(true);
+        paused = !paused;
+        paused ? group->pause() : group->play();
     }
     else if (key == 'f')
     {
@@ -18,4 +18,5 @@ public:
     ofxHPVPlayer top_right;
     ofxHPVPlayer bottom_left;
     ofxHPVPlayer bottom_right;
+    HPV::HPVPlayerGroupRef group;
 };
@@ -0,0 +1,260 @@
+#include <string.h>
+
+#include "HPVChecksum.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define HPV_CRC_X64 1
+#   include <nmmintrin.h>
+#   if defined(_MSC_VER) && !defined(__clang__)
+#       include <intrin.h>
+#       define HPV_TARGET_SSE42
+#   else
+#       define HPV_TARGET_SSE42 __attribute__((target("sse4.2")))
+#   endif
+#endif
+
+#define HPV_CRC32C_POLY 0x82f63b78      /* reflected Castagnoli polynomial */
+#define HPV_CRC32C_LONG 8192            /* the hardware path runs three streams over blocks of this size... */
+#define HPV_CRC32C_SHORT 256            /* ...and of this size for what is left */
+
+namespace HPV {
+
+    /* 32x32 matrices over GF(2), one column per bit, to shift a CRC over runs of zeros */
+    static uint32_t GF2MatrixTimes(const uint32_t * mat, uint32_t vec)
+    {
+        uint32_t sum = 0;
+
+        while (vec)
+        {
+            if (vec & 1)
+            {
+                sum ^= *mat;
+            }
+
+            vec >>= 1;
+            ++mat;
+        }
+
+        return sum;
+    }
+
+    static void GF2MatrixSquare(uint32_t * square, const uint32_t * mat)
+    {
+        for (int n = 0; n < 32; ++n)
+        {
+            square[n] = GF2MatrixTimes(mat, mat[n]);
+        }
+    }
+
+    struct CRC32CTables
+    {
+        uint32_t    table[8][256];          /* slicing-by-8 */
+        uint32_t    shift_long[4][256];     /* a CRC shifted over HPV_CRC32C_LONG zero bytes, per byte of the CRC */
+        uint32_t    shift_short[4][256];
+
+        CRC32CTables()
+        {
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t crc = n;
+
+                for (int k = 0; k < 8; ++k)
+                {
+                    crc = (crc & 1) ? (crc >> 1) ^ HPV_CRC32C_POLY : crc >> 1;
+                }
+
+                table[0][n] = crc;
+            }
+
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                for (int k = 1; k < 8; ++k)
+                {
+                    table[k][n] = (table[k - 1][n] >> 8) ^ table[0][table[k - 1][n] & 0xff];
+                }
+            }
+
+            buildShift(shift_long, HPV_CRC32C_LONG);
+            buildShift(shift_short, HPV_CRC32C_SHORT);
+        }
+
+        static void buildShift(uint32_t shift[4][256], std::size_t len)
+        {
+            uint32_t even[32];
+            uint32_t odd[32];
+
+            // operator for one zero bit, squared to 2, 4, 8 ... zero bits until it covers 'len' bytes
+            odd[0] = HPV_CRC32C_POLY;
+            for (int n = 1; n < 32; ++n)
+            {
+                odd[n] = uint32_t(1) << (n - 1);
+            }
+
+            GF2MatrixSquare(even, odd);
+            GF2MatrixSquare(odd, even);
+
+            const uint32_t * op = odd;
+
+            do
+            {
+                GF2MatrixSquare(even, odd);
+                len >>= 1;
+                op = even;
+
+                if (0 == len)
+                {
+                    break;
+                }
+
+                GF2MatrixSquare(odd, even);
+                len >>= 1;
+                op = odd;
+            }
+            while (len);
+
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                shift[0][n] = GF2MatrixTimes(op, n);
+                shift[1][n] = GF2MatrixTimes(op, n << 8);
+                shift[2][n] = GF2MatrixTimes(op, n << 16);
+                shift[3][n] = GF2MatrixTimes(op, n << 24);
+            }
+        }
+    };
+
+    static const CRC32CTables CRC_TABLES;
+
+    static inline uint32_t ShiftCRC(const uint32_t shift[4][256], uint32_t crc)
+    {
+        return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^ shift[2][(crc >> 16) & 0xff] ^ shift[3][crc >> 24];
+    }
+
+    static uint32_t CRC32CSoftware(const unsigned char * data, std::size_t size, uint32_t crc)
+    {
+        const uint32_t (*t)[256] = CRC_TABLES.table;
+        uint64_t crc64 = ~crc;
+
+        while (size && (reinterpret_cast<uintptr_t>(data) & 7))
+        {
+            crc64 = t[0][(crc64 ^ *data++) & 0xff] ^ (crc64 >> 8);
+            --size;
+        }
+
+        while (size >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, data, 8);
+            word ^= crc64;
+
+            crc64 = t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^ t[4][(word >> 24) & 0xff]
+                  ^ t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^ t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+
+            data += 8;
+            size -= 8;
+        }
+
+        while (size--)
+        {
+            crc64 = t[0][(crc64 ^ *data++) & 0xff] ^ (crc64 >> 8);
+        }
+
+        return ~static_cast<uint32_t>(crc64);
+    }
+
+#if defined(HPV_CRC_X64)
+    /*
+     *  The crc32 instruction has a latency of 3 cycles but can start one every cycle, so large buffers are
+     *  done as three interleaved streams whose CRCs are combined by shifting them over the bytes that follow
+     */
+    HPV_TARGET_SSE42 static uint32_t CRC32CHardware(const unsigned char * data, std::size_t size, uint32_t crc)
+    {
+        uint64_t crc0 = ~crc;
+
+        while (size && (reinterpret_cast<uintptr_t>(data) & 7))
+        {
+            crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data++);
+            --size;
+        }
+
+        const std::size_t block_sizes[2] = { HPV_CRC32C_LONG, HPV_CRC32C_SHORT };
+        const uint32_t (*shifts[2])[256] = { CRC_TABLES.shift_long, CRC_TABLES.shift_short };
+
+        for (int b = 0; b < 2; ++b)
+        {
+            const std::size_t block = block_sizes[b];
+
+            while (size >= 3 * block)
+            {
+                uint64_t crc1 = 0;
+                uint64_t crc2 = 0;
+                const unsigned char * end = data + block;
+
+                do
+                {
+                    crc0 = _mm_crc32_u64(crc0, *reinterpret_cast<const uint64_t *>(data));
+                    crc1 = _mm_crc32_u64(crc1, *reinterpret_cast<const uint64_t *>(data + block));
+                    crc2 = _mm_crc32_u64(crc2, *reinterpret_cast<const uint64_t *>(data + 2 * block));
+                    data += 8;
+                }
+                while (data < end);
+
+                crc0 = ShiftCRC(shifts[b], static_cast<uint32_t>(crc0)) ^ crc1;
+                crc0 = ShiftCRC(shifts[b], static_cast<uint32_t>(crc0)) ^ crc2;
+                data += 2 * block;
+                size -= 3 * block;
+            }
+        }
+
+        while (size >= 8)
+        {
+            crc0 = _mm_crc32_u64(crc0, *reinterpret_cast<const uint64_t *>(data));
+            data += 8;
+            size -= 8;
+        }
+
+        while (size--)
+        {
+            crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data++);
+        }
+
+        return ~static_cast<uint32_t>(crc0);
+    }
+
+    static bool DetectSSE42()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 20)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2");
+#endif
+    }
+
+    static const bool HAS_SSE42 = DetectSSE42();
+#endif
+
+    bool HasHardwareCRC32C()
+    {
+#if defined(HPV_CRC_X64)
+        return HAS_SSE42;
+#else
+        return false;
+#endif
+    }
+
+    uint32_t CRC32C(const void * data, std::size_t size, uint32_t crc)
+    {
+        const unsigned char * bytes = static_cast<const unsigned char *>(data);
+
+#if defined(HPV_CRC_X64)
+        if (HAS_SSE42)
+        {
+            return CRC32CHardware(bytes, size, crc);
+        }
+#endif
+        return CRC32CSoftware(bytes, size, crc);
+    }
+
+} /* End HPV namespace */
@@ -0,0 +1,71 @@
+#include "HPVClock.h"
+#include "Timer.h"
+
+namespace HPV {
+
+    HPVSystemClock::HPVSystemClock(double time, double rate)
+    : _time(time)
+    , _rate(rate)
+    , _time_ns(ns())
+    {
+    }
+
+    double HPVSystemClock::getTime()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        return _time + _rate * (ns() - _time_ns) / 1e9;
+    }
+
+    double HPVSystemClock::getRate()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        return _rate;
+    }
+
+    void HPVSystemClock::setTime(double time)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        _time = time;
+        _time_ns = ns();
+    }
+
+    void HPVSystemClock::setTime(double time, double rate)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        _time = time;
+        _rate = rate;
+        _time_ns = ns();
+    }
+
+    void HPVSystemClock::setRate(double rate)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        // keep the time where it is, only what follows runs at the new rate
+        uint64_t now = ns();
+        _time += _rate * (now - _time_ns) / 1e9;
+        _rate = rate;
+        _time_ns = now;
+    }
+
+    HPVCallbackClock::HPVCallbackClock(std::function<double()> get_time, std::function<double()> get_rate)
+    : _get_time(get_time)
+    , _get_rate(get_rate)
+    {
+    }
+
+    double HPVCallbackClock::getTime()
+    {
+        return _get_time();
+    }
+
+    double HPVCallbackClock::getRate()
+    {
+        return _get_rate ? _get_rate() : 1.0;
+    }
+
+} /* End HPV namespace */
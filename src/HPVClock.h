@@ -0,0 +1,78 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+#define HPV_CLOCK_MAX_ERROR         0.1     /* seconds a clock may be off from where the player predicted it before it counts as a jump */
+#define HPV_CLOCK_SMOOTHING         0.1     /* part of the prediction error corrected per sample, filters out a coarse audio position */
+
+namespace HPV {
+
+    /*
+     *  HPVClock: a source of media time a player can follow instead of its own frame rate, see HPVPlayer::setClock().
+     *  The player samples it from the thread that steps it (once per frame), so implementations have to be
+     *  thread-safe and cheap.
+     */
+    class HPVClock
+    {
+    public:
+        virtual ~HPVClock() {}
+
+        virtual double      getTime() = 0;                  /* seconds since the first frame of the file */
+        virtual double      getRate() { return 1.0; }       /* seconds of media time per second, 0 when stopped */
+    };
+
+    typedef std::shared_ptr<HPVClock> HPVClockRef;
+
+    /*
+     *  HPVSystemClock: runs on ns() at a given rate. setTime() moves it, which is also how timestamps that come from
+     *  elsewhere (an audio position polled on the main thread, timecode, ...) are pushed: in between two calls the
+     *  clock runs on by itself, so the player doesn't depend on how often they come in.
+     */
+    class HPVSystemClock : public HPVClock
+    {
+    public:
+        HPVSystemClock(double time = 0.0, double rate = 1.0);
+
+        double              getTime() override;
+        double              getRate() override;
+
+        void                setTime(double time);
+        void                setTime(double time, double rate);
+        void                setRate(double rate);
+
+    private:
+        double              _time;                          /* at _time_ns */
+        double              _rate;
+        uint64_t            _time_ns;
+        std::mutex          _mtx;
+    };
+
+    /*
+     *  HPVCallbackClock: asks a function for the time, e.g. one that counts the samples an audio callback played.
+     *  Both functions are called on the player's thread. Without a rate function the rate is 1.
+     */
+    class HPVCallbackClock : public HPVClock
+    {
+    public:
+        HPVCallbackClock(std::function<double()> get_time, std::function<double()> get_rate = nullptr);
+
+        double              getTime() override;
+        double              getRate() override;
+
+    private:
+        std::function<double()> _get_time;
+        std::function<double()> _get_rate;
+    };
+
+} /* End HPV namespace */
@@ -0,0 +1,927 @@
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+
+#include "HPVDXT.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define HPV_DXT_X86 1
+#   include <immintrin.h>
+#endif
+
+// the palette helpers are shared by all paths: inlined they take on the instruction set of the caller,
+// called from AVX2 code they would be SSE code with the cost of switching between the two on every block
+#if defined(_MSC_VER) && !defined(__clang__)
+#   define HPV_FORCE_INLINE __forceinline
+#else
+#   define HPV_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+#if defined(HPV_DXT_X86)
+#   if defined(_MSC_VER) && !defined(__clang__)
+#       include <intrin.h>
+#       define HPV_TARGET_SSSE3
+#       define HPV_TARGET_AVX2
+#   else
+#       define HPV_TARGET_SSSE3 __attribute__((target("ssse3")))
+#       define HPV_TARGET_AVX2 __attribute__((target("avx2")))
+#   endif
+#endif
+
+namespace HPV {
+
+    static inline uint16_t PackRGB565(const float * rgb, int fixed_blue)
+    {
+        int r = std::min(31, std::max(0, static_cast<int>(rgb[0] * (31.0f / 255.0f) + 0.5f)));
+        int g = std::min(63, std::max(0, static_cast<int>(rgb[1] * (63.0f / 255.0f) + 0.5f)));
+        int b = (fixed_blue >= 0) ? fixed_blue : std::min(31, std::max(0, static_cast<int>(rgb[2] * (31.0f / 255.0f) + 0.5f)));
+
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    static inline void UnpackRGB565(uint16_t color, float * rgb)
+    {
+        int r = (color >> 11) & 31;
+        int g = (color >> 5) & 63;
+        int b = color & 31;
+
+        rgb[0] = static_cast<float>((r << 3) | (r >> 2));
+        rgb[1] = static_cast<float>((g << 2) | (g >> 4));
+        rgb[2] = static_cast<float>((b << 3) | (b >> 2));
+    }
+
+    static inline float DistanceSq(const float * a, const float * b)
+    {
+        float dr = a[0] - b[0];
+        float dg = a[1] - b[1];
+        float db = a[2] - b[2];
+
+        return dr * dr + dg * dg + db * db;
+    }
+
+    /*
+     *  Picks the nearest palette entry for every pixel of a 4-color block (c0 > c1) or a single color block (c0 == c1).
+     *  Returns the squared error, the indices go to 'indices'. The palette lies on a line with evenly spaced
+     *  entries, so the nearest entry is the one nearest to the projection of the pixel on that line.
+     */
+    static float PickColorIndices(const float colors[16][3], uint16_t c0, uint16_t c1, uint32_t * indices)
+    {
+        float palette[4][3];
+        UnpackRGB565(c0, palette[0]);
+        UnpackRGB565(c1, palette[1]);
+
+        for (int ch = 0; ch < 3; ++ch)
+        {
+            palette[2][ch] = (2.0f * palette[0][ch] + palette[1][ch]) / 3.0f;
+            palette[3][ch] = (palette[0][ch] + 2.0f * palette[1][ch]) / 3.0f;
+        }
+
+        float dir[3] = { palette[0][0] - palette[1][0], palette[0][1] - palette[1][1], palette[0][2] - palette[1][2] };
+        float len_sq = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+        float scale = (c0 == c1) ? 0.0f : 3.0f / len_sq;
+
+        // steps from c1 (0) to c0 (3) -> index
+        static const uint32_t step_index[4] = { 1, 3, 2, 0 };
+
+        float error = 0.0f;
+        *indices = 0;
+
+        for (int i = 0; i < 16; ++i)
+        {
+            float t = ((colors[i][0] - palette[1][0]) * dir[0] + (colors[i][1] - palette[1][1]) * dir[1] + (colors[i][2] - palette[1][2]) * dir[2]) * scale;
+            int step = std::min(3, std::max(0, static_cast<int>(t + 0.5f)));
+            uint32_t index = (c0 == c1) ? 0 : step_index[step];
+
+            *indices |= index << (2 * i);
+            error += DistanceSq(colors[i], palette[index]);
+        }
+
+        return error;
+    }
+
+    /*
+     *  Endpoints for 'colors' along their principal axis, refined with a least squares fit to the chosen indices.
+     *  Writes an 8 byte 4-color block. 'fixed_blue' >= 0 forces the 5 blue bits of both endpoints.
+     */
+    static void CompressColorBlock(const float colors[16][3], int fixed_blue, unsigned char * dst)
+    {
+        float mean[3] = { 0.0f, 0.0f, 0.0f };
+
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int ch = 0; ch < 3; ++ch)
+            {
+                mean[ch] += colors[i][ch] / 16.0f;
+            }
+        }
+
+        // covariance: rr, rg, rb, gg, gb, bb
+        float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+        for (int i = 0; i < 16; ++i)
+        {
+            float r = colors[i][0] - mean[0];
+            float g = colors[i][1] - mean[1];
+            float b = colors[i][2] - mean[2];
+
+            cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+            cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+        }
+
+        // power iteration for the principal axis
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+
+        for (int iter = 0; iter < 6; ++iter)
+        {
+            float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+            float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+            float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+
+            float norm = std::max(std::abs(x), std::max(std::abs(y), std::abs(z)));
+
+            if (norm < 1e-6f)
+            {
+                break;
+            }
+
+            axis[0] = x / norm;
+            axis[1] = y / norm;
+            axis[2] = z / norm;
+        }
+
+        // the extremes along the axis are the first guess for the endpoints
+        int min_idx = 0;
+        int max_idx = 0;
+        float min_dot = 0.0f;
+        float max_dot = 0.0f;
+
+        for (int i = 0; i < 16; ++i)
+        {
+            float dot = colors[i][0] * axis[0] + colors[i][1] * axis[1] + colors[i][2] * axis[2];
+
+            if (0 == i || dot < min_dot) { min_dot = dot; min_idx = i; }
+            if (0 == i || dot > max_dot) { max_dot = dot; max_idx = i; }
+        }
+
+        uint16_t c0 = PackRGB565(colors[max_idx], fixed_blue);
+        uint16_t c1 = PackRGB565(colors[min_idx], fixed_blue);
+        if (c0 < c1) std::swap(c0, c1);
+
+        uint32_t indices;
+        float error = PickColorIndices(colors, c0, c1, &indices);
+
+        // least squares endpoints for the chosen indices; weight of c0 per index
+        static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+        for (int iter = 0; iter < 2 && c0 != c1 && error > 0.0f; ++iter)
+        {
+            float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+            float ax[3] = { 0.0f, 0.0f, 0.0f };
+            float bx[3] = { 0.0f, 0.0f, 0.0f };
+
+            for (int i = 0; i < 16; ++i)
+            {
+                float a = weights[(indices >> (2 * i)) & 3];
+                float b = 1.0f - a;
+
+                aa += a * a; bb += b * b; ab += a * b;
+
+                for (int ch = 0; ch < 3; ++ch)
+                {
+                    ax[ch] += a * colors[i][ch];
+                    bx[ch] += b * colors[i][ch];
+                }
+            }
+
+            float det = aa * bb - ab * ab;
+
+            if (std::abs(det) < 1e-6f)
+            {
+                break;
+            }
+
+            float e0[3];
+            float e1[3];
+
+            for (int ch = 0; ch < 3; ++ch)
+            {
+                e0[ch] = (ax[ch] * bb - bx[ch] * ab) / det;
+                e1[ch] = (bx[ch] * aa - ax[ch] * ab) / det;
+            }
+
+            uint16_t r0 = PackRGB565(e0, fixed_blue);
+            uint16_t r1 = PackRGB565(e1, fixed_blue);
+            if (r0 < r1) std::swap(r0, r1);
+
+            uint32_t refined_indices;
+            float refined_error = PickColorIndices(colors, r0, r1, &refined_indices);
+
+            if (refined_error >= error)
+            {
+                break;
+            }
+
+            c0 = r0;
+            c1 = r1;
+            indices = refined_indices;
+            error = refined_error;
+        }
+
+        dst[0] = static_cast<unsigned char>(c0 & 0xFF);
+        dst[1] = static_cast<unsigned char>(c0 >> 8);
+        dst[2] = static_cast<unsigned char>(c1 & 0xFF);
+        dst[3] = static_cast<unsigned char>(c1 >> 8);
+        memcpy(dst + 4, &indices, sizeof(uint32_t));
+    }
+
+    /*
+     *  8 byte DXT5 alpha block, 8-value mode between the lowest and highest value
+     */
+    static void CompressAlphaBlock(const unsigned char values[16], unsigned char * dst)
+    {
+        int a0 = *std::max_element(values, values + 16);
+        int a1 = *std::min_element(values, values + 16);
+
+        uint64_t bits = 0;
+
+        if (a0 > a1)
+        {
+            // steps from a1 (0) to a0 (7) -> index: a0 is index 0, a1 index 1, the ones in between 7 down to 2
+            static const int step_index[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+            int range = a0 - a1;
+
+            for (int i = 0; i < 16; ++i)
+            {
+                int step = ((values[i] - a1) * 14 + range) / (2 * range);
+
+                bits |= static_cast<uint64_t>(step_index[step]) << (3 * i);
+            }
+        }
+
+        dst[0] = static_cast<unsigned char>(a0);
+        dst[1] = static_cast<unsigned char>(a1);
+
+        for (int byte = 0; byte < 6; ++byte)
+        {
+            dst[2 + byte] = static_cast<unsigned char>(bits >> (8 * byte));
+        }
+    }
+
+    void CompressBlockDXT1(const unsigned char * rgba, unsigned char * dst)
+    {
+        float colors[16][3];
+
+        for (int i = 0; i < 16; ++i)
+        {
+            colors[i][0] = rgba[4 * i + 0];
+            colors[i][1] = rgba[4 * i + 1];
+            colors[i][2] = rgba[4 * i + 2];
+        }
+
+        CompressColorBlock(colors, -1, dst);
+    }
+
+    void CompressBlockDXT5(const unsigned char * rgba, unsigned char * dst)
+    {
+        unsigned char alpha[16];
+
+        for (int i = 0; i < 16; ++i)
+        {
+            alpha[i] = rgba[4 * i + 3];
+        }
+
+        CompressAlphaBlock(alpha, dst);
+        CompressBlockDXT1(rgba, dst + 8);
+    }
+
+    void CompressBlockCoCgY(const unsigned char * rgba, unsigned char * dst)
+    {
+        float co[16];
+        float cg[16];
+        unsigned char luma[16];
+        float max_chroma = 0.0f;
+
+        for (int i = 0; i < 16; ++i)
+        {
+            float r = rgba[4 * i + 0];
+            float g = rgba[4 * i + 1];
+            float b = rgba[4 * i + 2];
+
+            co[i] = (r - b) * 0.5f;
+            cg[i] = (2.0f * g - r - b) * 0.25f;
+            luma[i] = static_cast<unsigned char>(std::min(255.0f, (r + 2.0f * g + b) * 0.25f + 0.5f));
+
+            max_chroma = std::max(max_chroma, std::max(std::abs(co[i]), std::abs(cg[i])));
+        }
+
+        // low chroma blocks are scaled up for precision; the shader divides by blue * 255 / 8 + 1
+        int scale = (max_chroma < 31.0f) ? 4 : (max_chroma < 63.0f) ? 2 : 1;
+        int blue_bits = (4 == scale) ? 3 : (scale - 1);
+
+        float colors[16][3];
+
+        for (int i = 0; i < 16; ++i)
+        {
+            colors[i][0] = std::min(255.0f, std::max(0.0f, co[i] * scale + 128.0f));
+            colors[i][1] = std::min(255.0f, std::max(0.0f, cg[i] * scale + 128.0f));
+            colors[i][2] = static_cast<float>((blue_bits << 3) | (blue_bits >> 2));
+        }
+
+        CompressAlphaBlock(luma, dst);
+        CompressColorBlock(colors, blue_bits, dst + 8);
+    }
+
+    int CompressImageDXT(const unsigned char * rgba, uint32_t width, uint32_t height, HPVCompressionType type, unsigned char * dst)
+    {
+        if ((width % 4) != 0 || (height % 4) != 0)
+        {
+            return HPV_RET_ERROR;
+        }
+
+        std::size_t block_size = DXTBlockSize(type);
+        unsigned char block[64];
+
+        for (uint32_t y = 0; y < height; y += 4)
+        {
+            for (uint32_t x = 0; x < width; x += 4)
+            {
+                for (uint32_t row = 0; row < 4; ++row)
+                {
+                    memcpy(block + 16 * row, rgba + (static_cast<std::size_t>(y + row) * width + x) * 4, 16);
+                }
+
+                switch (type)
+                {
+                    case HPVCompressionType::HPV_TYPE_DXT1_NO_ALPHA:
+                        CompressBlockDXT1(block, dst);
+                        break;
+                    case HPVCompressionType::HPV_TYPE_DXT5_ALPHA:
+                        CompressBlockDXT5(block, dst);
+                        break;
+                    case HPVCompressionType::HPV_TYPE_SCALED_DXT5_CoCg_Y:
+                        CompressBlockCoCgY(block, dst);
+                        break;
+                    default:
+                        return HPV_RET_ERROR;
+                }
+
+                dst += block_size;
+            }
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    /*
+     *  Decompression. The palettes are built with the integer rules of the D3D10 spec (BC1 - BC3): two thirds /
+     *  one third and sevenths / fifths, truncated. A DXT1 block with c0 <= c1 has three colors and transparent
+     *  black, as GL_COMPRESSED_RGBA_S3TC_DXT1; the color block of a DXT5 block always has four colors.
+     */
+    static HPV_FORCE_INLINE void ColorPalette(const unsigned char * block, bool dxt1, uint32_t * palette)
+    {
+        uint32_t c0 = block[0] | (block[1] << 8);
+        uint32_t c1 = block[2] | (block[3] << 8);
+
+        int rgb[2][3];
+        for (int i = 0; i < 2; ++i)
+        {
+            uint32_t c = i ? c1 : c0;
+            int r = (c >> 11) & 31;
+            int g = (c >> 5) & 63;
+            int b = c & 31;
+
+            rgb[i][0] = (r << 3) | (r >> 2);
+            rgb[i][1] = (g << 2) | (g >> 4);
+            rgb[i][2] = (b << 3) | (b >> 2);
+        }
+
+        uint32_t opaque = dxt1 ? 0xFF000000u : 0;
+        uint32_t p2 = 0;
+        uint32_t p3 = 0;
+
+        for (int ch = 0; ch < 3; ++ch)
+        {
+            int a = rgb[0][ch];
+            int b = rgb[1][ch];
+
+            if (!dxt1 || c0 > c1)
+            {
+                p2 |= static_cast<uint32_t>((2 * a + b) / 3) << (8 * ch);
+                p3 |= static_cast<uint32_t>((a + 2 * b) / 3) << (8 * ch);
+            }
+            else
+            {
+                p2 |= static_cast<uint32_t>((a + b) / 2) << (8 * ch);
+            }
+        }
+
+        palette[0] = static_cast<uint32_t>(rgb[0][0] | (rgb[0][1] << 8) | (rgb[0][2] << 16)) | opaque;
+        palette[1] = static_cast<uint32_t>(rgb[1][0] | (rgb[1][1] << 8) | (rgb[1][2] << 16)) | opaque;
+        palette[2] = p2 | opaque;
+        palette[3] = (!dxt1 || c0 > c1) ? (p3 | opaque) : 0;
+    }
+
+    static HPV_FORCE_INLINE void AlphaPalette(const unsigned char * block, unsigned char * palette)
+    {
+        int a0 = block[0];
+        int a1 = block[1];
+
+        palette[0] = static_cast<unsigned char>(a0);
+        palette[1] = static_cast<unsigned char>(a1);
+
+        if (a0 > a1)
+        {
+            for (int i = 1; i < 7; ++i)
+            {
+                palette[i + 1] = static_cast<unsigned char>(((7 - i) * a0 + i * a1) / 7);
+            }
+        }
+        else
+        {
+            for (int i = 1; i < 5; ++i)
+            {
+                palette[i + 1] = static_cast<unsigned char>(((5 - i) * a0 + i * a1) / 5);
+            }
+
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    static HPV_FORCE_INLINE uint64_t AlphaIndices(const unsigned char * block)
+    {
+        uint64_t bits = 0;
+
+        for (int byte = 0; byte < 6; ++byte)
+        {
+            bits |= static_cast<uint64_t>(block[2 + byte]) << (8 * byte);
+        }
+
+        return bits;
+    }
+
+    static HPV_FORCE_INLINE uint32_t LoadIndices(const unsigned char * block)
+    {
+        return block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    }
+
+    /*
+     *  CPU port of frag_CT_CoCg_Y (ofxHPVPLayer.cpp), in 0 - 255 units instead of 0 - 1: the shader's offset
+     *  0.50196 is 128 / 255, its scale 'blue * 255 / 8 + 1' is 'blue / 8 + 1'. The SIMD versions do the same
+     *  operations in the same order, so every path gives the same pixels on every machine.
+     */
+    static inline uint32_t CoCgYToRGBA(uint32_t pixel)
+    {
+        float scale = static_cast<float>((pixel >> 16) & 0xFF) * 0.125f + 1.0f;
+        float co = static_cast<float>(static_cast<int>(pixel & 0xFF) - 128) / scale;
+        float cg = static_cast<float>(static_cast<int>((pixel >> 8) & 0xFF) - 128) / scale;
+        float y = static_cast<float>(pixel >> 24);
+
+        long r = std::min(255L, std::max(0L, std::lrint(y + co - cg)));
+        long g = std::min(255L, std::max(0L, std::lrint(y + cg)));
+        long b = std::min(255L, std::max(0L, std::lrint(y - co - cg)));
+
+        return static_cast<uint32_t>(r | (g << 8) | (b << 16)) | 0xFF000000u;
+    }
+
+    static void DecompressBlockRowScalar(const unsigned char * src, uint32_t num_blocks, HPVCompressionType type, unsigned char * dst, std::size_t stride)
+    {
+        bool dxt1 = (HPVCompressionType::HPV_TYPE_DXT1_NO_ALPHA == type);
+        bool cocgy = (HPVCompressionType::HPV_TYPE_SCALED_DXT5_CoCg_Y == type);
+        std::size_t block_size = DXTBlockSize(type);
+
+        for (uint32_t x = 0; x < num_blocks; ++x, src += block_size)
+        {
+            const unsigned char * color_block = dxt1 ? src : src + 8;
+            uint32_t palette[4];
+            unsigned char alpha[8];
+            uint64_t alpha_bits = 0;
+
+            ColorPalette(color_block, dxt1, palette);
+            uint32_t indices = LoadIndices(color_block);
+
+            if (!dxt1)
+            {
+                AlphaPalette(src, alpha);
+                alpha_bits = AlphaIndices(src);
+            }
+
+            for (int row = 0; row < 4; ++row)
+            {
+                uint32_t out[4];
+
+                for (int col = 0; col < 4; ++col)
+                {
+                    int i = 4 * row + col;
+                    uint32_t pixel = palette[(indices >> (2 * i)) & 3];
+
+                    if (!dxt1)
+                    {
+                        pixel |= static_cast<uint32_t>(alpha[(alpha_bits >> (3 * i)) & 7]) << 24;
+                    }
+
+                    out[col] = cocgy ? CoCgYToRGBA(pixel) : pixel;
+                }
+
+                unsigned char * dst_row = dst + row * stride + 16 * x;
+                for (int col = 0; col < 4; ++col)
+                {
+                    dst_row[4 * col + 0] = static_cast<unsigned char>(out[col]);
+                    dst_row[4 * col + 1] = static_cast<unsigned char>(out[col] >> 8);
+                    dst_row[4 * col + 2] = static_cast<unsigned char>(out[col] >> 16);
+                    dst_row[4 * col + 3] = static_cast<unsigned char>(out[col] >> 24);
+                }
+            }
+        }
+    }
+
+#if defined(HPV_DXT_X86)
+    /*
+     *  SIMD paths. A row of 4 pixels is a byte shuffle of the 4 colors of the palette: the shuffle control for
+     *  every combination of 4 color indices (one byte of the index word) comes from a table, the alpha
+     *  shuffle for every pair of 3-bit alpha indices from another one. AVX2 does the same for two blocks
+     *  at once, the pixel rows of neighbouring blocks are next to each other in the image.
+     */
+    struct ShuffleTables
+    {
+        unsigned char   color[256][16];
+        uint64_t        alpha[64];
+
+        ShuffleTables()
+        {
+            for (int bits = 0; bits < 256; ++bits)
+            {
+                for (int px = 0; px < 4; ++px)
+                {
+                    int idx = (bits >> (2 * px)) & 3;
+                    for (int ch = 0; ch < 4; ++ch)
+                    {
+                        color[bits][4 * px + ch] = static_cast<unsigned char>(4 * idx + ch);
+                    }
+                }
+            }
+
+            // byte 3 of each of the two pixels picks its alpha, 0x80 zeroes the color bytes
+            for (int bits = 0; bits < 64; ++bits)
+            {
+                alpha[bits] = 0x0080808000808080ull | (static_cast<uint64_t>(bits & 7) << 24) | (static_cast<uint64_t>(bits >> 3) << 56);
+            }
+        }
+    };
+
+    static const ShuffleTables SHUFFLE_TABLES;
+
+    /*
+     *  The palettes in 16-bit lanes, same results as ColorPalette() and AlphaPalette(). The 565 endpoints are
+     *  expanded to 8 bits and the divisions by 3, 5 and 7 done with a multiply-high, exact for the sums that occur.
+     */
+    HPV_TARGET_SSSE3 static HPV_FORCE_INLINE __m128i ColorPaletteSSE(const unsigned char * block, bool dxt1)
+    {
+        uint32_t c0 = block[0] | (block[1] << 8);
+        uint32_t c1 = block[2] | (block[3] << 8);
+
+        // lanes c0 c0 c0 0 c1 c1 c1 0, each channel moved to the top of its lane and then scaled to 8 bits
+        __m128i packed = _mm_cvtsi32_si128(static_cast<int>(c0 | (c1 << 16)));
+        __m128i lanes = _mm_unpacklo_epi64(_mm_shufflelo_epi16(packed, _MM_SHUFFLE(2, 0, 0, 0)), _mm_shufflelo_epi16(packed, _MM_SHUFFLE(2, 1, 1, 1)));
+        lanes = _mm_and_si128(_mm_mullo_epi16(lanes, _mm_setr_epi16(1, 1, 2048, 0, 1, 1, 2048, 0)),
+                              _mm_setr_epi16(static_cast<short>(0xF800), 0x07E0, static_cast<short>(0xF800), 0, static_cast<short>(0xF800), 0x07E0, static_cast<short>(0xF800), 0));
+        __m128i endpoints = _mm_mulhi_epu16(lanes, _mm_setr_epi16(264, 8320, 264, 0, 264, 8320, 264, 0));
+
+        __m128i e0 = _mm_unpacklo_epi64(endpoints, endpoints);
+        __m128i e1 = _mm_unpackhi_epi64(endpoints, endpoints);
+        bool four_colors = (!dxt1 || c0 > c1);
+        __m128i mixed;
+
+        if (four_colors)
+        {
+            // 2/3 e0 + 1/3 e1 in the low half, 1/3 e0 + 2/3 e1 in the high half
+            __m128i sum = _mm_add_epi16(_mm_add_epi16(e0, e1), _mm_unpacklo_epi64(e0, e1));
+            mixed = _mm_mulhi_epu16(sum, _mm_set1_epi16(21846));
+        }
+        else
+        {
+            // half way and transparent black
+            mixed = _mm_move_epi64(_mm_srli_epi16(_mm_add_epi16(e0, e1), 1));
+        }
+
+        __m128i palette = _mm_packus_epi16(endpoints, mixed);
+
+        if (dxt1)
+        {
+            const int opaque = static_cast<int>(0xFF000000u);
+            palette = _mm_or_si128(palette, _mm_setr_epi32(opaque, opaque, opaque, four_colors ? opaque : 0));
+        }
+
+        return palette;
+    }
+
+    HPV_TARGET_SSSE3 static HPV_FORCE_INLINE __m128i AlphaPaletteSSE(const unsigned char * block)
+    {
+        __m128i a0 = _mm_set1_epi16(block[0]);
+        __m128i a1 = _mm_set1_epi16(block[1]);
+
+        if (block[0] > block[1])
+        {
+            __m128i sum = _mm_add_epi16(_mm_mullo_epi16(a0, _mm_setr_epi16(7, 0, 6, 5, 4, 3, 2, 1)), _mm_mullo_epi16(a1, _mm_setr_epi16(0, 7, 1, 2, 3, 4, 5, 6)));
+            return _mm_packus_epi16(_mm_mulhi_epu16(sum, _mm_set1_epi16(9363)), _mm_setzero_si128());
+        }
+
+        __m128i sum = _mm_add_epi16(_mm_mullo_epi16(a0, _mm_setr_epi16(5, 0, 4, 3, 2, 1, 0, 0)), _mm_mullo_epi16(a1, _mm_setr_epi16(0, 5, 1, 2, 3, 4, 0, 0)));
+        __m128i alphas = _mm_mulhi_epu16(sum, _mm_set1_epi16(13108));
+        return _mm_packus_epi16(_mm_or_si128(alphas, _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, 255)), _mm_setzero_si128());
+    }
+
+    HPV_TARGET_SSSE3 static inline __m128i CoCgYToRGBA_SSE(__m128i px)
+    {
+        const __m128i byte_mask = _mm_set1_epi32(0xFF);
+        const __m128i offset = _mm_set1_epi32(128);
+
+        __m128 scale = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 16), byte_mask)), _mm_set1_ps(0.125f)), _mm_set1_ps(1.0f));
+        __m128 co = _mm_div_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(px, byte_mask), offset)), scale);
+        __m128 cg = _mm_div_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(px, 8), byte_mask), offset)), scale);
+        __m128 y = _mm_cvtepi32_ps(_mm_srli_epi32(px, 24));
+
+        __m128i r = _mm_cvtps_epi32(_mm_sub_ps(_mm_add_ps(y, co), cg));
+        __m128i g = _mm_cvtps_epi32(_mm_add_ps(y, cg));
+        __m128i b = _mm_cvtps_epi32(_mm_sub_ps(_mm_sub_ps(y, co), cg));
+
+        // saturating packs clamp to 0 - 255, gives r0..r3 g0..g3 b0..b3 a0..a3, then interleave
+        __m128i planar = _mm_packus_epi16(_mm_packs_epi32(r, g), _mm_packs_epi32(b, _mm_set1_epi32(255)));
+        return _mm_shuffle_epi8(planar, _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+    }
+
+    HPV_TARGET_SSSE3 static void DecompressBlockRowSSSE3(const unsigned char * src, uint32_t num_blocks, HPVCompressionType type, unsigned char * dst, std::size_t stride)
+    {
+        bool dxt1 = (HPVCompressionType::HPV_TYPE_DXT1_NO_ALPHA == type);
+        bool cocgy = (HPVCompressionType::HPV_TYPE_SCALED_DXT5_CoCg_Y == type);
+        std::size_t block_size = DXTBlockSize(type);
+
+        for (uint32_t x = 0; x < num_blocks; ++x, src += block_size)
+        {
+            const unsigned char * color_block = dxt1 ? src : src + 8;
+            __m128i colors = ColorPaletteSSE(color_block, dxt1);
+            uint32_t indices = LoadIndices(color_block);
+
+            __m128i alphas = _mm_setzero_si128();
+            uint64_t alpha_bits = 0;
+
+            if (!dxt1)
+            {
+                alphas = AlphaPaletteSSE(src);
+                alpha_bits = AlphaIndices(src);
+            }
+
+            for (int row = 0; row < 4; ++row)
+            {
+                __m128i px = _mm_shuffle_epi8(colors, _mm_loadu_si128(reinterpret_cast<const __m128i *>(SHUFFLE_TABLES.color[(indices >> (8 * row)) & 0xFF])));
+
+                if (!dxt1)
+                {
+                    uint32_t bits = static_cast<uint32_t>(alpha_bits >> (12 * row));
+                    __m128i ctrl = _mm_set_epi64x(static_cast<long long>(SHUFFLE_TABLES.alpha[(bits >> 6) & 63]), static_cast<long long>(SHUFFLE_TABLES.alpha[bits & 63]));
+                    px = _mm_or_si128(px, _mm_shuffle_epi8(alphas, ctrl));
+                }
+
+                if (cocgy)
+                {
+                    px = CoCgYToRGBA_SSE(px);
+                }
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + row * stride + 16 * x), px);
+            }
+        }
+    }
+
+    HPV_TARGET_AVX2 static inline __m256i CoCgYToRGBA_AVX2(__m256i px)
+    {
+        const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+        const __m256i offset = _mm256_set1_epi32(128);
+
+        __m256 scale = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 16), byte_mask)), _mm256_set1_ps(0.125f)), _mm256_set1_ps(1.0f));
+        __m256 co = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_and_si256(px, byte_mask), offset)), scale);
+        __m256 cg = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(px, 8), byte_mask), offset)), scale);
+        __m256 y = _mm256_cvtepi32_ps(_mm256_srli_epi32(px, 24));
+
+        __m256i r = _mm256_cvtps_epi32(_mm256_sub_ps(_mm256_add_ps(y, co), cg));
+        __m256i g = _mm256_cvtps_epi32(_mm256_add_ps(y, cg));
+        __m256i b = _mm256_cvtps_epi32(_mm256_sub_ps(_mm256_sub_ps(y, co), cg));
+
+        // the packs work per 128-bit lane, so every lane stays 4 pixels of its own block
+        __m256i planar = _mm256_packus_epi16(_mm256_packs_epi32(r, g), _mm256_packs_epi32(b, _mm256_set1_epi32(255)));
+        return _mm256_shuffle_epi8(planar, _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+                                                            0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+    }
+
+    HPV_TARGET_AVX2 static void DecompressBlockRowAVX2(const unsigned char * src, uint32_t num_blocks, HPVCompressionType type, unsigned char * dst, std::size_t stride)
+    {
+        bool dxt1 = (HPVCompressionType::HPV_TYPE_DXT1_NO_ALPHA == type);
+        bool cocgy = (HPVCompressionType::HPV_TYPE_SCALED_DXT5_CoCg_Y == type);
+        std::size_t block_size = DXTBlockSize(type);
+        uint32_t x = 0;
+
+        for (; x + 2 <= num_blocks; x += 2, src += 2 * block_size)
+        {
+            const unsigned char * next = src + block_size;
+            const unsigned char * color_block = dxt1 ? src : src + 8;
+            const unsigned char * next_color_block = dxt1 ? next : next + 8;
+            uint32_t indices[2] = { LoadIndices(color_block), LoadIndices(next_color_block) };
+            __m256i colors = _mm256_inserti128_si256(_mm256_castsi128_si256(ColorPaletteSSE(color_block, dxt1)), ColorPaletteSSE(next_color_block, dxt1), 1);
+
+            __m256i alphas = _mm256_setzero_si256();
+            uint64_t alpha_bits[2] = { 0, 0 };
+
+            if (!dxt1)
+            {
+                alphas = _mm256_inserti128_si256(_mm256_castsi128_si256(AlphaPaletteSSE(src)), AlphaPaletteSSE(next), 1);
+                alpha_bits[0] = AlphaIndices(src);
+                alpha_bits[1] = AlphaIndices(next);
+            }
+
+            for (int row = 0; row < 4; ++row)
+            {
+                __m256i ctrl = _mm256_inserti128_si256(_mm256_castsi128_si256(
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(SHUFFLE_TABLES.color[(indices[0] >> (8 * row)) & 0xFF]))),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(SHUFFLE_TABLES.color[(indices[1] >> (8 * row)) & 0xFF])), 1);
+                __m256i px = _mm256_shuffle_epi8(colors, ctrl);
+
+                if (!dxt1)
+                {
+                    uint32_t bits0 = static_cast<uint32_t>(alpha_bits[0] >> (12 * row));
+                    uint32_t bits1 = static_cast<uint32_t>(alpha_bits[1] >> (12 * row));
+                    __m256i actrl = _mm256_set_epi64x(static_cast<long long>(SHUFFLE_TABLES.alpha[(bits1 >> 6) & 63]), static_cast<long long>(SHUFFLE_TABLES.alpha[bits1 & 63]),
+                                                      static_cast<long long>(SHUFFLE_TABLES.alpha[(bits0 >> 6) & 63]), static_cast<long long>(SHUFFLE_TABLES.alpha[bits0 & 63]));
+                    px = _mm256_or_si256(px, _mm256_shuffle_epi8(alphas, actrl));
+                }
+
+                if (cocgy)
+                {
+                    px = CoCgYToRGBA_AVX2(px);
+                }
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + row * stride + 16 * x), px);
+            }
+        }
+
+        if (x < num_blocks)
+        {
+            DecompressBlockRowSSSE3(src, num_blocks - x, type, dst + 16 * x, stride);
+        }
+    }
+
+    HPV_TARGET_SSSE3 static void ConvertCoCgYSSSE3(const unsigned char * src, std::size_t num_pixels, unsigned char * dst)
+    {
+        std::size_t i = 0;
+
+        for (; i + 4 <= num_pixels; i += 4)
+        {
+            __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * i), CoCgYToRGBA_SSE(px));
+        }
+
+        for (; i < num_pixels; ++i)
+        {
+            uint32_t px = src[4 * i] | (src[4 * i + 1] << 8) | (src[4 * i + 2] << 16) | (static_cast<uint32_t>(src[4 * i + 3]) << 24);
+            uint32_t out = CoCgYToRGBA(px);
+            memcpy(dst + 4 * i, &out, 4);
+        }
+    }
+
+    HPV_TARGET_AVX2 static void ConvertCoCgYAVX2(const unsigned char * src, std::size_t num_pixels, unsigned char * dst)
+    {
+        std::size_t i = 0;
+
+        for (; i + 8 <= num_pixels; i += 8)
+        {
+            __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 4 * i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * i), CoCgYToRGBA_AVX2(px));
+        }
+
+        ConvertCoCgYSSSE3(src + 4 * i, num_pixels - i, dst + 4 * i);
+    }
+
+    static HPVDXTDecoder BestDXTDecoder()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        int max_leaf = info[0];
+        __cpuid(info, 1);
+        bool ssse3 = (info[2] & (1 << 9)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+        bool avx2 = false;
+        if (avx && max_leaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        bool ssse3 = __builtin_cpu_supports("ssse3");
+        bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        return avx2 ? HPVDXTDecoder::HPV_DXT_DECODER_AVX2 : ssse3 ? HPVDXTDecoder::HPV_DXT_DECODER_SSSE3 : HPVDXTDecoder::HPV_DXT_DECODER_SCALAR;
+    }
+#else
+    static HPVDXTDecoder BestDXTDecoder()
+    {
+        return HPVDXTDecoder::HPV_DXT_DECODER_SCALAR;
+    }
+#endif
+
+    static const HPVDXTDecoder BEST_DXT_DECODER = BestDXTDecoder();
+    static std::atomic<uint8_t> DXT_DECODER(static_cast<uint8_t>(BEST_DXT_DECODER));
+
+    HPVDXTDecoder SetDXTDecoder(HPVDXTDecoder decoder)
+    {
+        uint8_t chosen = std::min(static_cast<uint8_t>(decoder), static_cast<uint8_t>(BEST_DXT_DECODER));
+        DXT_DECODER.store(chosen, std::memory_order_relaxed);
+
+        return static_cast<HPVDXTDecoder>(chosen);
+    }
+
+    HPVDXTDecoder GetDXTDecoder()
+    {
+        return static_cast<HPVDXTDecoder>(DXT_DECODER.load(std::memory_order_relaxed));
+    }
+
+    const char * DXTDecoderName(HPVDXTDecoder decoder)
+    {
+        switch (decoder)
+        {
+            case HPVDXTDecoder::HPV_DXT_DECODER_SSSE3:  return "SSSE3";
+            case HPVDXTDecoder::HPV_DXT_DECODER_AVX2:   return "AVX2";
+            default:                                    return "scalar";
+        }
+    }
+
+    int DecompressBlockRowsDXT(const unsigned char * dxt, uint32_t width, uint32_t height, HPVCompressionType type,
+                               uint32_t first_block_row, uint32_t num_block_rows, unsigned char * rgba)
+    {
+        if ((width % 4) != 0 || (height % 4) != 0 || first_block_row + num_block_rows > height / 4 || type >= HPVCompressionType::HPV_NUM_TYPES)
+        {
+            return HPV_RET_ERROR;
+        }
+
+        uint32_t blocks_per_row = width / 4;
+        std::size_t src_row_size = blocks_per_row * DXTBlockSize(type);
+        std::size_t stride = static_cast<std::size_t>(width) * 4;
+        HPVDXTDecoder decoder = GetDXTDecoder();
+
+        for (uint32_t block_row = first_block_row; block_row < first_block_row + num_block_rows; ++block_row)
+        {
+            const unsigned char * src = dxt + block_row * src_row_size;
+            unsigned char * dst = rgba + static_cast<std::size_t>(block_row) * 4 * stride;
+
+            switch (decoder)
+            {
+#if defined(HPV_DXT_X86)
+                case HPVDXTDecoder::HPV_DXT_DECODER_AVX2:
+                    DecompressBlockRowAVX2(src, blocks_per_row, type, dst, stride);
+                    break;
+                case HPVDXTDecoder::HPV_DXT_DECODER_SSSE3:
+                    DecompressBlockRowSSSE3(src, blocks_per_row, type, dst, stride);
+                    break;
+#endif
+                default:
+                    DecompressBlockRowScalar(src, blocks_per_row, type, dst, stride);
+                    break;
+            }
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    int DecompressImageDXT(const unsigned char * dxt, uint32_t width, uint32_t height, HPVCompressionType type, unsigned char * rgba)
+    {
+        return DecompressBlockRowsDXT(dxt, width, height, type, 0, height / 4, rgba);
+    }
+
+    void ConvertCoCgYToRGBA(const unsigned char * cocgy, std::size_t num_pixels, unsigned char * rgba)
+    {
+        switch (GetDXTDecoder())
+        {
+#if defined(HPV_DXT_X86)
+            case HPVDXTDecoder::HPV_DXT_DECODER_AVX2:
+                ConvertCoCgYAVX2(cocgy, num_pixels, rgba);
+                break;
+            case HPVDXTDecoder::HPV_DXT_DECODER_SSSE3:
+                ConvertCoCgYSSSE3(cocgy, num_pixels, rgba);
+                break;
+#endif
+            default:
+                for (std::size_t i = 0; i < num_pixels; ++i)
+                {
+                    const unsigned char * src = cocgy + 4 * i;
+                    uint32_t out = CoCgYToRGBA(src[0] | (src[1] << 8) | (src[2] << 16) | (static_cast<uint32_t>(src[3]) << 24));
+
+                    rgba[4 * i + 0] = static_cast<unsigned char>(out);
+                    rgba[4 * i + 1] = static_cast<unsigned char>(out >> 8);
+                    rgba[4 * i + 2] = static_cast<unsigned char>(out >> 16);
+                    rgba[4 * i + 3] = static_cast<unsigned char>(out >> 24);
+                }
+                break;
+        }
+    }
+
+} /* End HPV namespace */
@@ -0,0 +1,64 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "HPVHeader.h"
+
+/*
+ *  DXT block compression for the HPV encoder and decompression for players without a GPU. Pixels are
+ *  8-bit RGBA, a block is 4x4 pixels given row by row. Compressed frames are what the GPU (and HPVPlayer)
+ *  expects: blocks row-major, 8 bytes per DXT1 block, 16 bytes per DXT5 block (alpha block followed by color block).
+ */
+namespace HPV {
+
+    /* Bytes per 4x4 block of a compression type */
+    inline std::size_t DXTBlockSize(HPVCompressionType type)
+    {
+        return (HPVCompressionType::HPV_TYPE_DXT1_NO_ALPHA == type) ? 8 : 16;
+    }
+
+    void    CompressBlockDXT1(const unsigned char * rgba, unsigned char * dst);
+    void    CompressBlockDXT5(const unsigned char * rgba, unsigned char * dst);
+
+    /* Scaled YCoCg in a DXT5 block (van Waveren & Castaño): Co and Cg in red and green, scaled up by 1, 2 or 4
+     * per block with the scale in blue, luma in alpha. The player converts back to RGB in a shader. */
+    void    CompressBlockCoCgY(const unsigned char * rgba, unsigned char * dst);
+
+    /* Compresses an RGBA image of width x height pixels, both multiples of 4, into 'dst' */
+    int     CompressImageDXT(const unsigned char * rgba, uint32_t width, uint32_t height, HPVCompressionType type, unsigned char * dst);
+
+    /* Implementations of the decompressor, picked at startup from what the CPU supports */
+    enum class HPVDXTDecoder : std::uint8_t
+    {
+        HPV_DXT_DECODER_SCALAR = 0,
+        HPV_DXT_DECODER_SSSE3,
+        HPV_DXT_DECODER_AVX2
+    };
+
+    /* Limits the decompressor to 'decoder' or the best one below it the CPU has, returns the one in use */
+    HPVDXTDecoder   SetDXTDecoder(HPVDXTDecoder decoder);
+    HPVDXTDecoder   GetDXTDecoder();
+    const char *    DXTDecoderName(HPVDXTDecoder decoder);
+
+    /* Decompresses a frame to RGBA, CoCg_Y frames are converted to RGB as the player's shader does (alpha 255) */
+    int     DecompressImageDXT(const unsigned char * dxt, uint32_t width, uint32_t height, HPVCompressionType type, unsigned char * rgba);
+
+    /* Decompresses only the given rows of blocks, to split a frame over threads. 'dxt' and 'rgba' are the whole frame. */
+    int     DecompressBlockRowsDXT(const unsigned char * dxt, uint32_t width, uint32_t height, HPVCompressionType type,
+                                   uint32_t first_block_row, uint32_t num_block_rows, unsigned char * rgba);
+
+    /* The CoCg_Y to RGB step on its own, for pixels that were decoded as plain DXT5 (Co, Cg, scale, Y), e.g. read
+     * back from a texture. Same math as the shader and as the conversion fused into DecompressImageDXT().
+     * 'cocgy' and 'rgba' may be the same buffer. */
+    void    ConvertCoCgYToRGBA(const unsigned char * cocgy, std::size_t num_pixels, unsigned char * rgba);
+
+} /* End HPV namespace */
@@ -0,0 +1,445 @@
+#include <algorithm>
+
+#include "HPVDecodePool.h"
+#include "HPVPlayer.h"
+#include "HPVHeader.h"
+#include "Log.h"
+#include "Timer.h"
+
+namespace HPV {
+
+    // deadline of a task while it is being stepped; like an idle player it is never due
+    static const uint64_t HPV_TASK_RUNNING = HPV_STEP_WHEN_WOKEN;
+
+    HPVDecodePool::HPVDecodePool()
+    : _wake_generation(0)
+    , _is_init(false)
+    , _next_worker(0)
+    {
+        _should_work.store(false, std::memory_order_relaxed);
+        _num_steps.store(0, std::memory_order_relaxed);
+        _num_steals.store(0, std::memory_order_relaxed);
+    }
+
+    HPVDecodePool::~HPVDecodePool()
+    {
+        shutdown();
+    }
+
+    int HPVDecodePool::init(unsigned num_threads)
+    {
+        std::lock_guard<std::mutex> lock(_pool_mtx);
+
+        if (_is_init)
+        {
+            return HPV_RET_ERROR_NONE;
+        }
+
+        if (0 == num_threads)
+        {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // all workers exist before the first one starts looking at the others
+        for (unsigned worker_idx = 0; worker_idx < num_threads; ++worker_idx)
+        {
+            _workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        }
+
+        _should_work.store(true, std::memory_order_release);
+
+        for (unsigned worker_idx = 0; worker_idx < num_threads; ++worker_idx)
+        {
+            _workers[worker_idx]->thread = std::thread(&HPVDecodePool::work, this, worker_idx);
+        }
+
+        _next_worker = 0;
+        _is_init.store(true, std::memory_order_release);
+
+        HPV_VERBOSE("Started HPV decode pool with %u threads", num_threads);
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    void HPVDecodePool::shutdown()
+    {
+        std::lock_guard<std::mutex> lock(_pool_mtx);
+
+        if (!_is_init)
+        {
+            return;
+        }
+
+        _should_work.store(false, std::memory_order_release);
+        notify();
+
+        for (std::unique_ptr<Worker>& worker : _workers)
+        {
+            if (worker->thread.joinable())
+            {
+                worker->thread.join();
+            }
+
+            for (Task * task : worker->tasks)
+            {
+                delete task;
+            }
+        }
+
+        _workers.clear();
+        _is_init.store(false, std::memory_order_release);
+
+        HPV_VERBOSE("Stopped HPV decode pool");
+    }
+
+    bool HPVDecodePool::isInit()
+    {
+        return _is_init.load(std::memory_order_acquire);
+    }
+
+    unsigned HPVDecodePool::getNumThreads()
+    {
+        return static_cast<unsigned>(_workers.size());
+    }
+
+    void HPVDecodePool::addPlayer(HPVPlayer * player)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_pool_mtx);
+
+            if (!_is_init || _workers.empty())
+            {
+                HPV_ERROR("Adding a player to a decode pool that isn't running");
+                return;
+            }
+
+            Task * task = new Task();
+            task->player = player;
+            task->deadline.store(0, std::memory_order_relaxed);
+            task->running.store(false, std::memory_order_relaxed);
+
+            // spread the players over the workers, stealing evens out the rest
+            Worker * home = _workers[_next_worker++ % _workers.size()].get();
+
+            std::lock_guard<std::mutex> worker_lock(home->mtx);
+            home->tasks.push_back(task);
+        }
+
+        notify();
+    }
+
+    /*
+     *  Takes the player out of the pool. Returns once no worker is stepping it anymore.
+     */
+    void HPVDecodePool::removePlayer(HPVPlayer * player)
+    {
+        std::lock_guard<std::mutex> lock(_pool_mtx);
+
+        Task * removed = nullptr;
+
+        for (std::unique_ptr<Worker>& worker : _workers)
+        {
+            std::lock_guard<std::mutex> worker_lock(worker->mtx);
+
+            for (std::size_t task_idx = 0; task_idx < worker->tasks.size(); ++task_idx)
+            {
+                if (worker->tasks[task_idx]->player == player)
+                {
+                    removed = worker->tasks[task_idx];
+                    worker->tasks.erase(worker->tasks.begin() + task_idx);
+                    break;
+                }
+            }
+
+            if (removed)
+            {
+                break;
+            }
+        }
+
+        if (!removed)
+        {
+            return;
+        }
+
+        // tasks are only claimed under the worker lock, so it can't be picked up again; wait for a running step
+        while (removed->running.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+
+        delete removed;
+    }
+
+    /*
+     *  Makes the player due right away, e.g. after a seek or when playback starts
+     */
+    void HPVDecodePool::wake(HPVPlayer * player)
+    {
+        for (std::unique_ptr<Worker>& worker : _workers)
+        {
+            std::lock_guard<std::mutex> worker_lock(worker->mtx);
+
+            for (Task * task : worker->tasks)
+            {
+                if (task->player == player)
+                {
+                    task->deadline.store(0, std::memory_order_release);
+                    break;
+                }
+            }
+        }
+
+        notify();
+    }
+
+    /*
+     *  The calling thread takes part in the work, so this also completes when all workers are busy
+     *  stepping players, or when it's called from a worker itself.
+     */
+    void HPVDecodePool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+    {
+        if (count <= 1 || !isInit() || _workers.size() <= 1)
+        {
+            for (uint32_t idx = 0; idx < count; ++idx)
+            {
+                func(idx);
+            }
+
+            return;
+        }
+
+        Job job;
+        job.func = &func;
+        job.count = count;
+        job.next.store(0, std::memory_order_relaxed);
+        job.done.store(0, std::memory_order_relaxed);
+        job.helpers = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(_jobs_mtx);
+            _jobs.push_back(&job);
+        }
+
+        notify();
+
+        runJob(&job);
+
+        // no new helpers once the job is out of the list, wait for the ones still working on it
+        for (;;)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_jobs_mtx);
+
+                std::vector<Job *>::iterator it = std::find(_jobs.begin(), _jobs.end(), &job);
+                if (it != _jobs.end())
+                {
+                    _jobs.erase(it);
+                }
+
+                if (0 == job.helpers && job.done.load(std::memory_order_acquire) == count)
+                {
+                    break;
+                }
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    void HPVDecodePool::runJob(Job * job)
+    {
+        for (;;)
+        {
+            uint32_t idx = job->next.fetch_add(1, std::memory_order_relaxed);
+
+            if (idx >= job->count)
+            {
+                break;
+            }
+
+            (*job->func)(idx);
+
+            job->done.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    /*
+     *  Lets a worker take part in a pending parallelFor(). Returns false when there was none.
+     */
+    bool HPVDecodePool::helpJob()
+    {
+        Job * job = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(_jobs_mtx);
+
+            for (Job * pending : _jobs)
+            {
+                if (pending->next.load(std::memory_order_relaxed) < pending->count)
+                {
+                    job = pending;
+                    ++job->helpers;
+                    break;
+                }
+            }
+        }
+
+        if (!job)
+        {
+            return false;
+        }
+
+        runJob(job);
+
+        std::lock_guard<std::mutex> lock(_jobs_mtx);
+        --job->helpers;
+
+        return true;
+    }
+
+    uint64_t HPVDecodePool::getNumSteps()
+    {
+        return _num_steps.load(std::memory_order_relaxed);
+    }
+
+    uint64_t HPVDecodePool::getNumSteals()
+    {
+        return _num_steals.load(std::memory_order_relaxed);
+    }
+
+    void HPVDecodePool::notify()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mtx);
+            ++_wake_generation;
+        }
+
+        _wakeup.notify_all();
+    }
+
+    /*
+     *  Claims the due task with the earliest deadline of 'worker'. 'earliest' is lowered to the
+     *  deadline of tasks that aren't due yet, so the caller knows how long it may sleep.
+     */
+    HPVDecodePool::Task * HPVDecodePool::claim(Worker * worker, uint64_t now, uint64_t * earliest)
+    {
+        std::lock_guard<std::mutex> worker_lock(worker->mtx);
+
+        Task * best = nullptr;
+        uint64_t best_deadline = 0;
+
+        for (Task * task : worker->tasks)
+        {
+            if (task->running.load(std::memory_order_relaxed))
+            {
+                continue;
+            }
+
+            uint64_t deadline = task->deadline.load(std::memory_order_acquire);
+
+            if (deadline > now)
+            {
+                *earliest = std::min(*earliest, deadline);
+            }
+            else if (!best || deadline < best_deadline)
+            {
+                best = task;
+                best_deadline = deadline;
+            }
+        }
+
+        if (best)
+        {
+            best->running.store(true, std::memory_order_relaxed);
+        }
+
+        return best;
+    }
+
+    /*
+     *  Steps a claimed task. As long as it stays due it is stepped again, for at most HPV_POOL_TIME_SLICE:
+     *  a player catching up then reuses its own frame buffers while they are still in cache.
+     */
+    void HPVDecodePool::run(Task * task)
+    {
+        uint64_t slice_end = ns() + HPV_POOL_TIME_SLICE;
+        uint64_t now;
+
+        do
+        {
+            task->deadline.store(HPV_TASK_RUNNING, std::memory_order_relaxed);
+
+            uint64_t next_deadline = task->player->step();
+
+            // a wake() during the step reset the deadline to 0, keep that
+            uint64_t running = HPV_TASK_RUNNING;
+            task->deadline.compare_exchange_strong(running, next_deadline, std::memory_order_acq_rel);
+
+            _num_steps.fetch_add(1, std::memory_order_relaxed);
+
+            now = ns();
+        }
+        while (now < slice_end && task->deadline.load(std::memory_order_acquire) <= now && _should_work.load(std::memory_order_relaxed));
+
+        task->running.store(false, std::memory_order_release);
+    }
+
+    void HPVDecodePool::work(unsigned worker_idx)
+    {
+        const std::size_t num_workers = _workers.size();
+
+        while (_should_work.load(std::memory_order_acquire))
+        {
+            uint64_t generation;
+            {
+                std::lock_guard<std::mutex> lock(_sleep_mtx);
+                generation = _wake_generation;
+            }
+
+            // parts of a frame someone is waiting for come before stepping players
+            if (helpJob())
+            {
+                continue;
+            }
+
+            uint64_t now = ns();
+            uint64_t earliest = HPV_STEP_WHEN_WOKEN;
+
+            // own players first, then steal the ones other workers didn't get to yet
+            Task * task = claim(_workers[worker_idx].get(), now, &earliest);
+
+            for (std::size_t i = 1; !task && i < num_workers; ++i)
+            {
+                task = claim(_workers[(worker_idx + i) % num_workers].get(), now, &earliest);
+
+                if (task)
+                {
+                    _num_steals.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            if (task)
+            {
+                run(task);
+                continue;
+            }
+
+            // nothing due: sleep until the earliest deadline, or until a player is added or woken up
+            std::unique_lock<std::mutex> lock(_sleep_mtx);
+            auto woken = [this, generation]
+            {
+                return generation != _wake_generation || !_should_work.load(std::memory_order_relaxed);
+            };
+
+            if (HPV_STEP_WHEN_WOKEN == earliest)
+            {
+                _wakeup.wait(lock, woken);
+            }
+            else
+            {
+                _wakeup.wait_for(lock, std::chrono::nanoseconds(earliest - now), woken);
+            }
+        }
+    }
+
+} /* End HPV namespace */
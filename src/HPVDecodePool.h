@@ -0,0 +1,109 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <stdint.h>
+
+#define HPV_POOL_TIME_SLICE         2000000     /* ns a worker may keep stepping the same player while it stays due */
+
+namespace HPV {
+
+    class HPVPlayer;
+
+    /*
+     * HPVThreadingModel selects who runs the read + decode work of the players
+     */
+    enum class HPVThreadingModel : std::uint8_t
+    {
+        HPV_THREADS_PER_PLAYER = 0,     /* every player spins in its own update thread */
+        HPV_THREADS_POOL,               /* all players are stepped by the HPVDecodePool owned by the HPVManager */
+        HPV_NUM_THREADING_MODELS = 2
+    };
+
+    /*
+     *  HPVDecodePool: a fixed number of worker threads, by default one per core, that run HPVPlayer::step()
+     *  for all players in order of their deadline. Every player has a home worker that steps it; when a
+     *  worker has nothing due it steals due players from the other workers. A player is never stepped by
+     *  two workers at the same time.
+     *  parallelFor() spreads the parts of a single job, e.g. the slices of one frame, over the workers.
+     */
+    class HPVDecodePool
+    {
+    public:
+        HPVDecodePool();
+        ~HPVDecodePool();
+
+        int                 init(unsigned num_threads = 0);
+        void                shutdown();
+        bool                isInit();
+        unsigned            getNumThreads();
+
+        void                addPlayer(HPVPlayer * player);
+        void                removePlayer(HPVPlayer * player);
+        void                wake(HPVPlayer * player);
+
+        /* Calls func(0) ... func(count - 1) on the workers and the calling thread, returns when all calls are done */
+        void                parallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+        uint64_t            getNumSteps();
+        uint64_t            getNumSteals();
+
+    private:
+        struct Task
+        {
+            HPVPlayer *             player;
+            std::atomic<uint64_t>   deadline;   /* ns() at which the player wants its next step */
+            std::atomic<bool>       running;
+        };
+
+        struct Job
+        {
+            const std::function<void(uint32_t)> * func;
+            uint32_t                count;
+            std::atomic<uint32_t>   next;       /* next index to hand out */
+            std::atomic<uint32_t>   done;       /* indices finished */
+            uint32_t                helpers;    /* workers inside runJob(), guarded by _jobs_mtx */
+        };
+
+        struct Worker
+        {
+            std::mutex              mtx;        /* guards 'tasks' */
+            std::vector<Task *>     tasks;
+            std::thread             thread;
+        };
+
+        void                work(unsigned worker_idx);
+        Task *              claim(Worker * worker, uint64_t now, uint64_t * earliest);
+        void                run(Task * task);
+        void                runJob(Job * job);
+        bool                helpJob();
+        void                notify();
+
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::mutex          _pool_mtx;      /* guards starting/stopping the workers and adding/removing players */
+        std::mutex          _jobs_mtx;      /* guards '_jobs' and Job::helpers */
+        std::vector<Job *>  _jobs;
+        std::mutex          _sleep_mtx;
+        std::condition_variable _wakeup;
+        uint64_t            _wake_generation;
+        std::atomic<bool>   _should_work;
+        std::atomic<bool>   _is_init;       /* written under _pool_mtx, read without it by isInit() and parallelFor() */
+        unsigned            _next_worker;
+        std::atomic<uint64_t> _num_steps;
+        std::atomic<uint64_t> _num_steals;
+    };
+
+} /* End HPV namespace */
@@ -0,0 +1,486 @@
+#include <string.h>
+#include <algorithm>
+
+#include "HPVEncoder.h"
+#include "HPVDXT.h"
+#include "HPVChecksum.h"
+#include "Log.h"
+#include "lz4.h"
+#include "lz4hc.h"
+
+namespace HPV {
+
+    HPVEncoder::HPVEncoder()
+    : _source(nullptr)
+    , _num_frames(0)
+    , _num_tiles(1)
+    , _bytes_per_frame(0)
+    , _next_frame(0)
+    , _next_write(0)
+    , _failed(false)
+    , _num_bytes_written(0)
+    {
+        memset(&_header, 0, sizeof(_header));
+    }
+
+    HPVEncoder::~HPVEncoder()
+    {
+    }
+
+    int HPVEncoder::validate(uint32_t num_frames)
+    {
+        const HPVEncoderSettings& s = _settings;
+
+        if (0 == num_frames)
+        {
+            _error = "No frames to encode";
+            return HPV_RET_ERROR;
+        }
+
+        if (0 == s.width || 0 == s.height || s.width > HPV_MAX_SIDE_SIZE || s.height > HPV_MAX_SIDE_SIZE)
+        {
+            _error = "Width and height need to be between 1 and " + std::to_string(HPV_MAX_SIDE_SIZE);
+            return HPV_RET_ERROR;
+        }
+
+        if ((s.width % 4) != 0 || (s.height % 4) != 0)
+        {
+            _error = "Width and height need to be multiples of 4 (DXT blocks)";
+            return HPV_RET_ERROR;
+        }
+
+        if (0 == s.frame_rate)
+        {
+            _error = "Frame rate can't be 0";
+            return HPV_RET_ERROR;
+        }
+
+        if (s.compression_type >= HPVCompressionType::HPV_NUM_TYPES)
+        {
+            _error = "Unknown compression type";
+            return HPV_RET_ERROR;
+        }
+
+        if (s.lz4_level < 0 || s.lz4_level > 16)
+        {
+            _error = "LZ4 level needs to be between 0 (fast) and 16";
+            return HPV_RET_ERROR;
+        }
+
+        if (s.frame_alignment > 1 && (s.frame_alignment & (s.frame_alignment - 1)) != 0)
+        {
+            _error = "Frame alignment needs to be a power of 2";
+            return HPV_RET_ERROR;
+        }
+
+        uint32_t block_columns = s.width / 4;
+        uint32_t block_rows = s.height / 4;
+        uint32_t tile_columns = std::max(1u, s.tile_columns);
+        uint32_t tile_rows = std::max(1u, s.tile_rows);
+
+        if (s.num_slices > HPV_MAX_SLICES || s.num_slices > block_rows)
+        {
+            _error = "At most " + std::to_string(std::min<uint32_t>(HPV_MAX_SLICES, block_rows)) + " slices for this frame size";
+            return HPV_RET_ERROR;
+        }
+
+        if (tile_columns > block_columns || tile_rows > block_rows || tile_columns * tile_rows > HPV_MAX_TILES)
+        {
+            _error = "Invalid tile grid: at most " + std::to_string(HPV_MAX_TILES) + " tiles, of at least one DXT block each";
+            return HPV_RET_ERROR;
+        }
+
+        if (tile_columns * tile_rows > 1 && s.num_slices > 1)
+        {
+            _error = "Frames can be either sliced or tiled, not both";
+            return HPV_RET_ERROR;
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    int HPVEncoder::encode(const std::string& filepath, uint32_t num_frames, const HPVEncoderSettings& settings,
+                           const HPVFrameSource& source, const HPVEncodeProgress& progress)
+    {
+        _settings = settings;
+        _error.clear();
+        _num_bytes_written = 0;
+
+        if (!validate(num_frames))
+        {
+            HPV_ERROR("%s", _error.c_str());
+            return HPV_RET_ERROR;
+        }
+
+        _num_frames = num_frames;
+        _num_tiles = std::max(1u, _settings.tile_columns) * std::max(1u, _settings.tile_rows);
+        _bytes_per_frame = (_settings.width / 4) * (_settings.height / 4) * DXTBlockSize(_settings.compression_type);
+        _source = &source;
+
+        // the oldest version that describes the layout, so older players keep reading what they can
+        memset(&_header, 0, sizeof(_header));
+        _header.magic = HPV_MAGIC;
+        _header.version = HPV_VERSION_0_0_6;
+        _header.video_width = _settings.width;
+        _header.video_height = _settings.height;
+        _header.number_of_frames = num_frames;
+        _header.frame_rate = _settings.frame_rate;
+        _header.compression_type = _settings.compression_type;
+
+        if (_settings.frame_alignment > 1)
+        {
+            _header.version = HPV_VERSION_0_0_7;
+            _header.frame_alignment = _settings.frame_alignment;
+        }
+
+        if (_settings.num_slices > 1)
+        {
+            _header.version = HPV_VERSION_0_0_8;
+            _header.num_slices = _settings.num_slices;
+        }
+
+        if (_num_tiles > 1)
+        {
+            _header.version = HPV_VERSION_0_0_9;
+            _header.tile_columns = std::max(1u, _settings.tile_columns);
+            _header.tile_rows = std::max(1u, _settings.tile_rows);
+        }
+
+        if (_settings.frame_checksums)
+        {
+            _header.version = HPV_VERSION_0_0_10;
+        }
+
+        bool has_frame_index = (_header.version >= HPV_VERSION_0_0_10);
+
+        std::ofstream ofs(filepath, std::ios::binary | std::ios::trunc);
+
+        if (!ofs.is_open())
+        {
+            fail("Couldn't open " + filepath + " for writing");
+            HPV_ERROR("%s", _error.c_str());
+            return HPV_RET_ERROR;
+        }
+
+        // room for the header and the tables, they are filled in once all frame sizes are known
+        std::size_t num_tile_entries = (_num_tiles > 1) ? static_cast<std::size_t>(num_frames) * _num_tiles : 0;
+        std::vector<uint32_t> frame_sizes(has_frame_index ? 0 : num_frames, 0);
+        std::vector<HPVFrameIndexEntry> frame_index(has_frame_index ? num_frames : 0);
+        std::vector<uint32_t> tile_index(num_tile_entries, 0);
+        std::vector<uint32_t> tile_crcs(has_frame_index ? num_tile_entries : 0, 0);
+
+        uint64_t num_bytes_in_header = sizeof(uint32_t) * header_fields_for_version(_header.version);
+        uint64_t offset = num_bytes_in_header + frame_index.size() * sizeof(HPVFrameIndexEntry)
+                        + (frame_sizes.size() + tile_index.size() + tile_crcs.size()) * sizeof(uint32_t);
+
+        std::vector<char> zeros(static_cast<std::size_t>(std::max<uint64_t>(offset, _settings.frame_alignment)), 0);
+        ofs.write(zeros.data(), offset);
+
+        unsigned num_threads = _settings.num_threads ? _settings.num_threads : std::max(1u, std::thread::hardware_concurrency());
+        num_threads = std::min(num_threads, num_frames);
+
+        _window.clear();
+        _window.resize(2 * num_threads);
+        for (EncodedFrame& slot : _window)
+        {
+            slot.ready = false;
+        }
+
+        _next_frame = 0;
+        _next_write = 0;
+        _failed = false;
+
+        for (unsigned thread_idx = 0; thread_idx < num_threads; ++thread_idx)
+        {
+            _threads.push_back(std::thread(&HPVEncoder::work, this));
+        }
+
+        uint32_t crc = 0;
+
+        // write the frames in order as they come out of the pipeline
+        for (uint32_t frame = 0; frame < num_frames; ++frame)
+        {
+            EncodedFrame * slot = &_window[frame % _window.size()];
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _frame_done.wait(lock, [this, slot]{ return slot->ready || _failed; });
+
+                if (_failed)
+                {
+                    break;
+                }
+            }
+
+            uint64_t aligned = align_up(offset, _settings.frame_alignment);
+            ofs.write(zeros.data(), aligned - offset);
+            ofs.write(slot->data.data(), slot->data.size());
+
+            if (!ofs.good())
+            {
+                fail("Failed writing frame " + std::to_string(frame) + " to " + filepath);
+                break;
+            }
+
+            offset = aligned + slot->data.size();
+
+            if (has_frame_index)
+            {
+                frame_index[frame].offset = aligned;
+                frame_index[frame].size = static_cast<uint32_t>(slot->data.size());
+                frame_index[frame].crc = slot->crc;
+            }
+            else
+            {
+                frame_sizes[frame] = static_cast<uint32_t>(slot->data.size());
+                crc += frame_sizes[frame];
+            }
+
+            if (_num_tiles > 1)
+            {
+                std::copy(slot->tile_sizes.begin(), slot->tile_sizes.end(), tile_index.begin() + static_cast<std::size_t>(frame) * _num_tiles);
+                std::copy(slot->tile_crcs.begin(), slot->tile_crcs.end(), tile_crcs.begin() + static_cast<std::size_t>(frame) * _num_tiles);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                slot->ready = false;
+                ++_next_write;
+            }
+            _frame_written.notify_all();
+
+            if (progress)
+            {
+                progress(frame + 1, num_frames);
+            }
+        }
+
+        for (std::thread& thread : _threads)
+        {
+            thread.join();
+        }
+        _threads.clear();
+        _window.clear();
+
+        if (_failed)
+        {
+            HPV_ERROR("%s", _error.c_str());
+            return HPV_RET_ERROR;
+        }
+
+        if (has_frame_index)
+        {
+            crc = CRC32C(frame_index.data(), frame_index.size() * sizeof(HPVFrameIndexEntry));
+            crc = CRC32C(tile_index.data(), tile_index.size() * sizeof(uint32_t), crc);
+            crc = CRC32C(tile_crcs.data(), tile_crcs.size() * sizeof(uint32_t), crc);
+        }
+
+        _header.crc_frame_sizes = crc;
+
+        ofs.seekp(0);
+        ofs.write(reinterpret_cast<const char *>(&_header), num_bytes_in_header);
+        ofs.write(reinterpret_cast<const char *>(frame_sizes.data()), frame_sizes.size() * sizeof(uint32_t));
+        ofs.write(reinterpret_cast<const char *>(frame_index.data()), frame_index.size() * sizeof(HPVFrameIndexEntry));
+        ofs.write(reinterpret_cast<const char *>(tile_index.data()), tile_index.size() * sizeof(uint32_t));
+        ofs.write(reinterpret_cast<const char *>(tile_crcs.data()), tile_crcs.size() * sizeof(uint32_t));
+        ofs.close();
+
+        if (ofs.fail())
+        {
+            fail("Failed writing the header of " + filepath);
+            HPV_ERROR("%s", _error.c_str());
+            return HPV_RET_ERROR;
+        }
+
+        _num_bytes_written = offset;
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    /*
+     *  Encoder thread: takes the next frame as long as it fits in the window of frames not yet written
+     */
+    void HPVEncoder::work()
+    {
+        std::vector<unsigned char> rgba(static_cast<std::size_t>(_settings.width) * _settings.height * 4);
+        std::vector<unsigned char> dxt(_bytes_per_frame);
+        std::vector<unsigned char> tile((_num_tiles > 1) ? _bytes_per_frame : 0);
+
+        // LZ4 HC state on the heap instead of the stack of every call; needs 8 byte alignment
+        std::vector<uint64_t> lz4_state((LZ4_sizeofStateHC() + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+
+        for (;;)
+        {
+            uint32_t frame;
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _frame_written.wait(lock, [this]
+                {
+                    return _failed || _next_frame >= _num_frames || _next_frame < _next_write + _window.size();
+                });
+
+                if (_failed || _next_frame >= _num_frames)
+                {
+                    return;
+                }
+
+                frame = _next_frame++;
+            }
+
+            EncodedFrame * slot = &_window[frame % _window.size()];
+
+            if (!encodeFrame(frame, rgba.data(), dxt.data(), tile.data(), lz4_state.data(), slot))
+            {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mtx);
+                slot->ready = true;
+            }
+            _frame_done.notify_all();
+        }
+    }
+
+    int HPVEncoder::encodeFrame(uint32_t frame, unsigned char * rgba, unsigned char * dxt, unsigned char * tile, void * lz4_state, EncodedFrame * out)
+    {
+        if (!(*_source)(frame, rgba))
+        {
+            fail("Couldn't get the pixels of frame " + std::to_string(frame));
+            return HPV_RET_ERROR;
+        }
+
+        if (!CompressImageDXT(rgba, _settings.width, _settings.height, _settings.compression_type, dxt))
+        {
+            fail("Couldn't DXT compress frame " + std::to_string(frame));
+            return HPV_RET_ERROR;
+        }
+
+        out->data.clear();
+        out->tile_sizes.clear();
+        out->tile_crcs.clear();
+
+        uint32_t block_columns = _settings.width / 4;
+        uint32_t block_rows = _settings.height / 4;
+        std::size_t bytes_per_block = DXTBlockSize(_settings.compression_type);
+
+        if (_num_tiles > 1)
+        {
+            // tiles in row-major order, each holding its block rows top to bottom
+            for (uint32_t row = 0; row < _header.tile_rows; ++row)
+            {
+                for (uint32_t column = 0; column < _header.tile_columns; ++column)
+                {
+                    uint32_t first_block_row = tile_first_block(row, block_rows, _header.tile_rows);
+                    uint32_t last_block_row = tile_first_block(row + 1, block_rows, _header.tile_rows);
+                    uint32_t first_block_column = tile_first_block(column, block_columns, _header.tile_columns);
+                    std::size_t tile_row_bytes = (tile_first_block(column + 1, block_columns, _header.tile_columns) - first_block_column) * bytes_per_block;
+                    std::size_t tile_bytes = 0;
+
+                    for (uint32_t block_row = first_block_row; block_row < last_block_row; ++block_row)
+                    {
+                        memcpy(tile + tile_bytes, dxt + (static_cast<std::size_t>(block_row) * block_columns + first_block_column) * bytes_per_block, tile_row_bytes);
+                        tile_bytes += tile_row_bytes;
+                    }
+
+                    uint32_t size = compressPart(tile, tile_bytes, lz4_state, out->data);
+                    
+                    if (0 == size)
+                    {
+                        fail("Couldn't LZ4 compress frame " + std::to_string(frame));
+                        return HPV_RET_ERROR;
+                    }
+                    
+                    out->tile_sizes.push_back(size);
+                }
+            }
+        }
+        else if (_settings.num_slices > 1)
+        {
+            // slice sizes table, then the slices
+            std::size_t bytes_per_block_row = block_columns * bytes_per_block;
+            out->data.resize(_settings.num_slices * sizeof(uint32_t));
+
+            for (uint32_t slice = 0; slice < _settings.num_slices; ++slice)
+            {
+                std::size_t begin = slice_first_block_row(slice, block_rows, _settings.num_slices) * bytes_per_block_row;
+                std::size_t end = slice_first_block_row(slice + 1, block_rows, _settings.num_slices) * bytes_per_block_row;
+
+                uint32_t size = compressPart(dxt + begin, end - begin, lz4_state, out->data);
+                
+                if (0 == size)
+                {
+                    fail("Couldn't LZ4 compress frame " + std::to_string(frame));
+                    return HPV_RET_ERROR;
+                }
+                
+                memcpy(&out->data[slice * sizeof(uint32_t)], &size, sizeof(uint32_t));
+            }
+        }
+        else if (0 == compressPart(dxt, _bytes_per_frame, lz4_state, out->data))
+        {
+            fail("Couldn't LZ4 compress frame " + std::to_string(frame));
+            return HPV_RET_ERROR;
+        }
+
+        // checksums of what ends up in the file, computed here so they're spread over the encoder threads
+        if (_header.version >= HPV_VERSION_0_0_10)
+        {
+            out->crc = CRC32C(out->data.data(), out->data.size());
+            
+            std::size_t tile_offset = 0;
+            for (uint32_t size : out->tile_sizes)
+            {
+                out->tile_crcs.push_back(CRC32C(out->data.data() + tile_offset, size));
+                tile_offset += size;
+            }
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    /*
+     *  Appends one LZ4 stream to 'out', returns its size or 0 on failure
+     */
+    uint32_t HPVEncoder::compressPart(const unsigned char * src, std::size_t size, void * lz4_state, std::vector<char>& out)
+    {
+        std::size_t offset = out.size();
+        int bound = LZ4_compressBound(static_cast<int>(size));
+
+        out.resize(offset + bound);
+
+        int compressed = (_settings.lz4_level > 0)
+            ? LZ4_compress_HC_extStateHC(lz4_state, (const char *)src, &out[offset], static_cast<int>(size), bound, _settings.lz4_level)
+            : LZ4_compress_default((const char *)src, &out[offset], static_cast<int>(size), bound);
+
+        out.resize(offset + std::max(compressed, 0));
+
+        return static_cast<uint32_t>(compressed);
+    }
+
+    void HPVEncoder::fail(const std::string& error)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+
+            if (!_failed)
+            {
+                _failed = true;
+                _error = error;
+            }
+        }
+
+        _frame_done.notify_all();
+        _frame_written.notify_all();
+    }
+
+    uint64_t HPVEncoder::getNumBytesWritten()
+    {
+        return _num_bytes_written;
+    }
+
+    std::string HPVEncoder::getLastError()
+    {
+        return _error;
+    }
+
+} /* End HPV namespace */
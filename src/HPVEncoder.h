@@ -0,0 +1,101 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <stdint.h>
+
+#include "HPVHeader.h"
+
+namespace HPV {
+
+    /*
+     * HPVEncoderSettings: what the encoder writes, see HPVHeader.h for the layouts
+     */
+    struct HPVEncoderSettings
+    {
+        uint32_t            width = 0;                  /* multiple of 4 */
+        uint32_t            height = 0;                 /* multiple of 4 */
+        uint32_t            frame_rate = 30;
+        HPVCompressionType  compression_type = HPVCompressionType::HPV_TYPE_DXT1_NO_ALPHA;
+        int                 lz4_level = HPV_LZ4_COMPRESSION_LEVEL;  /* 0: fast LZ4, 1 - 16: LZ4 HC */
+        uint32_t            frame_alignment = 0;        /* 0 or 1: packed frames, e.g. HPV_DIRECT_IO_ALIGNMENT for unbuffered reads */
+        uint32_t            num_slices = 0;             /* 0 or 1: one LZ4 stream per frame */
+        uint32_t            tile_columns = 0;           /* tiles: both 0 or 1 for untiled frames */
+        uint32_t            tile_rows = 0;
+        bool                frame_checksums = true;     /* version 10: 64-bit frame index with a CRC32C per frame (and tile) */
+        unsigned            num_threads = 0;            /* 0: one per core */
+    };
+
+    /* Fills 'rgba' with frame 'frame', width * height * 4 bytes. Called from the encoder threads, frames in any order. */
+    typedef std::function<int(uint32_t frame, unsigned char * rgba)> HPVFrameSource;
+
+    /* Called from the thread running encode() after every written frame */
+    typedef std::function<void(uint32_t num_written, uint32_t num_frames)> HPVEncodeProgress;
+
+    /*
+     *  HPVEncoder: writes .hpv files. Frames go through a frame-parallel pipeline: every encoder thread takes the
+     *  next frame, gets its pixels from the frame source, DXT compresses it and LZ4 compresses the result, while the
+     *  thread that called encode() writes the finished frames to the file in order. At most two frames per thread
+     *  are in flight, so memory use doesn't depend on the length of the sequence.
+     *  The file gets the lowest HPV version that can describe the chosen layout.
+     */
+    class HPVEncoder
+    {
+    public:
+        HPVEncoder();
+        ~HPVEncoder();
+
+        int                 encode(const std::string& filepath, uint32_t num_frames, const HPVEncoderSettings& settings,
+                                   const HPVFrameSource& source, const HPVEncodeProgress& progress = nullptr);
+
+        uint64_t            getNumBytesWritten();
+        std::string         getLastError();
+
+    private:
+        struct EncodedFrame
+        {
+            std::vector<char>       data;
+            std::vector<uint32_t>   tile_sizes;
+            std::vector<uint32_t>   tile_crcs;
+            uint32_t                crc;
+            bool                    ready;
+        };
+
+        int                 validate(uint32_t num_frames);
+        void                work();
+        int                 encodeFrame(uint32_t frame, unsigned char * rgba, unsigned char * dxt, unsigned char * tile, void * lz4_state, EncodedFrame * out);
+        uint32_t            compressPart(const unsigned char * src, std::size_t size, void * lz4_state, std::vector<char>& out);
+        void                fail(const std::string& error);
+
+        HPVEncoderSettings  _settings;
+        HPVHeader           _header;
+        const HPVFrameSource * _source;
+        uint32_t            _num_frames;
+        uint32_t            _num_tiles;
+        std::size_t         _bytes_per_frame;
+        std::vector<EncodedFrame> _window;      /* frame i is encoded into _window[i % size] */
+        std::vector<std::thread> _threads;
+        std::mutex          _mtx;               /* guards everything below */
+        std::condition_variable _frame_done;
+        std::condition_variable _frame_written;
+        uint32_t            _next_frame;
+        uint32_t            _next_write;
+        bool                _failed;
+        std::string         _error;
+        uint64_t            _num_bytes_written;
+    };
+
+} /* End HPV namespace */
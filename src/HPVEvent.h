@@ -25,7 +25,8 @@ namespace HPV {
         HPV_EVENT_STOP,
         HPV_EVENT_RESUME,
         HPV_EVENT_LOOP,
-        HPV_EVENT_NUM_TYPES = 5
+        HPV_EVENT_CORRUPT_FRAME,        /* a frame didn't match its checksum, see HPVPlayer::setVerifyFrames() */
+        HPV_EVENT_NUM_TYPES = 6
     };
     
     /*
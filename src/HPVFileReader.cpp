@@ -0,0 +1,720 @@
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "HPVFileReader.h"
+#include "HPVPlayer.h"
+#include "HPVManager.h"
+#include "Log.h"
+
+#if !defined(_WIN32)
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+namespace HPV {
+
+    void * AlignedAlloc(std::size_t size, std::size_t alignment)
+    {
+        alignment = std::max<std::size_t>(alignment, sizeof(void *));
+#if defined(_WIN32)
+        return _aligned_malloc(size, alignment);
+#else
+        void * ptr = nullptr;
+        if (posix_memalign(&ptr, alignment, size) != 0)
+        {
+            return nullptr;
+        }
+        return ptr;
+#endif
+    }
+
+    void AlignedFree(void * ptr)
+    {
+#if defined(_WIN32)
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+    }
+
+#if !defined(_WIN32)
+    /* Kernel read-ahead only works forwards: sequential access when playing forwards, none at all when reversing */
+    static void AdviseAccess(int fd, int direction)
+    {
+#  if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(fd, 0, 0, (HPV_DIRECTION_FORWARDS == direction) ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+#  elif defined(F_RDAHEAD)
+        fcntl(fd, F_RDAHEAD, (HPV_DIRECTION_FORWARDS == direction) ? 1 : 0);
+#  endif
+    }
+
+    /* Starts reading a region into the page cache, without waiting for it */
+    static void AdviseWillNeed(int fd, uint64_t offset, std::size_t size)
+    {
+#  if defined(POSIX_FADV_WILLNEED)
+        posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+#  elif defined(F_RDADVISE)
+        struct radvisory advice;
+        advice.ra_offset = static_cast<off_t>(offset);
+        advice.ra_count = static_cast<int>(size);
+        fcntl(fd, F_RDADVISE, &advice);
+#  endif
+    }
+#endif
+
+    /*******************************************************************************
+     * HPVFileReader
+     *******************************************************************************/
+    int HPVFileReader::submit(HPVReadRequest * requests, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            requests[i].result = read(requests[i].offset, requests[i].size, requests[i].dst);
+            requests[i].done = true;
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    int HPVFileReader::wait(HPVReadRequest * request)
+    {
+        return request->result;
+    }
+
+    /*******************************************************************************
+     * HPVStreamReader
+     *******************************************************************************/
+    int HPVStreamReader::open(const std::string& filepath)
+    {
+        _ifs.open(filepath.c_str(), std::ios::binary | std::ios::in);
+
+        if (!_ifs.is_open())
+        {
+            return HPV_RET_ERROR;
+        }
+
+        // get filesize of HPV file
+        _ifs.seekg(0, std::ifstream::end);
+        _filesize = static_cast<uint64_t>(_ifs.tellg());
+        _ifs.seekg(0, std::ios_base::beg);
+
+#if !defined(_WIN32)
+        _hint_fd = ::open(filepath.c_str(), O_RDONLY);
+#endif
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    void HPVStreamReader::close()
+    {
+        if (_ifs.is_open())
+        {
+            _ifs.close();
+        }
+
+#if !defined(_WIN32)
+        if (_hint_fd >= 0)
+        {
+            ::close(_hint_fd);
+            _hint_fd = -1;
+        }
+#endif
+
+        _filesize = 0;
+    }
+
+    bool HPVStreamReader::isOpen()
+    {
+        return _ifs.is_open();
+    }
+
+    uint64_t HPVStreamReader::getFileSize()
+    {
+        return _filesize;
+    }
+
+    int HPVStreamReader::read(uint64_t offset, std::size_t size, char * dst)
+    {
+        _ifs.seekg(offset);
+
+        if (!_ifs.good())
+        {
+            HPV_ERROR("Failed to seek to %" PRIu64, offset);
+            return HPV_RET_ERROR;
+        }
+
+        _ifs.read(dst, size);
+
+        if (!_ifs.good())
+        {
+            HPV_ERROR("Couldn't read %zu bytes at %" PRIu64 " from disk!", size, offset);
+            _ifs.clear();
+            return HPV_RET_ERROR;
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    const char * HPVStreamReader::acquire(uint64_t offset, std::size_t size, char * scratch)
+    {
+        if (!scratch || !read(offset, size, scratch))
+        {
+            return nullptr;
+        }
+
+        return scratch;
+    }
+
+    void HPVStreamReader::adviseDirection(int direction)
+    {
+#if !defined(_WIN32)
+        // hints go to the page cache of the file, the descriptor they are given on doesn't matter
+        if (_hint_fd >= 0)
+        {
+            AdviseAccess(_hint_fd, direction);
+        }
+#endif
+    }
+
+    void HPVStreamReader::willNeed(uint64_t offset, std::size_t size)
+    {
+#if !defined(_WIN32)
+        if (_hint_fd >= 0)
+        {
+            AdviseWillNeed(_hint_fd, offset, size);
+        }
+#endif
+    }
+
+    /*******************************************************************************
+     * HPVMMapReader
+     *******************************************************************************/
+    HPVMMapReader::~HPVMMapReader()
+    {
+        close();
+    }
+
+    int HPVMMapReader::open(const std::string& filepath)
+    {
+#if defined(_WIN32)
+        _file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+        if (_file == INVALID_HANDLE_VALUE)
+        {
+            return HPV_RET_ERROR;
+        }
+
+        LARGE_INTEGER filesize;
+        if (!GetFileSizeEx(_file, &filesize) || filesize.QuadPart == 0)
+        {
+            close();
+            return HPV_RET_ERROR;
+        }
+        _filesize = static_cast<uint64_t>(filesize.QuadPart);
+
+        _file_mapping = CreateFileMappingA(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if (_file_mapping == NULL)
+        {
+            close();
+            return HPV_RET_ERROR;
+        }
+
+        _mapping = static_cast<const char *>(MapViewOfFile(_file_mapping, FILE_MAP_READ, 0, 0, 0));
+
+        if (!_mapping)
+        {
+            close();
+            return HPV_RET_ERROR;
+        }
+#else
+        _fd = ::open(filepath.c_str(), O_RDONLY);
+
+        if (_fd < 0)
+        {
+            return HPV_RET_ERROR;
+        }
+
+        struct stat st;
+        if (fstat(_fd, &st) != 0 || st.st_size == 0)
+        {
+            close();
+            return HPV_RET_ERROR;
+        }
+        _filesize = static_cast<uint64_t>(st.st_size);
+
+        void * mapping = mmap(NULL, _filesize, PROT_READ, MAP_SHARED, _fd, 0);
+
+        if (mapping == MAP_FAILED)
+        {
+            HPV_ERROR("Failed to memory-map %s: %s", filepath.c_str(), strerror(errno));
+            close();
+            return HPV_RET_ERROR;
+        }
+
+        _mapping = static_cast<const char *>(mapping);
+
+        // playback starts forwards
+        adviseDirection(HPV_DIRECTION_FORWARDS);
+#endif
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    void HPVMMapReader::close()
+    {
+#if defined(_WIN32)
+        if (_mapping)
+        {
+            UnmapViewOfFile(_mapping);
+        }
+
+        if (_file_mapping != NULL)
+        {
+            CloseHandle(_file_mapping);
+            _file_mapping = NULL;
+        }
+
+        if (_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(_file);
+            _file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (_mapping)
+        {
+            munmap(const_cast<char *>(_mapping), _filesize);
+        }
+
+        if (_fd >= 0)
+        {
+            ::close(_fd);
+            _fd = -1;
+        }
+#endif
+        _mapping = nullptr;
+        _filesize = 0;
+    }
+
+    bool HPVMMapReader::isOpen()
+    {
+        return (_mapping != nullptr);
+    }
+
+    uint64_t HPVMMapReader::getFileSize()
+    {
+        return _filesize;
+    }
+
+    int HPVMMapReader::read(uint64_t offset, std::size_t size, char * dst)
+    {
+        const char * src = acquire(offset, size, nullptr);
+
+        if (!src)
+        {
+            return HPV_RET_ERROR;
+        }
+
+        memcpy(dst, src, size);
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    const char * HPVMMapReader::acquire(uint64_t offset, std::size_t size, char * /* scratch */)
+    {
+        if (!_mapping || offset > _filesize || size > _filesize - offset)
+        {
+            HPV_ERROR("Trying to read %zu bytes at %" PRIu64 " outside of the mapped file", size, offset);
+            return nullptr;
+        }
+
+        return _mapping + offset;
+    }
+
+    void HPVMMapReader::adviseDirection(int direction)
+    {
+#if !defined(_WIN32)
+        if (!_mapping)
+        {
+            return;
+        }
+
+        // kernel read-ahead only works forwards, when reversing we prefetch the frames ourselves through willNeed()
+        madvise(const_cast<char *>(_mapping), _filesize, (HPV_DIRECTION_FORWARDS == direction) ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif
+    }
+
+    void HPVMMapReader::willNeed(uint64_t offset, std::size_t size)
+    {
+#if !defined(_WIN32)
+        if (!_mapping || offset > _filesize || size > _filesize - offset)
+        {
+            return;
+        }
+
+        // madvise wants a page aligned start address
+        static const uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        uint64_t aligned_offset = offset - (offset % page_size);
+
+        madvise(const_cast<char *>(_mapping) + aligned_offset, size + (offset - aligned_offset), MADV_WILLNEED);
+#endif
+    }
+
+#if !defined(_WIN32)
+    /*******************************************************************************
+     * HPVAsyncReader
+     *******************************************************************************/
+    HPVAsyncReader::~HPVAsyncReader()
+    {
+        close();
+    }
+
+    int HPVAsyncReader::open(const std::string& filepath)
+    {
+        _fd = ::open(filepath.c_str(), O_RDONLY);
+
+        if (_fd < 0)
+        {
+            return HPV_RET_ERROR;
+        }
+
+        struct stat st;
+        if (fstat(_fd, &st) != 0)
+        {
+            close();
+            return HPV_RET_ERROR;
+        }
+        _filesize = static_cast<uint64_t>(st.st_size);
+
+        // the engine is shared by all players, it is started by whoever needs it first
+        return ManagerSingleton()->getIOEngine()->init();
+    }
+
+    void HPVAsyncReader::close()
+    {
+        if (_fd >= 0)
+        {
+            ::close(_fd);
+            _fd = -1;
+        }
+
+        _filesize = 0;
+    }
+
+    bool HPVAsyncReader::isOpen()
+    {
+        return (_fd >= 0);
+    }
+
+    uint64_t HPVAsyncReader::getFileSize()
+    {
+        return _filesize;
+    }
+
+    int HPVAsyncReader::read(uint64_t offset, std::size_t size, char * dst)
+    {
+        HPVReadRequest request;
+        request.offset = offset;
+        request.size = size;
+        request.dst = dst;
+
+        if (!submit(&request, 1))
+        {
+            return HPV_RET_ERROR;
+        }
+
+        return wait(&request);
+    }
+
+    const char * HPVAsyncReader::acquire(uint64_t offset, std::size_t size, char * scratch)
+    {
+        if (!scratch || !read(offset, size, scratch))
+        {
+            return nullptr;
+        }
+
+        return scratch;
+    }
+
+    int HPVAsyncReader::submit(HPVReadRequest * requests, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            requests[i].fd = _fd;
+        }
+
+        return ManagerSingleton()->getIOEngine()->submit(requests, count);
+    }
+
+    int HPVAsyncReader::wait(HPVReadRequest * request)
+    {
+        return ManagerSingleton()->getIOEngine()->wait(request);
+    }
+
+    void HPVAsyncReader::adviseDirection(int direction)
+    {
+        if (_fd >= 0)
+        {
+            AdviseAccess(_fd, direction);
+        }
+    }
+
+    void HPVAsyncReader::willNeed(uint64_t offset, std::size_t size)
+    {
+        if (_fd >= 0)
+        {
+            AdviseWillNeed(_fd, offset, size);
+        }
+    }
+#endif
+
+    /*******************************************************************************
+     * HPVDirectReader
+     *******************************************************************************/
+    HPVDirectReader::~HPVDirectReader()
+    {
+        close();
+    }
+
+    int HPVDirectReader::open(const std::string& filepath)
+    {
+#if defined(_WIN32)
+        _file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+        _unbuffered = true;
+
+        if (_file == INVALID_HANDLE_VALUE)
+        {
+            return HPV_RET_ERROR;
+        }
+
+        LARGE_INTEGER filesize;
+        if (!GetFileSizeEx(_file, &filesize))
+        {
+            close();
+            return HPV_RET_ERROR;
+        }
+        _filesize = static_cast<uint64_t>(filesize.QuadPart);
+#else
+#  if defined(O_DIRECT)
+        _fd = ::open(filepath.c_str(), O_RDONLY | O_DIRECT);
+        _unbuffered = (_fd >= 0);
+#  endif
+
+        if (_fd < 0)
+        {
+            // O_DIRECT is refused by some filesystems (tmpfs, ...) and doesn't exist on macOS
+            _fd = ::open(filepath.c_str(), O_RDONLY);
+
+            if (_fd < 0)
+            {
+                return HPV_RET_ERROR;
+            }
+
+#  if defined(__APPLE__)
+            _unbuffered = (fcntl(_fd, F_NOCACHE, 1) != -1);
+#  endif
+            if (!_unbuffered)
+            {
+                HPV_WARNING("Unbuffered reads not supported for %s, dropping pages from the cache after reading instead", filepath.c_str());
+            }
+        }
+
+        struct stat st;
+        if (fstat(_fd, &st) != 0)
+        {
+            close();
+            return HPV_RET_ERROR;
+        }
+        _filesize = static_cast<uint64_t>(st.st_size);
+#endif
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    void HPVDirectReader::close()
+    {
+#if defined(_WIN32)
+        if (_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(_file);
+            _file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (_fd >= 0)
+        {
+            ::close(_fd);
+            _fd = -1;
+        }
+#endif
+        _filesize = 0;
+        _unbuffered = false;
+    }
+
+    bool HPVDirectReader::isOpen()
+    {
+#if defined(_WIN32)
+        return (_file != INVALID_HANDLE_VALUE);
+#else
+        return (_fd >= 0);
+#endif
+    }
+
+    uint64_t HPVDirectReader::getFileSize()
+    {
+        return _filesize;
+    }
+
+    std::size_t HPVDirectReader::getScratchAlignment()
+    {
+        return HPV_DIRECT_IO_ALIGNMENT;
+    }
+
+    std::size_t HPVDirectReader::getScratchPadding()
+    {
+        // worst case the frame starts one byte after a block boundary and ends one byte after another one
+        return 2 * HPV_DIRECT_IO_ALIGNMENT;
+    }
+
+    /*
+     *  Reads whole aligned blocks, 'offset', 'size' and 'dst' must all be aligned.
+     *  Reading past the end of the file is fine, 'num_read' tells how much was there.
+     */
+    int HPVDirectReader::readAligned(uint64_t offset, std::size_t size, char * dst, std::size_t * num_read)
+    {
+        *num_read = 0;
+
+#if defined(_WIN32)
+        while (*num_read < size)
+        {
+            OVERLAPPED overlapped;
+            memset(&overlapped, 0, sizeof(overlapped));
+            overlapped.Offset = static_cast<DWORD>((offset + *num_read) & 0xFFFFFFFF);
+            overlapped.OffsetHigh = static_cast<DWORD>((offset + *num_read) >> 32);
+
+            DWORD bytes_read = 0;
+            if (!ReadFile(_file, dst + *num_read, static_cast<DWORD>(size - *num_read), &bytes_read, &overlapped))
+            {
+                if (GetLastError() == ERROR_HANDLE_EOF)
+                {
+                    break;
+                }
+                return HPV_RET_ERROR;
+            }
+
+            if (bytes_read == 0)
+            {
+                break;
+            }
+
+            *num_read += bytes_read;
+        }
+#else
+        while (*num_read < size)
+        {
+            ssize_t ret = pread(_fd, dst + *num_read, size - *num_read, static_cast<off_t>(offset + *num_read));
+
+            if (ret < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (ret < 0)
+            {
+                HPV_ERROR("Unbuffered read of %zu bytes at %" PRIu64 " failed: %s", size, offset, strerror(errno));
+                return HPV_RET_ERROR;
+            }
+
+            if (ret == 0)
+            {
+                break;
+            }
+
+            *num_read += static_cast<std::size_t>(ret);
+        }
+
+#  if defined(POSIX_FADV_DONTNEED)
+        if (!_unbuffered)
+        {
+            posix_fadvise(_fd, static_cast<off_t>(offset), static_cast<off_t>(*num_read), POSIX_FADV_DONTNEED);
+        }
+#  endif
+#endif
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    int HPVDirectReader::read(uint64_t offset, std::size_t size, char * dst)
+    {
+        // only used for the header and tables at open(), go through a temporary aligned buffer
+        std::size_t buffer_size = size + getScratchPadding();
+        char * buffer = static_cast<char *>(AlignedAlloc(buffer_size, HPV_DIRECT_IO_ALIGNMENT));
+
+        if (!buffer)
+        {
+            return HPV_RET_ERROR;
+        }
+
+        const char * src = acquire(offset, size, buffer);
+
+        if (src)
+        {
+            memcpy(dst, src, size);
+        }
+
+        AlignedFree(buffer);
+
+        return (src != nullptr) ? HPV_RET_ERROR_NONE : HPV_RET_ERROR;
+    }
+
+    const char * HPVDirectReader::acquire(uint64_t offset, std::size_t size, char * scratch)
+    {
+        if (!scratch || offset > _filesize || size > _filesize - offset)
+        {
+            return nullptr;
+        }
+
+        uint64_t aligned_start = offset - (offset % HPV_DIRECT_IO_ALIGNMENT);
+        std::size_t aligned_size = static_cast<std::size_t>(align_up(offset + size, HPV_DIRECT_IO_ALIGNMENT) - aligned_start);
+        std::size_t num_read = 0;
+
+        if (!readAligned(aligned_start, aligned_size, scratch, &num_read) || num_read < (offset + size) - aligned_start)
+        {
+            HPV_ERROR("Couldn't read %zu bytes at %" PRIu64 " from disk!", size, offset);
+            return nullptr;
+        }
+
+        return scratch + (offset - aligned_start);
+    }
+
+    /*******************************************************************************
+     * Reader factory
+     *******************************************************************************/
+    std::unique_ptr<HPVFileReader> CreateFileReader(HPVReadMode mode)
+    {
+        switch (mode)
+        {
+            case HPVReadMode::HPV_READ_MMAP:
+                return std::unique_ptr<HPVFileReader>(new HPVMMapReader());
+
+            case HPVReadMode::HPV_READ_DIRECT:
+                return std::unique_ptr<HPVFileReader>(new HPVDirectReader());
+
+            case HPVReadMode::HPV_READ_ASYNC:
+#if !defined(_WIN32)
+                return std::unique_ptr<HPVFileReader>(new HPVAsyncReader());
+#else
+                HPV_WARNING("Async reads are not supported on this platform, using the stream reader");
+                return std::unique_ptr<HPVFileReader>(new HPVStreamReader());
+#endif
+
+            case HPVReadMode::HPV_READ_STREAM:
+            default:
+                return std::unique_ptr<HPVFileReader>(new HPVStreamReader());
+        }
+    }
+
+} /* End HPV namespace */
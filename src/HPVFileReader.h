@@ -0,0 +1,211 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <memory>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <sys/uio.h>
+#endif
+
+namespace HPV {
+
+    /*
+     * HPVReadMode selects how a player gets the compressed frames from disk
+     */
+    enum class HPVReadMode : std::uint8_t
+    {
+        HPV_READ_STREAM = 0,        /* seek + read through a std::ifstream into a separate buffer */
+        HPV_READ_MMAP,              /* the whole file is memory-mapped, frames are decompressed straight from the mapping */
+        HPV_READ_ASYNC,             /* reads are queued on the shared HPVIOEngine (io_uring on Linux, pread otherwise) */
+        HPV_READ_DIRECT,            /* unbuffered reads (O_DIRECT) into aligned buffers, bypassing the page cache */
+        HPV_NUM_READ_MODES = 4
+    };
+
+    /* Allocation helpers for buffers that unbuffered I/O can read into */
+    void *  AlignedAlloc(std::size_t size, std::size_t alignment);
+    void    AlignedFree(void * ptr);
+
+    /*
+     * HPVReadRequest: one region of the file to be read into 'dst' by HPVFileReader::submit()
+     */
+    struct HPVReadRequest
+    {
+        uint64_t        offset;
+        std::size_t     size;
+        char *          dst;
+        int             fd;             /* filled in by the reader */
+        int             result;         /* HPV_RET_ERROR_NONE or HPV_RET_ERROR, valid once 'done' */
+        bool            done;
+        std::size_t     num_read;       /* io_uring engine: bytes the kernel read, wait() reads the rest of a short read */
+#if !defined(_WIN32)
+        struct iovec    iov;            /* used by the io_uring engine, lives until the read completed */
+#endif
+    };
+
+    /*
+     * HPVFileReader: abstract access to the bytes of an HPV file
+     */
+    class HPVFileReader
+    {
+    public:
+        virtual ~HPVFileReader() {}
+
+        virtual int             open(const std::string& filepath) = 0;
+        virtual void            close() = 0;
+        virtual bool            isOpen() = 0;
+        virtual uint64_t        getFileSize() = 0;
+
+        /* Copies 'size' bytes starting at 'offset' into 'dst' */
+        virtual int             read(uint64_t offset, std::size_t size, char * dst) = 0;
+
+        /* Returns a pointer to 'size' bytes starting at 'offset', or nullptr on failure.
+         * Readers that can't point into the file itself read into 'scratch', which must then hold 'size' bytes. */
+        virtual const char *    acquire(uint64_t offset, std::size_t size, char * scratch) = 0;
+
+        /* True when acquire() needs a scratch buffer */
+        virtual bool            needsScratch() = 0;
+
+        /* Requirements on that scratch buffer: alignment of its start and bytes needed on top of the requested size */
+        virtual std::size_t     getScratchAlignment() { return 1; }
+        virtual std::size_t     getScratchPadding() { return 0; }
+
+        /* Batched reads: submit() starts reading all requests, wait() returns once the given one completed.
+         * Synchronous readers simply read everything in submit(). When submit() fails some requests may still be
+         * in flight: wait() on every one of them before the requests go away. */
+        virtual bool            isAsync() { return false; }
+        virtual int             submit(HPVReadRequest * requests, std::size_t count);
+        virtual int             wait(HPVReadRequest * request);
+
+        /* Access pattern hints, ignored by readers that can't make use of them */
+        virtual void            adviseDirection(int /* direction */) {}
+        virtual void            willNeed(uint64_t /* offset */, std::size_t /* size */) {}
+    };
+
+    /*
+     * HPVStreamReader: the classic buffered std::ifstream reader
+     */
+    class HPVStreamReader : public HPVFileReader
+    {
+    public:
+        int             open(const std::string& filepath);
+        void            close();
+        bool            isOpen();
+        uint64_t        getFileSize();
+        int             read(uint64_t offset, std::size_t size, char * dst);
+        const char *    acquire(uint64_t offset, std::size_t size, char * scratch);
+        bool            needsScratch() { return true; }
+        void            adviseDirection(int direction);
+        void            willNeed(uint64_t offset, std::size_t size);
+
+    private:
+        std::ifstream   _ifs;
+        uint64_t        _filesize = 0;
+#if !defined(_WIN32)
+        int             _hint_fd = -1;      /* the stream has no descriptor to give access hints on */
+#endif
+    };
+
+    /*
+     * HPVMMapReader: maps the whole file read-only and hands out pointers into the mapping
+     */
+    class HPVMMapReader : public HPVFileReader
+    {
+    public:
+        ~HPVMMapReader();
+
+        int             open(const std::string& filepath);
+        void            close();
+        bool            isOpen();
+        uint64_t        getFileSize();
+        int             read(uint64_t offset, std::size_t size, char * dst);
+        const char *    acquire(uint64_t offset, std::size_t size, char * scratch);
+        bool            needsScratch() { return false; }
+        void            adviseDirection(int direction);
+        void            willNeed(uint64_t offset, std::size_t size);
+
+    private:
+        const char *    _mapping = nullptr;
+        uint64_t        _filesize = 0;
+#if defined(_WIN32)
+        HANDLE          _file = INVALID_HANDLE_VALUE;
+        HANDLE          _file_mapping = NULL;
+#else
+        int             _fd = -1;
+#endif
+    };
+
+#if !defined(_WIN32)
+    /*
+     * HPVAsyncReader: queues reads on the HPVIOEngine owned by the HPVManager
+     */
+    class HPVAsyncReader : public HPVFileReader
+    {
+    public:
+        ~HPVAsyncReader();
+
+        int             open(const std::string& filepath);
+        void            close();
+        bool            isOpen();
+        uint64_t        getFileSize();
+        int             read(uint64_t offset, std::size_t size, char * dst);
+        const char *    acquire(uint64_t offset, std::size_t size, char * scratch);
+        bool            needsScratch() { return true; }
+        bool            isAsync() { return true; }
+        int             submit(HPVReadRequest * requests, std::size_t count);
+        int             wait(HPVReadRequest * request);
+        void            adviseDirection(int direction);
+        void            willNeed(uint64_t offset, std::size_t size);
+
+    private:
+        int             _fd = -1;
+        uint64_t        _filesize = 0;
+    };
+#endif
+
+    /*
+     * HPVDirectReader: bypasses the page cache. Reads are widened to whole HPV_DIRECT_IO_ALIGNMENT blocks;
+     * files with aligned frames (HPV_VERSION_0_0_7) need no leading over-read, older files are over-read.
+     */
+    class HPVDirectReader : public HPVFileReader
+    {
+    public:
+        ~HPVDirectReader();
+
+        int             open(const std::string& filepath);
+        void            close();
+        bool            isOpen();
+        uint64_t        getFileSize();
+        int             read(uint64_t offset, std::size_t size, char * dst);
+        const char *    acquire(uint64_t offset, std::size_t size, char * scratch);
+        bool            needsScratch() { return true; }
+        std::size_t     getScratchAlignment();
+        std::size_t     getScratchPadding();
+
+    private:
+        int             readAligned(uint64_t offset, std::size_t size, char * dst, std::size_t * num_read);
+
+        uint64_t        _filesize = 0;
+        bool            _unbuffered = false;
+#if defined(_WIN32)
+        HANDLE          _file = INVALID_HANDLE_VALUE;
+#else
+        int             _fd = -1;
+#endif
+    };
+
+    std::unique_ptr<HPVFileReader> CreateFileReader(HPVReadMode mode);
+
+} /* End HPV namespace */
@@ -0,0 +1,211 @@
+#include <string.h>
+#include <algorithm>
+
+#include "HPVFrameCache.h"
+
+namespace HPV {
+
+    HPVFrameCache::HPVFrameCache()
+    : _num_used(0)
+    , _head(-1)
+    , _tail(-1)
+    , _bytes_per_frame(0)
+    , _num_frames(0)
+    , _budget(0)
+    {
+        _num_hits.store(0, std::memory_order_relaxed);
+        _num_misses.store(0, std::memory_order_relaxed);
+    }
+
+    HPVFrameCache::~HPVFrameCache()
+    {
+        clear();
+    }
+
+    void HPVFrameCache::setFrameSize(std::size_t bytes_per_frame, int64_t num_frames)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        _bytes_per_frame = bytes_per_frame;
+        _num_frames = num_frames;
+        allocate();
+    }
+
+    void HPVFrameCache::setBudget(std::size_t num_bytes)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        _budget = num_bytes;
+        allocate();
+    }
+
+    std::size_t HPVFrameCache::getBudget()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _budget;
+    }
+
+    std::size_t HPVFrameCache::getNumFrames()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _num_used;
+    }
+
+    bool HPVFrameCache::get(int64_t frame, unsigned char * dst)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        if (_slots.empty() || frame < 0 || frame >= _num_frames)
+        {
+            return false;
+        }
+
+        int32_t slot = _lookup[frame];
+
+        if (slot < 0)
+        {
+            _num_misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        unlink(slot);
+        pushFront(slot);
+        memcpy(dst, _slots[slot].data.get(), _bytes_per_frame);
+        _num_hits.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    void HPVFrameCache::put(int64_t frame, const unsigned char * src)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        if (_slots.empty() || frame < 0 || frame >= _num_frames)
+        {
+            return;
+        }
+
+        int32_t slot = _lookup[frame];
+
+        if (slot >= 0)
+        {
+            unlink(slot);
+            pushFront(slot);
+            return;
+        }
+
+        if (_num_used < _slots.size())
+        {
+            slot = static_cast<int32_t>(_num_used++);
+        }
+        else
+        {
+            // reuse the slot of the least recently used frame
+            slot = _tail;
+            _lookup[_slots[slot].frame] = -1;
+            unlink(slot);
+        }
+
+        _slots[slot].frame = frame;
+        memcpy(_slots[slot].data.get(), src, _bytes_per_frame);
+        _lookup[frame] = slot;
+        pushFront(slot);
+    }
+
+    void HPVFrameCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+
+        _bytes_per_frame = 0;
+        _num_frames = 0;
+        allocate();
+    }
+
+    void HPVFrameCache::resetCounters()
+    {
+        _num_hits.store(0, std::memory_order_relaxed);
+        _num_misses.store(0, std::memory_order_relaxed);
+    }
+
+    /* Number of frames the budget holds, never more than the file has; called with the lock held */
+    std::size_t HPVFrameCache::capacity()
+    {
+        if (0 == _bytes_per_frame || _num_frames <= 0)
+        {
+            return 0;
+        }
+
+        return std::min<std::size_t>(_budget / _bytes_per_frame, static_cast<std::size_t>(_num_frames));
+    }
+
+    /* Drops all frames and sizes the slots and the lookup table to the budget, called with the lock held */
+    void HPVFrameCache::allocate()
+    {
+        std::size_t num_slots = capacity();
+
+        _num_used = 0;
+        _head = -1;
+        _tail = -1;
+
+        if (0 == num_slots)
+        {
+            std::vector<Slot>().swap(_slots);
+            std::vector<int32_t>().swap(_lookup);
+            return;
+        }
+
+        _slots.resize(num_slots);
+        _lookup.assign(static_cast<std::size_t>(_num_frames), -1);
+
+        for (Slot& slot : _slots)
+        {
+            slot.data.reset(new unsigned char[_bytes_per_frame]);
+            slot.frame = -1;
+        }
+    }
+
+    /* Takes a slot out of the recently used order, called with the lock held */
+    void HPVFrameCache::unlink(int32_t slot)
+    {
+        Slot& s = _slots[slot];
+
+        if (s.prev >= 0)
+        {
+            _slots[s.prev].next = s.next;
+        }
+        else
+        {
+            _head = s.next;
+        }
+
+        if (s.next >= 0)
+        {
+            _slots[s.next].prev = s.prev;
+        }
+        else
+        {
+            _tail = s.prev;
+        }
+    }
+
+    /* Makes a slot the most recently used one, called with the lock held */
+    void HPVFrameCache::pushFront(int32_t slot)
+    {
+        Slot& s = _slots[slot];
+
+        s.prev = -1;
+        s.next = _head;
+
+        if (_head >= 0)
+        {
+            _slots[_head].prev = slot;
+        }
+        else
+        {
+            _tail = slot;
+        }
+
+        _head = slot;
+    }
+
+} /* End HPV namespace */
@@ -0,0 +1,75 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+namespace HPV {
+
+    /*
+     *  HPVFrameCache: the most recently presented frames of a player, still DXT compressed (as they come out of
+     *  LZ4), so going back to one of them is a copy instead of a read and a decompress. Keeps as many frames as
+     *  fit in its budget of bytes and evicts the least recently used one. The frame buffers and a table with the
+     *  slot of every frame of the file are allocated when the budget or the frame size is set, so get() and put()
+     *  never allocate.
+     *
+     *  A budget of 0 (the default) disables the cache: lookups don't count as misses and nothing is stored.
+     *  All functions can be called from any thread.
+     */
+    class HPVFrameCache
+    {
+    public:
+        HPVFrameCache();
+        ~HPVFrameCache();
+
+        void                setFrameSize(std::size_t bytes_per_frame, int64_t num_frames);  /* drops all frames */
+        void                setBudget(std::size_t num_bytes);                               /* drops all frames */
+        std::size_t         getBudget();
+        std::size_t         getNumFrames();
+
+        bool                get(int64_t frame, unsigned char * dst);        /* copies the frame to 'dst' on a hit */
+        void                put(int64_t frame, const unsigned char * src);  /* stores a copy, or only marks it used */
+        void                clear();                                        /* drops all frames and frees them */
+
+        uint64_t            getNumHits() { return _num_hits.load(std::memory_order_relaxed); }
+        uint64_t            getNumMisses() { return _num_misses.load(std::memory_order_relaxed); }
+        void                resetCounters();
+
+    private:
+        struct Slot
+        {
+            int64_t                         frame;
+            int32_t                         prev;   /* more recently used slot, -1 for the first */
+            int32_t                         next;   /* less recently used slot, -1 for the last */
+            std::unique_ptr<unsigned char[]> data;
+        };
+
+        std::size_t         capacity();
+        void                allocate();
+        void                unlink(int32_t slot);
+        void                pushFront(int32_t slot);
+
+        std::vector<Slot>   _slots;
+        std::vector<int32_t> _lookup;           /* slot of every frame of the file, -1 when it isn't cached */
+        std::size_t         _num_used;          /* slots [0, _num_used) hold a frame */
+        int32_t             _head;              /* most recently used slot */
+        int32_t             _tail;              /* least recently used slot, the next to be reused */
+        std::size_t         _bytes_per_frame;
+        int64_t             _num_frames;
+        std::size_t         _budget;
+        std::mutex          _mtx;               /* guards everything above */
+        std::atomic<uint64_t> _num_hits;
+        std::atomic<uint64_t> _num_misses;
+    };
+
+} /* End HPV namespace */
@@ -0,0 +1,392 @@
+#include <string.h>
+#include <cstddef>
+#include <algorithm>
+
+#include "HPVFrameIndex.h"
+#include "HPVChecksum.h"
+#include "HPVPlayer.h"
+#include "Log.h"
+
+namespace HPV {
+
+    HPVFrameIndex::HPVFrameIndex()
+    : _num_frames(0)
+    , _num_tiles(1)
+    , _frame_alignment(1)
+    , _max_frame_size(0)
+    , _file_size(0)
+    , _tables_start(0)
+    , _frames_start(0)
+    , _has_checksums(false)
+    , _lazy(false)
+    , _frame_table(nullptr)
+    , _tile_size_table(nullptr)
+    , _tile_crc_table(nullptr)
+    {
+        _num_checkpoints.store(0, std::memory_order_relaxed);
+    }
+
+    HPVFrameIndex::~HPVFrameIndex()
+    {
+        clear();
+    }
+
+    /*
+     *  'max_frame_size' is an upper bound on the compressed size of a frame, lazy entries above it are damaged
+     */
+    int HPVFrameIndex::load(HPVFileReader * reader, const std::string& filepath, const HPVHeader& header, uint32_t num_tiles,
+                            uint32_t frame_alignment, uint32_t max_frame_size, HPVIndexMode mode)
+    {
+        clear();
+
+        _num_frames = header.number_of_frames;
+        _num_tiles = num_tiles;
+        _frame_alignment = std::max(1u, frame_alignment);
+        _file_size = reader->getFileSize();
+        _has_checksums = (header.version >= HPV_VERSION_0_0_10);
+        _lazy = (HPVIndexMode::HPV_INDEX_LAZY == mode) || (HPVIndexMode::HPV_INDEX_AUTO == mode && _num_frames >= HPV_LAZY_INDEX_MIN_FRAMES);
+
+        // the tables follow the header: frame sizes or index entries, then the tile sizes and tile checksums
+        uint64_t num_bytes_in_frame_table = static_cast<uint64_t>(_num_frames) * (_has_checksums ? sizeof(HPVFrameIndexEntry) : sizeof(uint32_t));
+        uint64_t num_bytes_in_tile_table = (_num_tiles > 1) ? static_cast<uint64_t>(_num_frames) * _num_tiles * sizeof(uint32_t) : 0;
+
+        _tables_start = sizeof(uint32_t) * header_fields_for_version(header.version);
+        _frames_start = _tables_start + num_bytes_in_frame_table + num_bytes_in_tile_table * (_has_checksums ? 2 : 1);
+
+        if (_frames_start > _file_size)
+        {
+            HPV_ERROR("The frame index of %u frames doesn't fit in the file, corrupt file", _num_frames);
+            return HPV_RET_ERROR;
+        }
+
+        if (_lazy)
+        {
+            _max_frame_size = max_frame_size;
+            return mapTables(filepath);
+        }
+
+        return readTables(reader, header.crc_frame_sizes);
+    }
+
+    void HPVFrameIndex::clear()
+    {
+        _entries.clear();
+        _entries.shrink_to_fit();
+        _tile_sizes.clear();
+        _tile_sizes.shrink_to_fit();
+        _tile_crcs.clear();
+        _tile_crcs.shrink_to_fit();
+
+        if (_mapping)
+        {
+            _mapping->close();
+            _mapping.reset();
+        }
+
+        _frame_table = nullptr;
+        _tile_size_table = nullptr;
+        _tile_crc_table = nullptr;
+        _checkpoints.clear();
+        _num_checkpoints.store(0, std::memory_order_relaxed);
+        _num_frames = 0;
+        _max_frame_size = 0;
+        _lazy = false;
+    }
+
+    /*
+     *  Eager index: reads all tables, checks them against the header and every frame against the file
+     */
+    int HPVFrameIndex::readTables(HPVFileReader * reader, uint32_t header_crc)
+    {
+        _entries.resize(_num_frames);
+
+        uint32_t crc = 0;
+        uint64_t offset = _tables_start;
+
+        if (_has_checksums)
+        {
+            // version 10: the entries as they are in the file, their CRC32C is checked below
+            std::size_t num_bytes = _entries.size() * sizeof(HPVFrameIndexEntry);
+
+            if (!reader->read(offset, num_bytes, reinterpret_cast<char *>(_entries.data())))
+            {
+                HPV_ERROR("Failed to read the frame index");
+                return HPV_RET_ERROR;
+            }
+
+            crc = CRC32C(_entries.data(), num_bytes);
+            offset += num_bytes;
+        }
+        else
+        {
+            // older files: sizes only, protected by their sum, the frames follow each other
+            std::vector<uint32_t> sizes(_num_frames);
+
+            if (!reader->read(offset, sizes.size() * sizeof(uint32_t), reinterpret_cast<char *>(sizes.data())))
+            {
+                HPV_ERROR("Failed to read the frame sizes table");
+                return HPV_RET_ERROR;
+            }
+
+            for (uint32_t frame = 0; frame < _num_frames; ++frame)
+            {
+                crc += sizes[frame];
+            }
+
+            if (crc != header_crc)
+            {
+                HPV_ERROR("Frame sizes table CRC doesn't match, corrupt file");
+                return HPV_RET_ERROR;
+            }
+
+            uint64_t frame_offset = align_up(_frames_start, _frame_alignment);
+
+            for (uint32_t frame = 0; frame < _num_frames; ++frame)
+            {
+                _entries[frame].offset = frame_offset;
+                _entries[frame].size = sizes[frame];
+                _entries[frame].crc = 0;
+                frame_offset = align_up(frame_offset + sizes[frame], _frame_alignment);
+            }
+
+            offset += sizes.size() * sizeof(uint32_t);
+        }
+
+        if (_num_tiles > 1)
+        {
+            // every frame is the sum of its tiles
+            std::size_t num_entries = static_cast<std::size_t>(_num_frames) * _num_tiles;
+            _tile_sizes.resize(num_entries);
+
+            if (!reader->read(offset, num_entries * sizeof(uint32_t), reinterpret_cast<char *>(_tile_sizes.data())))
+            {
+                HPV_ERROR("Failed to read the tile index");
+                return HPV_RET_ERROR;
+            }
+
+            for (uint32_t frame = 0; frame < _num_frames; ++frame)
+            {
+                uint64_t frame_size = 0;
+                for (uint32_t tile = 0; tile < _num_tiles; ++tile)
+                {
+                    frame_size += _tile_sizes[static_cast<std::size_t>(frame) * _num_tiles + tile];
+                }
+
+                if (frame_size != _entries[frame].size)
+                {
+                    HPV_ERROR("Tile index doesn't match the size of frame %u, corrupt file", frame);
+                    return HPV_RET_ERROR;
+                }
+            }
+
+            offset += num_entries * sizeof(uint32_t);
+
+            // version 10: followed by the CRC32C of every tile, so visible tiles can be checked on their own
+            if (_has_checksums)
+            {
+                _tile_crcs.resize(num_entries);
+
+                if (!reader->read(offset, num_entries * sizeof(uint32_t), reinterpret_cast<char *>(_tile_crcs.data())))
+                {
+                    HPV_ERROR("Failed to read the tile checksums");
+                    return HPV_RET_ERROR;
+                }
+
+                crc = CRC32C(_tile_sizes.data(), num_entries * sizeof(uint32_t), crc);
+                crc = CRC32C(_tile_crcs.data(), num_entries * sizeof(uint32_t), crc);
+            }
+        }
+
+        if (_has_checksums && crc != header_crc)
+        {
+            HPV_ERROR("Frame index CRC doesn't match, corrupt file");
+            return HPV_RET_ERROR;
+        }
+
+        _max_frame_size = 0;
+
+        for (uint32_t frame = 0; frame < _num_frames; ++frame)
+        {
+            const HPVFrameIndexEntry& entry = _entries[frame];
+
+            if (entry.offset < _frames_start || entry.offset > _file_size || entry.size > _file_size - entry.offset
+                || (entry.offset & (_frame_alignment - 1)) != 0)
+            {
+                HPV_ERROR("Frame %u lies outside the file or isn't aligned, corrupt file", frame);
+                return HPV_RET_ERROR;
+            }
+
+            _max_frame_size = std::max(_max_frame_size, entry.size);
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    /*
+     *  Lazy index: maps the file, nothing of the tables is read yet
+     */
+    int HPVFrameIndex::mapTables(const std::string& filepath)
+    {
+        _mapping = CreateFileReader(HPVReadMode::HPV_READ_MMAP);
+
+        if (!_mapping->open(filepath))
+        {
+            HPV_ERROR("Failed to map the frame index of %s", filepath.c_str());
+            _mapping.reset();
+            return HPV_RET_ERROR;
+        }
+
+        // lookups jump around, kernel read-ahead would only read pages of the index nobody asked for
+        _mapping->adviseDirection(HPV_DIRECTION_REVERSE);
+
+        const char * tables = _mapping->acquire(_tables_start, static_cast<std::size_t>(_frames_start - _tables_start), nullptr);
+
+        if (!tables)
+        {
+            clear();
+            return HPV_RET_ERROR;
+        }
+
+        std::size_t entry_size = _has_checksums ? sizeof(HPVFrameIndexEntry) : sizeof(uint32_t);
+        std::size_t num_bytes_in_tile_table = static_cast<std::size_t>(_num_frames) * _num_tiles * sizeof(uint32_t);
+
+        _frame_table = tables;
+        _tile_size_table = (_num_tiles > 1) ? _frame_table + static_cast<std::size_t>(_num_frames) * entry_size : nullptr;
+        _tile_crc_table = (_num_tiles > 1 && _has_checksums) ? _tile_size_table + num_bytes_in_tile_table : nullptr;
+
+        if (!_has_checksums)
+        {
+            _checkpoints.assign(_num_frames / HPV_INDEX_CHECKPOINT_INTERVAL + 1, 0);
+            _checkpoints[0] = align_up(_frames_start, _frame_alignment);
+            _num_checkpoints.store(1, std::memory_order_release);
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    HPVFrameIndexEntry HPVFrameIndex::entry(int64_t frame)
+    {
+        if (!_lazy)
+        {
+            return _entries[static_cast<std::size_t>(frame)];
+        }
+
+        HPVFrameIndexEntry entry;
+
+        if (_has_checksums)
+        {
+            memcpy(&entry, _frame_table + static_cast<std::size_t>(frame) * sizeof(HPVFrameIndexEntry), sizeof(HPVFrameIndexEntry));
+        }
+        else
+        {
+            entry.offset = lazyOffset(frame);
+            entry.size = size(frame);
+            entry.crc = 0;
+        }
+
+        // checked on every lookup, the lazy index never saw the rest of the table
+        if (entry.offset < _frames_start || entry.offset > _file_size || entry.size > _file_size - entry.offset
+            || (entry.offset & (_frame_alignment - 1)) != 0 || entry.size > _max_frame_size)
+        {
+            HPV_ERROR("Index entry of frame %" PRId64 " is damaged, corrupt file", frame);
+            entry.offset = 0;
+            entry.size = 0;
+        }
+
+        return entry;
+    }
+
+    uint32_t HPVFrameIndex::size(int64_t frame)
+    {
+        if (!_lazy)
+        {
+            return _entries[static_cast<std::size_t>(frame)].size;
+        }
+
+        uint32_t size;
+
+        if (_has_checksums)
+        {
+            memcpy(&size, _frame_table + static_cast<std::size_t>(frame) * sizeof(HPVFrameIndexEntry) + offsetof(HPVFrameIndexEntry, size), sizeof(uint32_t));
+        }
+        else
+        {
+            memcpy(&size, _frame_table + static_cast<std::size_t>(frame) * sizeof(uint32_t), sizeof(uint32_t));
+        }
+
+        return size;
+    }
+
+    const uint32_t * HPVFrameIndex::tileSizes(int64_t frame)
+    {
+        if (_num_tiles <= 1)
+        {
+            return nullptr;
+        }
+
+        // the tile tables start at a multiple of 4 bytes from the page aligned mapping
+        return _lazy ? reinterpret_cast<const uint32_t *>(_tile_size_table) + frame * _num_tiles
+                     : _tile_sizes.data() + frame * _num_tiles;
+    }
+
+    const uint32_t * HPVFrameIndex::tileCRCs(int64_t frame)
+    {
+        if (_num_tiles <= 1 || !_has_checksums)
+        {
+            return nullptr;
+        }
+
+        return _lazy ? reinterpret_cast<const uint32_t *>(_tile_crc_table) + frame * _num_tiles
+                     : _tile_crcs.data() + frame * _num_tiles;
+    }
+
+    /*
+     *  Files before version 10: the offset of the nearest checkpoint plus the sizes of the frames after it,
+     *  at most HPV_INDEX_CHECKPOINT_INTERVAL - 1 of them
+     */
+    uint64_t HPVFrameIndex::lazyOffset(int64_t frame)
+    {
+        uint32_t checkpoint = static_cast<uint32_t>(frame / HPV_INDEX_CHECKPOINT_INTERVAL);
+
+        if (checkpoint >= _num_checkpoints.load(std::memory_order_acquire))
+        {
+            buildCheckpoints(checkpoint);
+        }
+
+        uint64_t offset = _checkpoints[checkpoint];
+
+        for (int64_t prev = static_cast<int64_t>(checkpoint) * HPV_INDEX_CHECKPOINT_INTERVAL; prev < frame; ++prev)
+        {
+            offset = align_up(offset + size(prev), _frame_alignment);
+        }
+
+        return offset;
+    }
+
+    /*
+     *  Fills in the checkpoints up to and including 'checkpoint'. Lookups below the published count read
+     *  checkpoints without taking the lock, those are never written again.
+     */
+    void HPVFrameIndex::buildCheckpoints(uint32_t checkpoint)
+    {
+        std::lock_guard<std::mutex> lock(_checkpoint_mtx);
+
+        uint32_t num_checkpoints = _num_checkpoints.load(std::memory_order_relaxed);
+
+        while (num_checkpoints <= checkpoint)
+        {
+            uint64_t offset = _checkpoints[num_checkpoints - 1];
+            int64_t first = static_cast<int64_t>(num_checkpoints - 1) * HPV_INDEX_CHECKPOINT_INTERVAL;
+
+            for (int64_t frame = first; frame < first + HPV_INDEX_CHECKPOINT_INTERVAL; ++frame)
+            {
+                offset = align_up(offset + size(frame), _frame_alignment);
+            }
+
+            _checkpoints[num_checkpoints++] = offset;
+        }
+
+        _num_checkpoints.store(num_checkpoints, std::memory_order_release);
+    }
+
+} /* End HPV namespace */
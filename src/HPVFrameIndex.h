@@ -0,0 +1,101 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+#include "HPVHeader.h"
+#include "HPVFileReader.h"
+
+#define HPV_LAZY_INDEX_MIN_FRAMES       (1 << 16)   /* HPV_INDEX_AUTO: files from this length on (18 minutes at 60 fps) get a lazy index */
+#define HPV_INDEX_CHECKPOINT_INTERVAL   1024        /* lazy index of files before version 10: frames between two offset checkpoints */
+
+namespace HPV {
+
+    /*
+     * HPVIndexMode selects when a player reads the frame index of a file
+     */
+    enum class HPVIndexMode : std::uint8_t
+    {
+        HPV_INDEX_AUTO = 0,         /* eager for short files, lazy for files of HPV_LAZY_INDEX_MIN_FRAMES frames and more */
+        HPV_INDEX_EAGER,            /* the whole index is read and checked by open() */
+        HPV_INDEX_LAZY,             /* the index is memory-mapped, an entry is only read (and checked) when its frame is */
+        HPV_NUM_INDEX_MODES = 3
+    };
+
+    /*
+     *  HPVFrameIndex: offset, size and checksum of every frame of an HPV file, and the size and checksum of every
+     *  tile of tiled files.
+     *
+     *  The eager index reads all tables when the file is opened and checks them as a whole, which takes time
+     *  linear in the length of the file. The lazy index only maps the file: version 10 files store the offset of
+     *  every frame, older files store sizes only and get their offsets from prefix sums kept for every
+     *  HPV_INDEX_CHECKPOINT_INTERVAL frames (4 KiB of sizes). Checkpoints are filled in up to the furthest frame
+     *  asked for, so opening and showing the first frame touch a constant number of pages; the first jump to
+     *  the end of an old file sums its sizes once. A lazy index can't check the whole table, a damaged entry
+     *  shows up as a frame that can't be read.
+     *
+     *  All lookups can be made from any thread.
+     */
+    class HPVFrameIndex
+    {
+    public:
+        HPVFrameIndex();
+        ~HPVFrameIndex();
+
+        int                 load(HPVFileReader * reader, const std::string& filepath, const HPVHeader& header, uint32_t num_tiles,
+                                 uint32_t frame_alignment, uint32_t max_frame_size, HPVIndexMode mode);
+        void                clear();
+
+        HPVFrameIndexEntry  entry(int64_t frame);           /* size 0: the entry is damaged */
+        uint32_t            size(int64_t frame);
+        const uint32_t *    tileSizes(int64_t frame);
+        const uint32_t *    tileCRCs(int64_t frame);        /* nullptr before version 10 */
+
+        bool                hasChecksums() { return _has_checksums; }
+        bool                isLazy() { return _lazy; }
+        uint32_t            getMaxFrameSize() { return _max_frame_size; }   /* lazy: the bound given to load() */
+
+    private:
+        int                 readTables(HPVFileReader * reader, uint32_t header_crc);
+        int                 mapTables(const std::string& filepath);
+        uint64_t            lazyOffset(int64_t frame);
+        void                buildCheckpoints(uint32_t checkpoint);
+
+        uint32_t            _num_frames;
+        uint32_t            _num_tiles;
+        uint32_t            _frame_alignment;
+        uint32_t            _max_frame_size;
+        uint64_t            _file_size;
+        uint64_t            _tables_start;
+        uint64_t            _frames_start;          /* first byte after the tables */
+        bool                _has_checksums;
+        bool                _lazy;
+
+        // eager index
+        std::vector<HPVFrameIndexEntry> _entries;
+        std::vector<uint32_t> _tile_sizes;
+        std::vector<uint32_t> _tile_crcs;
+
+        // lazy index: the tables inside a mapping of the file
+        std::unique_ptr<HPVFileReader> _mapping;
+        const char *        _frame_table;
+        const char *        _tile_size_table;
+        const char *        _tile_crc_table;
+        std::vector<uint64_t> _checkpoints;         /* offset of frame i * HPV_INDEX_CHECKPOINT_INTERVAL */
+        std::atomic<uint32_t> _num_checkpoints;     /* filled in so far */
+        std::mutex          _checkpoint_mtx;
+    };
+
+} /* End HPV namespace */
@@ -0,0 +1,109 @@
+#include <cmath>
+
+#include "HPVFrameScheduler.h"
+
+namespace HPV {
+
+    HPVFrameScheduler::HPVFrameScheduler()
+    : _anchor_time(0)
+    , _anchor_tick(0.0)
+    , _time_per_frame(1.0)
+    , _presented_tick(-1)
+    , _presented_slot(-1)
+    , _num_late(0)
+    , _num_dropped(0)
+    , _num_repeated(0)
+    {
+    }
+
+    void HPVFrameScheduler::start(uint64_t now, double time_per_frame)
+    {
+        _anchor_time = now;
+        _anchor_tick = 0.0;
+        _time_per_frame = (time_per_frame > 0.0) ? time_per_frame : 1.0;
+        _presented_tick = -1;
+        _presented_slot = -1;
+    }
+
+    /*
+     *  Continues from where playback is at 'now' with the new duration: a frame that was half over stays half over
+     */
+    void HPVFrameScheduler::setTimePerFrame(uint64_t now, double time_per_frame)
+    {
+        double elapsed = (now >= _anchor_time) ? static_cast<double>(now - _anchor_time) : -static_cast<double>(_anchor_time - now);
+
+        _anchor_tick += elapsed / _time_per_frame;
+        _anchor_time = now;
+        _time_per_frame = (time_per_frame > 0.0) ? time_per_frame : 1.0;
+    }
+
+    int64_t HPVFrameScheduler::getDueTick(uint64_t now) const
+    {
+        if (now < _anchor_time)
+        {
+            return static_cast<int64_t>(std::floor(_anchor_tick - (_anchor_time - now) / _time_per_frame));
+        }
+
+        return static_cast<int64_t>(std::floor(_anchor_tick + (now - _anchor_time) / _time_per_frame));
+    }
+
+    /*
+     *  Rounded up to the next ns, so getDueTick() of the result is always 'tick'
+     */
+    uint64_t HPVFrameScheduler::getTickTime(int64_t tick) const
+    {
+        double offset = std::ceil((static_cast<double>(tick) - _anchor_tick) * _time_per_frame);
+
+        if (offset < 0.0)
+        {
+            uint64_t before = static_cast<uint64_t>(-offset);
+            return (before < _anchor_time) ? _anchor_time - before : 0;
+        }
+
+        return _anchor_time + static_cast<uint64_t>(offset);
+    }
+
+    uint64_t HPVFrameScheduler::present(int64_t tick, uint64_t now)
+    {
+        int64_t slot = getDueTick(now);
+
+        if (slot < tick)
+        {
+            slot = tick;
+        }
+
+        if (_presented_tick >= 0 && tick > _presented_tick + 1)
+        {
+            _num_dropped.fetch_add(tick - _presented_tick - 1, std::memory_order_relaxed);
+        }
+
+        // its slot was over before it got on screen
+        if (slot > tick)
+        {
+            _num_late.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (_presented_slot >= 0 && slot > _presented_slot + 1)
+        {
+            _num_repeated.fetch_add(slot - _presented_slot - 1, std::memory_order_relaxed);
+        }
+
+        _presented_tick = tick;
+        _presented_slot = slot;
+
+        return getTickTime(tick + 1);
+    }
+
+    void HPVFrameScheduler::drop(uint64_t num_frames)
+    {
+        _num_dropped.fetch_add(num_frames, std::memory_order_relaxed);
+    }
+
+    void HPVFrameScheduler::resetCounters()
+    {
+        _num_late.store(0, std::memory_order_relaxed);
+        _num_dropped.store(0, std::memory_order_relaxed);
+        _num_repeated.store(0, std::memory_order_relaxed);
+    }
+
+} /* End HPV namespace */
@@ -0,0 +1,58 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+namespace HPV {
+
+    /*
+     *  HPVFrameScheduler: when the frames of free-running playback are due. Tick n (the n-th frame since start())
+     *  is due at a time computed from the start time and the frame duration, never by adding up durations, so
+     *  rounding and slow steps don't make playback drift. A new duration takes over from the current position,
+     *  the part of the frame that has already run stays, so a speed change doesn't make the playhead jump.
+     *
+     *  present() keeps count of frames that were shown after their slot had already ended (late), that were
+     *  never shown (dropped) and of slots in which no new frame came in (repeated: the previous one stayed on).
+     *
+     *  All times are passed in, so the scheduler can be driven by a fake clock. Only the thread that steps the
+     *  player uses it, the counters can be read from any thread.
+     */
+    class HPVFrameScheduler
+    {
+    public:
+        HPVFrameScheduler();
+
+        void                start(uint64_t now, double time_per_frame);   /* tick 0 is due at 'now' */
+        void                setTimePerFrame(uint64_t now, double time_per_frame);
+        int64_t             getDueTick(uint64_t now) const;                 /* newest tick that is due, -1 before tick 0 */
+        uint64_t            getTickTime(int64_t tick) const;
+        int64_t             getPresentedTick() const { return _presented_tick; }
+
+        uint64_t            present(int64_t tick, uint64_t now);            /* returns when the next tick is due */
+        void                drop(uint64_t num_frames);
+
+        uint64_t            getNumLateFrames() { return _num_late.load(std::memory_order_relaxed); }
+        uint64_t            getNumDroppedFrames() { return _num_dropped.load(std::memory_order_relaxed); }
+        uint64_t            getNumRepeatedFrames() { return _num_repeated.load(std::memory_order_relaxed); }
+        void                resetCounters();
+
+    private:
+        uint64_t            _anchor_time;
+        double              _anchor_tick;           /* position at _anchor_time, in frames */
+        double              _time_per_frame;        /* ns */
+        int64_t             _presented_tick;
+        int64_t             _presented_slot;        /* tick that was due when _presented_tick was shown */
+        std::atomic<uint64_t> _num_late;
+        std::atomic<uint64_t> _num_dropped;
+        std::atomic<uint64_t> _num_repeated;
+    };
+
+} /* End HPV namespace */
@@ -21,9 +21,16 @@
 #define HPV_VERSION_0_0_4 4     /* Added some reserved field for later use */
 #define HPV_VERSION_0_0_5 5     /* Added DXT5_SCALED_CoCgY for better quality */
 #define HPV_VERSION_0_0_6 6     /* Added LZ4 compression/decompression stage */
+#define HPV_VERSION_0_0_7 7     /* Frames start at offsets aligned to frame_alignment (was reserved_1), for unbuffered reads */
+#define HPV_VERSION_0_0_8 8     /* Frames can be split in num_slices (was reserved_2) independently compressed slices of DXT block rows */
+#define HPV_VERSION_0_0_9 9     /* Frames can be split in a grid of tile_columns x tile_rows independently compressed tiles, with a tile index */
+#define HPV_VERSION_0_0_10 10   /* Frame index with 64-bit offsets and a CRC32C of every frame (and tile), crc_frame_sizes is the CRC32C of the index */
 
 #define HPV_MAX_SIDE_SIZE 8192
 #define HPV_LZ4_COMPRESSION_LEVEL 9
+#define HPV_DIRECT_IO_ALIGNMENT 4096
+#define HPV_MAX_SLICES 64
+#define HPV_MAX_TILES 64        /* a set of tiles fits in a uint64_t, bit (row * tile_columns + column) */
 
 // easy for if-statements
 #define HPV_RET_ERROR 0
@@ -64,13 +71,78 @@ namespace HPV
         HPVCompressionType compression_type;      /* The used compression type */
         
         /* VERSION 4 - 6 */
-        uint32_t crc_frame_sizes;       /* CRC for the frame size table */
-        uint32_t reserved_1;
-        uint32_t reserved_2;
+        uint32_t crc_frame_sizes;       /* sum of the frame size table, from version 10 on the CRC32C of the frame and tile index */
+        
+        /* VERSION 7 */
+        uint32_t frame_alignment;       /* 0 or 1: frames are packed, otherwise every frame starts at a multiple of this (power of 2) */
+        
+        /* VERSION 8 */
+        uint32_t num_slices;            /* 0 or 1: a frame is one LZ4 stream, otherwise the frame layout below */
+        
+        /* VERSION 9 */
+        uint32_t tile_columns;          /* 0 or 1 (and tile_rows 0 or 1): not tiled, otherwise the tiled layout below */
+        uint32_t tile_rows;
     };
+    
+    // Layout of a sliced frame (version 8, num_slices > 1):
+    //
+    //   uint32_t slice_sizes[num_slices]   compressed size of every slice
+    //   slice 0 | slice 1 | ...            the LZ4 streams, back to back
+    //
+    // The DXT block rows of the frame are divided evenly over the slices: slice i starts at
+    // block row i * block_rows / num_slices, so num_slices may not exceed the number of block rows.
+    inline uint32_t slice_first_block_row(uint32_t slice, uint32_t block_rows, uint32_t num_slices)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(slice) * block_rows) / num_slices);
+    }
+
+    // Layout of a tiled file (version 9, tile_columns * tile_rows > 1, num_slices 0 or 1):
+    //
+    //   header | uint32_t frame_sizes[number_of_frames]
+    //          | uint32_t tile_sizes[number_of_frames][tile_columns * tile_rows]   the tile index
+    //          | frame 0 | frame 1 | ...
+    //
+    // A frame is its tiles back to back in row-major order, every tile an LZ4 stream of its own; the frame
+    // size is the sum of its tile sizes. The DXT blocks are divided over the tile columns and rows in the same
+    // way as block rows over slices. A decompressed tile holds its block rows top to bottom, each block row
+    // only the blocks of the tile's columns.
+    inline uint32_t tile_first_block(uint32_t tile, uint32_t blocks, uint32_t num_tiles)
+    {
+        return slice_first_block_row(tile, blocks, num_tiles);
+    }
 
+    // Layout of a version 10 file:
+    //
+    //   header | HPVFrameIndexEntry frame_index[number_of_frames]
+    //          | tiled: uint32_t tile_sizes[number_of_frames][num_tiles], uint32_t tile_crcs[number_of_frames][num_tiles]
+    //          | frame 0 | frame 1 | ...
+    //
+    // The frames themselves are laid out as in older versions. Their offsets are stored instead of derived from
+    // the sizes, frames may be anywhere after the index. crc_frame_sizes in the header is the CRC32C of the frame
+    // index followed by the tile tables, the crc of an entry is the CRC32C of the frame as stored in the file.
+    struct HPVFrameIndexEntry
+    {
+        uint64_t offset;                /* from the start of the file */
+        uint32_t size;                  /* compressed size */
+        uint32_t crc;                   /* CRC32C of the compressed frame */
+    };
+    
+    static_assert(sizeof(HPVFrameIndexEntry) == 16, "HPVFrameIndexEntry is stored as is");
+    
     // amount of defined header fields
-    static const int amount_header_fields = 10;
+    static const int amount_header_fields = 10;         /* versions 0 - 8 */
+    static const int amount_header_fields_v9 = 12;      /* version 9 added the tile grid, version 10 has the same fields */
+    
+    inline int header_fields_for_version(uint32_t version)
+    {
+        return (version >= HPV_VERSION_0_0_9) ? amount_header_fields_v9 : amount_header_fields;
+    }
+    
+    // round up to the next multiple of a power of 2 alignment
+    inline uint64_t align_up(uint64_t value, uint64_t alignment)
+    {
+        return (alignment > 1) ? ((value + alignment - 1) & ~(alignment - 1)) : value;
+    }
     
     // swap big <-> little endian
     inline void swap_endian(uint32_t &val)
@@ -0,0 +1,163 @@
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#include "HPVHistogram.h"
+
+namespace HPV {
+
+    /* Index of the highest set bit, 'bits' must not be 0 */
+    static inline uint32_t HighestBit(uint64_t bits)
+    {
+#if defined(_MSC_VER)
+        unsigned long idx;
+        _BitScanReverse64(&idx, bits);
+        return static_cast<uint32_t>(idx);
+#else
+        return static_cast<uint32_t>(63 - __builtin_clzll(bits));
+#endif
+    }
+
+    HPVHistogramSnapshot::HPVHistogramSnapshot()
+    : counts(HPV_HISTOGRAM_NUM_BUCKETS, 0)
+    , count(0)
+    , sum(0)
+    , max(0)
+    {
+    }
+
+    void HPVHistogramSnapshot::add(const HPVHistogramSnapshot& other)
+    {
+        for (std::size_t idx = 0; idx < counts.size(); ++idx)
+        {
+            counts[idx] += other.counts[idx];
+        }
+
+        count += other.count;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    uint64_t HPVHistogramSnapshot::percentile(double percent) const
+    {
+        if (0 == count)
+        {
+            return 0;
+        }
+
+        // the rank of the sample we want, 1-based, at least the first one
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(percent / 100.0 * count + 0.5));
+        uint64_t seen = 0;
+
+        for (uint32_t idx = 0; idx < counts.size(); ++idx)
+        {
+            seen += counts[idx];
+
+            if (seen >= rank)
+            {
+                return std::min(HPVHistogram::bucketUpperBound(idx), max);
+            }
+        }
+
+        return max;
+    }
+
+    double HPVHistogramSnapshot::mean() const
+    {
+        return count ? static_cast<double>(sum) / count : 0.0;
+    }
+
+    HPVHistogram::HPVHistogram()
+    {
+        reset();
+    }
+
+    /*
+     *  Values below 2^(SUB + 1) are their own bucket. Above that, a value with its highest bit at 'msb' is
+     *  shifted right by msb - SUB, which leaves SUB + 1 bits: the top one set, the others pick the bucket.
+     */
+    uint32_t HPVHistogram::bucketIndex(uint64_t value)
+    {
+        value = std::min<uint64_t>(value, (uint64_t(1) << HPV_HISTOGRAM_MAX_BITS) - 1);
+
+        uint32_t msb = HighestBit(value | 1);
+        uint32_t shift = (msb > HPV_HISTOGRAM_SUB_BUCKET_BITS) ? msb - HPV_HISTOGRAM_SUB_BUCKET_BITS : 0;
+
+        return (shift << HPV_HISTOGRAM_SUB_BUCKET_BITS) + static_cast<uint32_t>(value >> shift);
+    }
+
+    uint64_t HPVHistogram::bucketUpperBound(uint32_t index)
+    {
+        uint32_t shift = (index < (2u << HPV_HISTOGRAM_SUB_BUCKET_BITS)) ? 0 : (index >> HPV_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+        uint64_t sub_bucket = index - (shift << HPV_HISTOGRAM_SUB_BUCKET_BITS);
+
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+    void HPVHistogram::record(uint64_t value)
+    {
+        _counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t max = _max.load(std::memory_order_relaxed);
+        while (value > max && !_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+    }
+
+    void HPVHistogram::reset()
+    {
+        for (std::atomic<uint64_t>& count : _counts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+
+        _sum.store(0, std::memory_order_relaxed);
+        _max.store(0, std::memory_order_relaxed);
+    }
+
+    HPVHistogramSnapshot HPVHistogram::snapshot() const
+    {
+        HPVHistogramSnapshot snap;
+
+        for (uint32_t idx = 0; idx < HPV_HISTOGRAM_NUM_BUCKETS; ++idx)
+        {
+            snap.counts[idx] = _counts[idx].load(std::memory_order_relaxed);
+            snap.count += snap.counts[idx];
+        }
+
+        snap.sum = _sum.load(std::memory_order_relaxed);
+        snap.max = _max.load(std::memory_order_relaxed);
+
+        return snap;
+    }
+
+    void HPVLatencySnapshot::add(const HPVLatencySnapshot& other)
+    {
+        read.add(other.read);
+        decode.add(other.decode);
+        upload.add(other.upload);
+        lateness.add(other.lateness);
+    }
+
+    void HPVLatencyStats::reset()
+    {
+        read.reset();
+        decode.reset();
+        upload.reset();
+        lateness.reset();
+    }
+
+    HPVLatencySnapshot HPVLatencyStats::snapshot() const
+    {
+        HPVLatencySnapshot snap;
+
+        snap.read = read.snapshot();
+        snap.decode = decode.snapshot();
+        snap.upload = upload.snapshot();
+        snap.lateness = lateness.snapshot();
+
+        return snap;
+    }
+
+} /* End HPV namespace */
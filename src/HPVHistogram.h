@@ -0,0 +1,91 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+#define HPV_HISTOGRAM_SUB_BUCKET_BITS   5       /* every power of two is split in 32 buckets: at most ~3% wide */
+#define HPV_HISTOGRAM_MAX_BITS          42      /* larger values are counted as 2^42 - 1 ns, about 73 minutes */
+#define HPV_HISTOGRAM_NUM_BUCKETS       ((HPV_HISTOGRAM_MAX_BITS - HPV_HISTOGRAM_SUB_BUCKET_BITS + 1) << HPV_HISTOGRAM_SUB_BUCKET_BITS)
+
+namespace HPV {
+
+    /*
+     *  A copy of the counts of an HPVHistogram, to compute percentiles from or to add up histograms
+     */
+    struct HPVHistogramSnapshot
+    {
+        HPVHistogramSnapshot();
+        
+        void                    add(const HPVHistogramSnapshot& other);
+        uint64_t                percentile(double percent) const;   /* upper end of the bucket, 0 when empty */
+        double                  mean() const;
+        
+        std::vector<uint64_t>   counts;
+        uint64_t                count;
+        uint64_t                sum;
+        uint64_t                max;
+    };
+    
+    /*
+     *  HPVHistogram: log-linear latency histogram in the style of HdrHistogram. Values below 64 ns have a bucket
+     *  each, above that every power of two gets 32 buckets. record() is wait-free and can be called from any
+     *  thread; snapshot() can be taken from any other thread at any time. Buckets are read one by one, so a
+     *  snapshot taken during recording may miss the newest samples, but it never holds a torn count.
+     */
+    class HPVHistogram
+    {
+    public:
+        HPVHistogram();
+        
+        void                    record(uint64_t value);
+        void                    reset();
+        HPVHistogramSnapshot    snapshot() const;
+        
+        static uint32_t         bucketIndex(uint64_t value);
+        static uint64_t         bucketUpperBound(uint32_t index);
+        
+    private:
+        HPVHistogram(const HPVHistogram&);
+        HPVHistogram& operator=(const HPVHistogram&);
+        
+        std::atomic<uint64_t>   _counts[HPV_HISTOGRAM_NUM_BUCKETS];
+        std::atomic<uint64_t>   _sum;
+        std::atomic<uint64_t>   _max;
+    };
+    
+    /* Snapshots of the histograms of HPVLatencyStats, or their sum over players */
+    struct HPVLatencySnapshot
+    {
+        void                    add(const HPVLatencySnapshot& other);
+        
+        HPVHistogramSnapshot    read;
+        HPVHistogramSnapshot    decode;
+        HPVHistogramSnapshot    upload;
+        HPVHistogramSnapshot    lateness;
+    };
+    
+    /*
+     *  Latencies of a player, in ns: reading a frame, decompressing it, uploading it to the GPU, and how late
+     *  a frame was presented after the time it was due
+     */
+    struct HPVLatencyStats
+    {
+        void                    reset();
+        HPVLatencySnapshot      snapshot() const;
+        
+        HPVHistogram            read;
+        HPVHistogram            decode;
+        HPVHistogram            upload;
+        HPVHistogram            lateness;
+    };
+    
+} /* End HPV namespace */
@@ -0,0 +1,442 @@
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+
+#include "HPVIOEngine.h"
+#include "HPVHeader.h"
+#include "Log.h"
+
+#if !defined(_WIN32)
+#  include <unistd.h>
+#endif
+
+#if defined(HPV_HAVE_IO_URING)
+#  include <linux/io_uring.h>
+#  include <sys/syscall.h>
+#  include <sys/mman.h>
+#  if !defined(__NR_io_uring_setup) || !defined(__NR_io_uring_enter)
+#    undef HPV_HAVE_IO_URING
+#  endif
+#endif
+
+namespace HPV {
+
+#if defined(HPV_HAVE_IO_URING)
+    // liburing is not a dependency, talk to the kernel directly
+    static int sys_io_uring_setup(unsigned entries, struct io_uring_params * params)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    static int sys_io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0));
+    }
+#endif
+
+    HPVIOEngine::HPVIOEngine()
+    : _is_init(false)
+    , _uses_io_uring(false)
+    , _inflight(0)
+    {
+        _should_reap.store(false, std::memory_order_relaxed);
+        _num_submit_calls.store(0, std::memory_order_relaxed);
+        _num_submitted_reads.store(0, std::memory_order_relaxed);
+#if defined(HPV_HAVE_IO_URING)
+        _ring_fd = -1;
+        _sq_ring = _cq_ring = _sqes = _cqes = nullptr;
+        _sq_ring_size = _cq_ring_size = 0;
+#endif
+    }
+
+    HPVIOEngine::~HPVIOEngine()
+    {
+        shutdown();
+    }
+
+    int HPVIOEngine::init(unsigned queue_depth)
+    {
+        std::lock_guard<std::mutex> lock(_sq_mtx);
+
+        if (_is_init)
+        {
+            return HPV_RET_ERROR_NONE;
+        }
+
+        _uses_io_uring = false;
+        _inflight = 0;
+
+#if defined(HPV_HAVE_IO_URING)
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+
+        _ring_fd = sys_io_uring_setup(queue_depth, &params);
+
+        if (_ring_fd >= 0)
+        {
+            _sq_entries = params.sq_entries;
+            _cq_entries = params.cq_entries;
+            _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+            // newer kernels map both rings in one go
+            bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single_mmap)
+            {
+                _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+            }
+
+            _sq_ring = mmap(NULL, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQ_RING);
+            _cq_ring = single_mmap ? _sq_ring : mmap(NULL, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_CQ_RING);
+            _sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring_fd, IORING_OFF_SQES);
+
+            if (_sq_ring == MAP_FAILED || _cq_ring == MAP_FAILED || _sqes == MAP_FAILED)
+            {
+                HPV_WARNING("Failed to map the io_uring queues (%s), falling back to pread", strerror(errno));
+
+                if (_sqes != MAP_FAILED) munmap(_sqes, params.sq_entries * sizeof(struct io_uring_sqe));
+                if (_cq_ring != MAP_FAILED && _cq_ring != _sq_ring) munmap(_cq_ring, _cq_ring_size);
+                if (_sq_ring != MAP_FAILED) munmap(_sq_ring, _sq_ring_size);
+                _sq_ring = _cq_ring = _sqes = nullptr;
+
+                ::close(_ring_fd);
+                _ring_fd = -1;
+            }
+            else
+            {
+                char * sq = static_cast<char *>(_sq_ring);
+                char * cq = static_cast<char *>(_cq_ring);
+
+                _sq_head  = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+                _sq_tail  = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+                _sq_mask  = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+                _sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+                _cq_head  = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+                _cq_tail  = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+                _cq_mask  = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+                _cqes     = cq + params.cq_off.cqes;
+
+                _uses_io_uring = true;
+                _should_reap.store(true, std::memory_order_release);
+                _reaper_thread = std::thread(&HPVIOEngine::reap, this);
+
+                HPV_VERBOSE("Started io_uring I/O engine (queue depth %u)", _sq_entries);
+            }
+        }
+        else
+        {
+            HPV_WARNING("io_uring is not available (%s), falling back to pread", strerror(errno));
+        }
+#endif
+
+        _is_init = true;
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    void HPVIOEngine::shutdown()
+    {
+        if (!_is_init)
+        {
+            return;
+        }
+
+#if defined(HPV_HAVE_IO_URING)
+        if (_uses_io_uring)
+        {
+            // wake up the reaper with a no-op, it leaves once everything in flight has completed
+            {
+                std::lock_guard<std::mutex> lock(_sq_mtx);
+
+                _should_reap.store(false, std::memory_order_release);
+
+                unsigned tail = *_sq_tail;
+                unsigned idx = tail & *_sq_mask;
+                struct io_uring_sqe * sqe = static_cast<struct io_uring_sqe *>(_sqes) + idx;
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_NOP;
+                sqe->user_data = 0;
+                _sq_array[idx] = idx;
+                __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+                sys_io_uring_enter(_ring_fd, 1, 0, 0);
+            }
+
+            if (_reaper_thread.joinable())
+            {
+                _reaper_thread.join();
+            }
+
+            munmap(_sqes, _sq_entries * sizeof(struct io_uring_sqe));
+            if (_cq_ring != _sq_ring) munmap(_cq_ring, _cq_ring_size);
+            munmap(_sq_ring, _sq_ring_size);
+            _sq_ring = _cq_ring = _sqes = _cqes = nullptr;
+
+            ::close(_ring_fd);
+            _ring_fd = -1;
+
+            HPV_VERBOSE("Stopped io_uring I/O engine");
+        }
+#endif
+
+        _uses_io_uring = false;
+        _is_init = false;
+    }
+
+    bool HPVIOEngine::isInit()
+    {
+        return _is_init;
+    }
+
+    bool HPVIOEngine::usesIOUring()
+    {
+        return _uses_io_uring;
+    }
+
+    /*
+     *  Queues all requests in one go. With io_uring this is a single io_uring_enter() for the whole
+     *  batch (split only when the completion queue would overflow), otherwise every request is read right away.
+     */
+    int HPVIOEngine::submit(HPVReadRequest * requests, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            requests[i].done = false;
+            requests[i].result = HPV_RET_ERROR;
+            requests[i].num_read = 0;
+        }
+
+        _num_submit_calls.fetch_add(1, std::memory_order_relaxed);
+        _num_submitted_reads.fetch_add(count, std::memory_order_relaxed);
+
+        if (!_uses_io_uring)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                requests[i].result = readSync(&requests[i]);
+                requests[i].num_read = requests[i].size;
+                requests[i].done = true;
+            }
+
+            return HPV_RET_ERROR_NONE;
+        }
+
+#if defined(HPV_HAVE_IO_URING)
+        std::lock_guard<std::mutex> sq_lock(_sq_mtx);
+
+        std::size_t queued = 0;
+
+        while (queued < count)
+        {
+            unsigned batch = 0;
+
+            // never have more reads in flight than the completion queue can hold
+            {
+                std::unique_lock<std::mutex> cq_lock(_cq_mtx);
+                _space_available.wait(cq_lock, [this]{ return _inflight < _cq_entries; });
+
+                batch = static_cast<unsigned>(std::min<std::size_t>(count - queued, std::min(_cq_entries - _inflight, _sq_entries)));
+                _inflight += batch;
+            }
+
+            unsigned tail = *_sq_tail;
+
+            for (unsigned i = 0; i < batch; ++i)
+            {
+                HPVReadRequest * request = &requests[queued + i];
+                unsigned idx = (tail + i) & *_sq_mask;
+                struct io_uring_sqe * sqe = static_cast<struct io_uring_sqe *>(_sqes) + idx;
+
+                request->iov.iov_base = request->dst;
+                request->iov.iov_len = request->size;
+
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_READV;
+                sqe->fd = request->fd;
+                sqe->off = request->offset;
+                sqe->addr = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(&request->iov));
+                sqe->len = 1;
+                sqe->user_data = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(request));
+
+                _sq_array[idx] = idx;
+            }
+
+            __atomic_store_n(_sq_tail, tail + batch, __ATOMIC_RELEASE);
+
+            unsigned submitted = 0;
+
+            while (submitted < batch)
+            {
+                int ret = sys_io_uring_enter(_ring_fd, batch - submitted, 0, 0);
+
+                if (ret < 0)
+                {
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+
+                    HPV_ERROR("io_uring_enter failed: %s", strerror(errno));
+
+                    // take back the SQEs the kernel didn't consume, they point into 'requests'
+                    __atomic_store_n(_sq_tail, tail + submitted, __ATOMIC_RELEASE);
+
+                    {
+                        std::lock_guard<std::mutex> cq_lock(_cq_mtx);
+                        _inflight -= batch - submitted;
+
+                        // the reads that were submitted still complete through reap()
+                        for (std::size_t i = queued + submitted; i < count; ++i)
+                        {
+                            requests[i].result = HPV_RET_ERROR;
+                            requests[i].done = true;
+                        }
+                    }
+
+                    _space_available.notify_all();
+                    _completed.notify_all();
+
+                    return HPV_RET_ERROR;
+                }
+
+                submitted += static_cast<unsigned>(ret);
+            }
+
+            queued += batch;
+        }
+#endif
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    int HPVIOEngine::wait(HPVReadRequest * request)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_cq_mtx);
+            _completed.wait(lock, [request]{ return request->done; });
+        }
+
+        // a short read is finished here, outside the lock, so the reaper and other players never wait on it
+        if (HPV_RET_ERROR_NONE == request->result && request->num_read < request->size)
+        {
+            HPVReadRequest remainder = *request;
+            remainder.offset += request->num_read;
+            remainder.dst += request->num_read;
+            remainder.size -= request->num_read;
+
+            request->result = readSync(&remainder);
+            request->num_read = request->size;
+        }
+
+        return request->result;
+    }
+
+    /*
+     *  Threaded function, only used with io_uring. Waits for completions and hands them back to the requesting players.
+     */
+    void HPVIOEngine::reap()
+    {
+#if defined(HPV_HAVE_IO_URING)
+        while (true)
+        {
+            int ret = sys_io_uring_enter(_ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+
+            if (ret < 0 && errno != EINTR)
+            {
+                HPV_ERROR("io_uring_enter failed while waiting for completions: %s", strerror(errno));
+            }
+
+            std::lock_guard<std::mutex> lock(_cq_mtx);
+
+            unsigned head = *_cq_head;
+            unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+            bool reaped = (head != tail);
+
+            while (head != tail)
+            {
+                struct io_uring_cqe * cqe = static_cast<struct io_uring_cqe *>(_cqes) + (head & *_cq_mask);
+                HPVReadRequest * request = reinterpret_cast<HPVReadRequest *>(static_cast<uintptr_t>(cqe->user_data));
+
+                if (request)
+                {
+                    complete(request, cqe->res);
+                    --_inflight;
+                }
+
+                ++head;
+            }
+
+            __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+
+            if (reaped)
+            {
+                _completed.notify_all();
+                _space_available.notify_all();
+            }
+
+            if (!_should_reap.load(std::memory_order_acquire) && _inflight == 0)
+            {
+                break;
+            }
+        }
+#endif
+    }
+
+    void HPVIOEngine::complete(HPVReadRequest * request, int64_t result)
+    {
+        if (result < 0)
+        {
+            HPV_ERROR("Async read of %zu bytes at %" PRIu64 " failed: %s", request->size, request->offset, strerror(static_cast<int>(-result)));
+            request->result = HPV_RET_ERROR;
+        }
+        else
+        {
+            // after a short read, wait() fetches the rest on the requesting thread
+            request->num_read = std::min(static_cast<std::size_t>(result), request->size);
+            request->result = HPV_RET_ERROR_NONE;
+        }
+
+        request->done = true;
+    }
+
+    int HPVIOEngine::readSync(HPVReadRequest * request)
+    {
+#if !defined(_WIN32)
+        std::size_t total = 0;
+
+        while (total < request->size)
+        {
+            ssize_t ret = pread(request->fd, request->dst + total, request->size - total, static_cast<off_t>(request->offset + total));
+
+            if (ret < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (ret <= 0)
+            {
+                HPV_ERROR("pread of %zu bytes at %" PRIu64 " failed", request->size, request->offset);
+                return HPV_RET_ERROR;
+            }
+
+            total += static_cast<std::size_t>(ret);
+        }
+
+        return HPV_RET_ERROR_NONE;
+#else
+        return HPV_RET_ERROR;
+#endif
+    }
+
+    uint64_t HPVIOEngine::getNumSubmitCalls()
+    {
+        return _num_submit_calls.load(std::memory_order_relaxed);
+    }
+
+    uint64_t HPVIOEngine::getNumSubmittedReads()
+    {
+        return _num_submitted_reads.load(std::memory_order_relaxed);
+    }
+
+} /* End HPV namespace */
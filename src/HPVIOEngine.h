@@ -0,0 +1,88 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdint.h>
+
+#include "HPVFileReader.h"
+
+#if defined(__linux__) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#    define HPV_HAVE_IO_URING
+#  endif
+#endif
+
+#define HPV_IO_QUEUE_DEPTH          64
+
+namespace HPV {
+
+    /*
+     *  HPVIOEngine: asynchronous frame reads shared by all players. On Linux, reads of every player
+     *  are submitted into one io_uring and completed by a single reaper thread. When io_uring is not
+     *  available (older kernel, sandbox, other platforms) requests are served by pread() on submission.
+     */
+    class HPVIOEngine
+    {
+    public:
+        HPVIOEngine();
+        ~HPVIOEngine();
+
+        int                 init(unsigned queue_depth = HPV_IO_QUEUE_DEPTH);
+        void                shutdown();
+        bool                isInit();
+        bool                usesIOUring();
+
+        int                 submit(HPVReadRequest * requests, std::size_t count);
+        int                 wait(HPVReadRequest * request);
+
+        uint64_t            getNumSubmitCalls();
+        uint64_t            getNumSubmittedReads();
+
+    private:
+        void                reap();
+        void                complete(HPVReadRequest * request, int64_t result);
+        int                 readSync(HPVReadRequest * request);
+
+        std::mutex          _sq_mtx;
+        std::mutex          _cq_mtx;
+        std::condition_variable _completed;
+        std::condition_variable _space_available;
+        std::thread         _reaper_thread;
+        std::atomic<bool>   _should_reap;
+        bool                _is_init;
+        bool                _uses_io_uring;
+        unsigned            _inflight;
+        std::atomic<uint64_t> _num_submit_calls;
+        std::atomic<uint64_t> _num_submitted_reads;
+
+#if defined(HPV_HAVE_IO_URING)
+        int                 _ring_fd;
+        unsigned            _sq_entries;
+        unsigned            _cq_entries;
+        void *              _sq_ring;
+        void *              _cq_ring;
+        std::size_t         _sq_ring_size;
+        std::size_t         _cq_ring_size;
+        void *              _sqes;
+        unsigned *          _sq_head;
+        unsigned *          _sq_tail;
+        unsigned *          _sq_mask;
+        unsigned *          _sq_array;
+        unsigned *          _cq_head;
+        unsigned *          _cq_tail;
+        unsigned *          _cq_mask;
+        void *              _cqes;
+#endif
+    };
+
+} /* End HPV namespace */
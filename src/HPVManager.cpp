@@ -73,7 +73,9 @@ namespace HPV {
     HPVManager::HPVManager()
     {
         m_players.clear();
-        m_num_players = 0;
+        m_generation = 0;
+        m_threading_model = HPVThreadingModel::HPV_THREADS_POOL;
+        m_num_pool_threads = 0;
     }
     
     HPVManager::~HPVManager()
@@ -82,77 +84,156 @@ namespace HPV {
         HPV_VERBOSE("~HPVMAnager");
     }
     
-    int8_t HPVManager::addPlayer()
+    HPVHandle HPVManager::addPlayer()
     {
-        int8_t node_idx = -1;
+        if (m_players.size() >= HPV::MAX_NUMBER_OF_PLAYERS)
+        {
+            HPV_ERROR("Can't add more than %u players", HPV::MAX_NUMBER_OF_PLAYERS);
+            return HPV_INVALID_HANDLE;
+        }
         
-        if (m_players.size() <= HPV::MAX_NUMBER_OF_PLAYERS)
+        std::shared_ptr<HPVPlayer> new_player = std::make_shared<HPVPlayer>();
+        if (m_event_listeners.size())
         {
-            std::shared_ptr<HPVPlayer> new_player = std::make_shared<HPVPlayer>();
-            if (m_event_listeners.size())
-            {
-                new_player->addHPVEventSink(&m_event_queue);
-            }
-            node_idx = m_num_players;
-            m_players.insert(std::pair<uint8_t, HPVPlayerRef>(node_idx, new_player));
-            new_player->_id = node_idx;
-            m_num_players++;
+            new_player->addHPVEventSink(&m_event_queue);
         }
         
-        return node_idx;
+        uint32_t slot = static_cast<uint32_t>(m_players.size());
+        HPVHandle handle = (static_cast<uint32_t>(m_generation) << HPV_HANDLE_INDEX_BITS) | slot;
+        
+        m_players.push_back(new_player);
+        new_player->_id = handle;
+        
+        // the bitset only grows here, update() never allocates
+        m_dirty_bits.resize((m_players.size() + 63) / 64, 0);
+        
+        return handle;
     }
     
-    uint8_t HPVManager::initPlayer()
+    HPVHandle HPVManager::initPlayer()
     {
         return this->addPlayer();
     }
     
-    HPVPlayerRef HPVManager::getPlayer(uint8_t node_id)
+    bool HPVManager::isValidHandle(HPVHandle handle)
     {
-        if (isValidNodeId(node_id))
+        return HPV_INVALID_HANDLE != handle
+            && (handle >> HPV_HANDLE_INDEX_BITS) == m_generation
+            && HPVHandleIndex(handle) < m_players.size();
+    }
+    
+    HPVPlayerRef HPVManager::getPlayer(HPVHandle handle)
+    {
+        if (isValidHandle(handle))
         {
-            return m_players[node_id];
+            return m_players[HPVHandleIndex(handle)];
         }
         
         return nullptr;
     }
     
     
-    std::vector<bool> HPVManager::update()
+    HPVPlayerGroupRef HPVManager::newGroup()
     {
-        std::vector<bool> update_flags;
-
-        if (m_players.size() > 0)
+        m_groups.push_back(std::make_shared<HPVPlayerGroup>());
+        
+        return m_groups.back();
+    }
+    
+    /*
+     *  Returns the shared decode pool, started on first use with the thread count given to setThreadingModel()
+     */
+    HPVDecodePool * HPVManager::getDecodePool()
+    {
+        if (!m_decode_pool.isInit())
         {
-            update_flags.resize(m_players.size(), false);
-
-            for (uint8_t i = 0; i < m_players.size(); ++i)
+            m_decode_pool.init(m_num_pool_threads);
+        }
+        
+        return &m_decode_pool;
+    }
+    
+    /*
+     *  Selects who steps the players opened from now on. 'num_pool_threads' = 0 sizes the pool to the machine;
+     *  the size only takes effect when the pool is (re)started, i.e. before the first player or after closeAll().
+     */
+    void HPVManager::setThreadingModel(HPVThreadingModel model, unsigned num_pool_threads)
+    {
+        m_threading_model = model;
+        m_num_pool_threads = num_pool_threads;
+    }
+    
+    /*
+     *  Returns a bitset with a bit set for every player (by slot, see HPVHandleIndex()) that has a new frame.
+     *  The bitset is owned by the manager and refilled on each call.
+     */
+    const std::vector<uint64_t>& HPVManager::update()
+    {
+        std::fill(m_dirty_bits.begin(), m_dirty_bits.end(), 0);
+        
+        // groups first: the frames they present now are uploaded together below
+        for (auto& group : m_groups)
+        {
+            group->update();
+        }
+        
+        for (uint32_t slot = 0; slot < m_players.size(); ++slot)
+        {
+            HPVPlayer * player = m_players[slot].get();
+            
+            if (player->isLoaded() && player->hasNewFrame())
             {
-                if (!m_players[i]->isLoaded())
-                {
-                    update_flags[i] = false;
-                }
-                else
-                {
-                    update_flags[i] = m_players[i]->hasNewFrame();
-                }
+                m_dirty_bits[slot >> 6] |= (uint64_t(1) << (slot & 63));
             }
         }
         
-        return update_flags;
+        return m_dirty_bits;
+    }
+    
+    /*
+     *  Latency histograms of all players added up, as a manager-wide view. Like update(), call it from the
+     *  thread that opens and closes players.
+     */
+    HPVLatencySnapshot HPVManager::getLatencySnapshot()
+    {
+        HPVLatencySnapshot total;
+        
+        for (auto& player : m_players)
+        {
+            total.add(player->getLatencySnapshot());
+        }
+        
+        return total;
+    }
+    
+    void HPVManager::resetLatencyStats()
+    {
+        for (auto& player : m_players)
+        {
+            player->resetLatencyStats();
+        }
     }
     
     void HPVManager::closeAll()
     {
+        for (auto& group : m_groups)
+        {
+            group->clear();
+        }
+        
+        m_groups.clear();
+        
         for (auto& player : m_players)
         {
-            player.second->close();
+            player->close();
         }
         
-        m_num_players = 0;
-
         m_players.clear();
+        m_dirty_bits.clear();
+        ++m_generation;
         m_event_queue.clear();
+        m_decode_pool.shutdown();
+        m_io_engine.shutdown();
         HPV_VERBOSE("Cleared all HPV Players");
     }
     
@@ -209,8 +290,13 @@ namespace HPV {
     
     HPVPlayerRef NewPlayer()
     {
-        uint8_t node_idx = ManagerSingleton()->initPlayer();
-        return ManagerSingleton()->getPlayer(node_idx);
+        HPVHandle handle = ManagerSingleton()->initPlayer();
+        return ManagerSingleton()->getPlayer(handle);
+    }
+    
+    HPVPlayerGroupRef NewPlayerGroup()
+    {
+        return ManagerSingleton()->newGroup();
     }
   
     void Update()
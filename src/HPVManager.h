@@ -14,17 +14,39 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
 #include "ThreadSafeQueue.h"
 #include "HPVEvent.h"
 #include "HPVPlayer.h"
+#include "HPVPlayerGroup.h"
+#include "HPVIOEngine.h"
+#include "HPVDecodePool.h"
 
 namespace HPV {
 
-    const uint8_t MAX_NUMBER_OF_PLAYERS = 6;
+    const uint32_t MAX_NUMBER_OF_PLAYERS = 256;
+    
+    /* Index of the lowest set bit, 'bits' must not be 0 */
+    inline uint32_t CountTrailingZeros(uint64_t bits)
+    {
+#if defined(_MSC_VER)
+        unsigned long idx;
+        _BitScanForward64(&idx, bits);
+        return static_cast<uint32_t>(idx);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif
+    }
     
     /*
      *  The HPVManager class is the global manager for all HPV resources.
      *  It takes care of adding and deleting new players on/from the HPV stack and updating their CPU resources.
+     *  By default the players are stepped by a shared decode pool with one thread per core, setThreadingModel()
+     *  switches back to one update thread per player for players opened afterwards.
+     *  Player groups made by newGroup() present their frames in update(), before the players are checked for new frames.
      *  It furthermore processes all HPV related events and posts them to the provided listeners, if any.
      */
     class HPVManager
@@ -33,22 +55,35 @@ namespace HPV {
         HPVManager();
         ~HPVManager();
         
-        uint8_t                     initPlayer();
-        HPVPlayerRef                getPlayer(uint8_t node_id);
+        HPVHandle                   initPlayer();
+        HPVPlayerRef                getPlayer(HPVHandle handle);
         std::size_t                 getNumPlayers() { return m_players.size(); }
-        std::vector<bool>           update();
+        HPVPlayerGroupRef           newGroup();
+        const std::vector<uint64_t>& update();
         void                        closeAll();
         void                        postEvent(const HPVEvent& event);
         void                        processEvents();
-        bool                        isValidNodeId(uint8_t node_id) { return node_id >= 0 && node_id < m_players.size(); }
+        bool                        isValidHandle(HPVHandle handle);
+        HPVIOEngine *               getIOEngine() { return &m_io_engine; }
+        HPVDecodePool *             getDecodePool();
+        void                        setThreadingModel(HPVThreadingModel model, unsigned num_pool_threads = 0);
+        HPVThreadingModel           getThreadingModel() { return m_threading_model; }
+        HPVLatencySnapshot          getLatencySnapshot();
+        void                        resetLatencyStats();
         
         std::vector<HPVEventCallback> m_event_listeners;
 
     private:
-        std::map<uint8_t, HPVPlayerRef>   m_players;
+        HPVIOEngine                 m_io_engine;    /* declared first: outlives the players that read through it */
+        HPVDecodePool               m_decode_pool;  /* idem, for the players it steps */
+        HPVThreadingModel           m_threading_model;
+        unsigned                    m_num_pool_threads;
+        std::vector<HPVPlayerRef>   m_players;      /* slab indexed by HPVHandleIndex(), players are only removed all at once */
+        std::vector<HPVPlayerGroupRef> m_groups;
+        std::vector<uint64_t>       m_dirty_bits;   /* one bit per player with a new frame, refilled by update() */
         ThreadSafe_Queue<HPVEvent>  m_event_queue;
-        uint8_t                     m_num_players;
-        int8_t                      addPlayer();
+        uint16_t                    m_generation;   /* bumped by closeAll(), invalidates all handles handed out before */
+        HPVHandle                   addPlayer();
     };
     
     /*
@@ -58,6 +93,7 @@ namespace HPV {
     void            InitHPVEngine(bool log_to_file=false);
     void            DestroyHPVEngine();
     HPVPlayerRef    NewPlayer();
+    HPVPlayerGroupRef NewPlayerGroup();
     void            Update();
     
     /*
@@ -1,6 +1,9 @@
 #include <string.h>
 
 #include "HPVPlayer.h"
+#include "HPVManager.h"
+#include "HPVDXT.h"
+#include "HPVChecksum.h"
 #include "lz4.h"
 #include "lz4hc.h"
 
@@ -16,27 +19,48 @@ namespace HPV {
     };
 
     // helper function to read HPV header from file
-    static int readHeader(std::ifstream * const ifs, HPVHeader * const header)
+    static int readHeader(HPVFileReader * const reader, HPVHeader * const header)
     {
         int header_size = sizeof(uint32_t) * amount_header_fields;
         
-        ifs->read((char *)header, header_size);
-        
-        if (ifs->fail())
+        if (!reader->read(0, header_size, (char *)header))
             return -1;
         
+        // fields added in version 9 come after those of older files
+        header->tile_columns = 0;
+        header->tile_rows = 0;
+        
+        if (header->version >= HPV_VERSION_0_0_9)
+        {
+            int extra_size = sizeof(uint32_t) * (amount_header_fields_v9 - amount_header_fields);
+            
+            if (!reader->read(header_size, extra_size, (char *)&header->tile_columns))
+                return -1;
+        }
+        
         return 0;
     }
 
     HPVPlayer::HPVPlayer()
-    : _id(0)
+    : _id(HPV_INVALID_HANDLE)
     , _gather_stats(true)
+    , _read_mode(HPVReadMode::HPV_READ_STREAM)
+    , _advised_direction(HPV_DIRECTION_FORWARDS)
+    , _read_ahead_frames(0)
+    , _read_ahead_end(-1)
     , _num_bytes_in_header(0)
-    , _num_bytes_in_sizes_table(0)
+    , _frame_alignment(1)
+    , _num_slices(1)
+    , _tile_columns(1)
+    , _tile_rows(1)
+    , _num_tiles(1)
+    , _tile_buffer(nullptr)
+    , _tile_buffer_stride(0)
     , _filesize(0)
-    , _frame_sizes_table(nullptr)
-    , _frame_offsets_table(nullptr)
-    , _frame_buffer(nullptr)
+    , _l4z_buffer(nullptr)
+    , _l4z_buffer_size(0)
+    , _l4z_num_segments(0)
+    , _frame_ring_size(HPV_DEFAULT_FRAME_RING_SIZE)
     , _bytes_per_frame(0)
     , _new_frame_time(0)
     , _global_time_per_frame(0)
@@ -51,10 +75,41 @@ namespace HPV {
     , _direction(HPV_DIRECTION_FORWARDS)
     , _is_init(false)
     , _should_update(false)
+    , _threading_model(HPVThreadingModel::HPV_THREADS_PER_PLAYER)
+    , _wake_requested(false)
+    , _last_seek_ticket(0)
+    , _pending_seek(0)
+    , _seek_result_ticket(0)
+    , _seeking(false)
+    , _clock_locked(false)
+    , _clock_time(0.0)
+    , _clock_rate(0.0)
+    , _clock_sample_time(0)
+    , _clock_frame(0)
     , _m_event_sink(nullptr)
+    , _m_timing_sink(nullptr)
     {
         _update_result.store(0, std::memory_order_relaxed);
+        _presented_slot.store(0, std::memory_order_relaxed);
+        _acquired_slot.store(-1, std::memory_order_relaxed);
+        _num_decode_allocations.store(0, std::memory_order_relaxed);
+        _num_presented_frames.store(0, std::memory_order_relaxed);
+        _cpu_time.store(0, std::memory_order_relaxed);
+        _verify_frames.store(false, std::memory_order_relaxed);
+        _num_corrupt_frames.store(0, std::memory_order_relaxed);
+        _num_bytes_read.store(0, std::memory_order_relaxed);
+        _visible_tiles.store(0, std::memory_order_relaxed);
+        _decode_tiles.store(0, std::memory_order_relaxed);
         _was_seeked.store(false, std::memory_order_relaxed);
+        _seek_result.store(0, std::memory_order_relaxed);
+        _finished_seek.store(0, std::memory_order_relaxed);
+        _num_dropped_seeks.store(0, std::memory_order_relaxed);
+        _clock_changed.store(false, std::memory_order_relaxed);
+        _speed_changed.store(false, std::memory_order_relaxed);
+        _lateness_policy.store(HPVLatenessPolicy::HPV_LATENESS_DECODE_ALL, std::memory_order_relaxed);
+        _num_skipped_frames.store(0, std::memory_order_relaxed);
+        _grouped.store(false, std::memory_order_relaxed);
+        clearStaged();
         _header.magic = 0;
         _header.version = 0;
         _header.video_width = 0;
@@ -62,9 +117,9 @@ namespace HPV {
         _header.number_of_frames = 0;
         _header.frame_rate = 0;
         _header.crc_frame_sizes = 0;
-        _decode_stats.gpu_upload_time = 0;
-        _decode_stats.hdd_read_time = 0;
-        _decode_stats.l4z_decode_time = 0;
+        _hdd_read_time.store(0, std::memory_order_relaxed);
+        _l4z_decode_time.store(0, std::memory_order_relaxed);
+        _gpu_upload_time.store(0, std::memory_order_relaxed);
     }
     
     HPVPlayer::~HPVPlayer()
@@ -76,11 +131,11 @@ namespace HPV {
         HPV_VERBOSE("~HPVPLayer");
     }
     
-    int HPVPlayer::open(const std::string& filepath)
+    int HPVPlayer::open(const std::string& filepath, HPVReadMode read_mode, HPVIndexMode index_mode)
     {
         _is_init = false;
         
-        if (true == _ifs.is_open())
+        if (_reader && _reader->isOpen())
         {
             HPV_ERROR("Already loaded %s, call shutdown if you want to reload.", filepath.c_str());
             return HPV_RET_ERROR;
@@ -92,36 +147,38 @@ namespace HPV {
             return HPV_RET_ERROR;
         }
         
-        // open the input filestream
-        _ifs.open(filepath.c_str(), std::ios::binary | std::ios::in);
-        if (!_ifs.is_open())
+        // open the input file with the requested reader
+        _read_mode = read_mode;
+        _reader = CreateFileReader(_read_mode);
+        
+        if (!_reader->open(filepath))
         {
             HPV_ERROR("Failed to open: %s", filepath.c_str());
             return HPV_RET_ERROR;
         }
         
         // get filesize of HPV file
-        _ifs.seekg(0, std::ifstream::end);
-        _filesize = _ifs.tellg();
-        _ifs.seekg(0, std::ios_base::beg);
+        _filesize = static_cast<size_t>(_reader->getFileSize());
         
         if (0 == _filesize)
         {
-            _ifs.close();
+            _reader->close();
             HPV_ERROR("File size is 0 (%s).", filepath.c_str());
             return HPV_RET_ERROR;
         }
         
         // read the header
-        if (0 != HPV::readHeader(&_ifs, &_header))
+        if (0 != HPV::readHeader(_reader.get(), &_header))
         {
             HPV_ERROR("Failed to read HPV header from %s", filepath.c_str());
+            _reader->close();
             return HPV_RET_ERROR;
         }
         
         if (_header.magic != HPV_MAGIC)
         {
             HPV_ERROR("Wrong magic number")
+            _reader->close();
             return HPV_RET_ERROR;
         }
         
@@ -129,14 +186,14 @@ namespace HPV {
         if (0 == _header.video_width || _header.video_width > HPV_MAX_SIDE_SIZE)
         {
             HPV_ERROR("Video width is invalid. Either 0 or bigger than what we don't support yet. Video width: %u", _header.video_width);
-            _ifs.close();
+            _reader->close();
             return HPV_RET_ERROR;
         }
         
         if (0 == _header.video_height || _header.video_height > HPV_MAX_SIDE_SIZE)
         {
             HPV_ERROR("Video height is invalid. either 0 or bigger than what we don't support yet. Video height: %u", _header.video_height);
-            _ifs.close();
+            _reader->close();
             return HPV_RET_ERROR;
         }
         
@@ -147,29 +204,67 @@ namespace HPV {
         _file_name = _file_path.substr(_file_path.find_last_of("\\/")+1);
         
         // ready reading the header...save our position
-        _num_bytes_in_header = static_cast<uint32_t>(_ifs.tellg());
-        _num_bytes_in_sizes_table = _header.number_of_frames * sizeof(uint32_t);
+        _num_bytes_in_header = sizeof(uint32_t) * HPV::header_fields_for_version(_header.version);
         
-        // read in frame size table and check crc
-        _frame_sizes_table = new uint32_t[_header.number_of_frames];
-        _frame_offsets_table = new uint64_t[_header.number_of_frames];
-        
-        _ifs.read((char *)_frame_sizes_table, _num_bytes_in_sizes_table);
-        
-        uint32_t crc = 0;
-        for (uint32_t i=0 ; i<_header.number_of_frames; ++i)
+        // from version 7 on, frames can be aligned for unbuffered reads
+        _frame_alignment = 1;
+        if (_header.version >= HPV_VERSION_0_0_7 && _header.frame_alignment > 1)
         {
-            crc += _frame_sizes_table[i];
+            if ((_header.frame_alignment & (_header.frame_alignment - 1)) != 0)
+            {
+                HPV_ERROR("Frame alignment %u is not a power of 2, corrupt file", _header.frame_alignment);
+                _reader->close();
+                return HPV_RET_ERROR;
+            }
+            
+            _frame_alignment = _header.frame_alignment;
         }
         
-        if (crc != _header.crc_frame_sizes)
+        // from version 8 on, frames can be split in slices that are decompressed in parallel
+        _num_slices = 1;
+        if (_header.version >= HPV_VERSION_0_0_8 && _header.num_slices > 1)
         {
-            HPV_ERROR("Frame sizes table CRC doesn't match, corrupt file")
-            return HPV_RET_ERROR;
+            uint32_t block_rows = (_header.video_height + 3) / 4;
+            
+            if (_header.num_slices > HPV_MAX_SLICES || _header.num_slices > block_rows)
+            {
+                HPV_ERROR("Invalid number of slices %u for a frame of %u block rows, corrupt file", _header.num_slices, block_rows);
+                _reader->close();
+                return HPV_RET_ERROR;
+            }
+            
+            _num_slices = _header.num_slices;
         }
         
-        uint32_t start_offset = _num_bytes_in_header + _num_bytes_in_sizes_table;
-        this->populateFrameOffsets(start_offset);
+        // from version 9 on, frames can be split in a grid of tiles that are only read and decoded when visible
+        _tile_columns = 1;
+        _tile_rows = 1;
+        _num_tiles = 1;
+        if (_header.version >= HPV_VERSION_0_0_9 && (_header.tile_columns > 1 || _header.tile_rows > 1))
+        {
+            uint32_t block_columns = (_header.video_width + 3) / 4;
+            uint32_t block_rows = (_header.video_height + 3) / 4;
+            
+            if (0 == _header.tile_columns || _header.tile_columns > block_columns
+                || 0 == _header.tile_rows || _header.tile_rows > block_rows
+                || _header.tile_columns * _header.tile_rows > HPV_MAX_TILES || _num_slices > 1)
+            {
+                HPV_ERROR("Invalid tile grid %ux%u for a frame of %ux%u blocks, corrupt file", _header.tile_columns, _header.tile_rows, block_columns, block_rows);
+                _reader->close();
+                return HPV_RET_ERROR;
+            }
+            
+            if ((_header.video_width % 4) != 0 || (_header.video_height % 4) != 0)
+            {
+                HPV_ERROR("Tiled frames need a width and height that are multiples of 4, corrupt file");
+                _reader->close();
+                return HPV_RET_ERROR;
+            }
+            
+            _tile_columns = _header.tile_columns;
+            _tile_rows = _header.tile_rows;
+            _num_tiles = _tile_columns * _tile_rows;
+        }
         
         // calculate frame size in bytes from compression type
         _bytes_per_frame = _header.video_width * _header.video_height;
@@ -180,28 +275,124 @@ namespace HPV {
             _bytes_per_frame >>= 1;
         }
         
+        // where the frames are: read as a whole, or looked up frame by frame for long files. No compressed frame
+        // exceeds the LZ4 bound of its parts plus the slice table.
+        uint32_t frame_size_bound = static_cast<uint32_t>(LZ4_compressBound(static_cast<int>(_bytes_per_frame))) + 20 * std::max(_num_tiles, _num_slices);
+        
+        if (!_index.load(_reader.get(), filepath, _header, _num_tiles, _frame_alignment, frame_size_bound, index_mode))
+        {
+            freeFileBuffers();
+            return HPV_RET_ERROR;
+        }
+        
+        uint32_t max_frame_size = _index.getMaxFrameSize();
+        
         // get the native frame rate of the file (was given as parameter during compression) and set initial speed to speed 1
         uint32_t fps = _header.frame_rate;
-        _global_time_per_frame = static_cast<uint64_t>(double(1.0 / fps) * 1e9);
+        _global_time_per_frame = 1e9 / fps;
         
         // set to initial state
         this->resetPlayer();
         
-        // allocate the frame buffer, happens only once. We re-use the same memory space
-        _frame_buffer = new unsigned char[_bytes_per_frame];
+        // allocate the frame ring, happens only once. We re-use the same memory space
+        _frame_ring.resize(_frame_ring_size);
         
-        if (!_frame_buffer)
+        for (HPVFrameSlot& slot : _frame_ring)
         {
-            HPV_ERROR("Failed to allocate the frame buffer.");
-            _ifs.close();
-            return HPV_RET_ERROR;
+            slot.buffer = new (std::nothrow) unsigned char[_bytes_per_frame];
+            slot.frame = -1;
+            slot.tiles = 0;
+            
+            if (!slot.buffer)
+            {
+                HPV_ERROR("Failed to allocate the frame ring.");
+                freeFileBuffers();
+                return HPV_RET_ERROR;
+            }
+        }
+        
+        _presented_slot.store(0, std::memory_order_relaxed);
+        _acquired_slot.store(-1, std::memory_order_relaxed);
+        clearStaged();
+        
+        // about HPV_READ_AHEAD_BYTES of frames of average size are fetched ahead of the ring
+        uint64_t average_frame_size = std::max<uint64_t>(1, (_filesize - _num_bytes_in_header) / std::max(1u, _header.number_of_frames));
+        _read_ahead_frames = static_cast<uint32_t>(clamp<uint64_t>(HPV_READ_AHEAD_BYTES / average_frame_size, 1, HPV_MAX_READ_AHEAD_FRAMES));
+        _read_ahead_end = -1;
+        
+        // tiled frames are only partly decoded, those aren't cached
+        _frame_cache.setFrameSize((_num_tiles > 1) ? 0 : _bytes_per_frame, _header.number_of_frames);
+        
+        if (_num_tiles > 1)
+        {
+            // tiles narrower than the frame are decompressed into a buffer of their own, then copied row by row
+            if (_tile_columns > 1)
+            {
+                uint32_t block_columns = _header.video_width / 4;
+                uint32_t block_rows = _header.video_height / 4;
+                std::size_t bytes_per_block = _bytes_per_frame / (block_columns * block_rows);
+                
+                _tile_buffer_stride = 0;
+                for (uint32_t column = 0; column < _tile_columns; ++column)
+                {
+                    for (uint32_t row = 0; row < _tile_rows; ++row)
+                    {
+                        std::size_t tile_columns = tile_first_block(column + 1, block_columns, _tile_columns) - tile_first_block(column, block_columns, _tile_columns);
+                        std::size_t tile_rows = tile_first_block(row + 1, block_rows, _tile_rows) - tile_first_block(row, block_rows, _tile_rows);
+                        
+                        _tile_buffer_stride = std::max(_tile_buffer_stride, tile_columns * tile_rows * bytes_per_block);
+                    }
+                }
+                
+                _tile_buffer = new (std::nothrow) unsigned char[_tile_buffer_stride * _num_tiles];
+                
+                if (!_tile_buffer)
+                {
+                    HPV_ERROR("Failed to allocate the tile buffer.");
+                    freeFileBuffers();
+                    return HPV_RET_ERROR;
+                }
+            }
+            
+            // everything is visible until told otherwise
+            _visible_tiles.store(AllTiles(_tile_columns, _tile_rows), std::memory_order_relaxed);
+            _decode_tiles.store(AllTiles(_tile_columns, _tile_rows), std::memory_order_relaxed);
+        }
+        
+        // size the buffer for compressed frames once for the largest frame, playback never needs to grow it.
+        // Async readers keep a batch of reads in flight, one segment per frame ring slot.
+        if (_reader->needsScratch())
+        {
+            _l4z_num_segments = _reader->isAsync() ? _frame_ring_size : 1;
+            
+            // unbuffered readers need aligned segments and room to widen reads to whole blocks
+            std::size_t alignment = _reader->getScratchAlignment();
+            std::size_t segment_size = static_cast<std::size_t>(align_up(max_frame_size + _reader->getScratchPadding(), alignment));
+            
+            AlignedFree(_l4z_buffer);
+            _l4z_buffer = static_cast<char *>(AlignedAlloc(segment_size * _l4z_num_segments, alignment));
+            
+            if (!_l4z_buffer)
+            {
+                HPV_ERROR("Failed to allocate the decompression buffer.");
+                freeFileBuffers();
+                return HPV_RET_ERROR;
+            }
+            
+            _l4z_buffer_size = segment_size;
         }
         
+        _num_decode_allocations.store(0, std::memory_order_relaxed);
+        _num_bytes_read.store(0, std::memory_order_relaxed);
+        
+        // known before the first frame is decoded: it decides whether slices and tiles go to the decode pool
+        _threading_model = ManagerSingleton()->getThreadingModel();
+        
         // read the first frame
         if (!readCurrentFrame())
         {
             HPV_ERROR("Failed to read the first frame.");
-            _ifs.close();
+            freeFileBuffers();
             return HPV_RET_ERROR;
         }
         
@@ -222,36 +413,24 @@ namespace HPV {
             _update_result.store(0, std::memory_order_release);
             _should_update = false;
             
-            if (_update_thread.joinable())
-            {
-                _update_thread.join();
-            }
-            _update_result = 0;
-            
-            HPV_VERBOSE("Closed HPV worker thread for '%s'", _file_name.c_str());
-            
-            if (_ifs.is_open())
+            if (HPVThreadingModel::HPV_THREADS_POOL == _threading_model)
             {
-                _ifs.close();
+                ManagerSingleton()->getDecodePool()->removePlayer(this);
             }
-            
-            if (_frame_buffer)
+            else
             {
-                delete [] _frame_buffer;
-                _frame_buffer = nullptr;
+                wake();
+                
+                if (_update_thread.joinable())
+                {
+                    _update_thread.join();
+                }
             }
+            _update_result = 0;
             
-            if (_frame_sizes_table)
-            {
-                delete [] _frame_sizes_table;
-                _frame_sizes_table = nullptr;
-            }
+            HPV_VERBOSE("Stopped stepping HPV player for '%s'", _file_name.c_str());
             
-            if (_frame_offsets_table)
-            {
-                delete [] _frame_offsets_table;
-                _frame_offsets_table = nullptr;
-            }
+            freeFileBuffers();
             
             // clear out header
             memset(&_header, 0x00, HPV::amount_header_fields);
@@ -272,375 +451,1691 @@ namespace HPV {
         return HPV_RET_ERROR_NONE;
     }
     
-    void HPVPlayer::populateFrameOffsets(uint32_t start_offset)
+    /*
+     *  Closes the reader and frees everything open() allocated for the file. Used by close(), and by open()
+     *  when it fails halfway, so a failed open() leaks nothing and the next one starts from an empty ring.
+     */
+    void HPVPlayer::freeFileBuffers()
     {
-        uint64_t offset_runner = (uint64_t)start_offset;
-        _frame_offsets_table[0] = offset_runner;
+        if (_reader)
+        {
+            _reader->close();
+            _reader.reset();
+        }
+        
+        for (HPVFrameSlot& slot : _frame_ring)
+        {
+            delete [] slot.buffer;
+        }
+        _frame_ring.clear();
+        _presented_slot.store(0, std::memory_order_relaxed);
+        _acquired_slot.store(-1, std::memory_order_relaxed);
+        _frame_cache.clear();
         
-        for (uint32_t frame_idx = 1; frame_idx < _header.number_of_frames; ++frame_idx)
+        if (_l4z_buffer)
         {
-            offset_runner += _frame_sizes_table[frame_idx-1];
-            _frame_offsets_table[frame_idx] = offset_runner;
+            AlignedFree(_l4z_buffer);
+            _l4z_buffer = nullptr;
         }
+        _l4z_buffer_size = 0;
+        _l4z_num_segments = 0;
+        
+        _index.clear();
+        
+        if (_tile_buffer)
+        {
+            delete [] _tile_buffer;
+            _tile_buffer = nullptr;
+        }
+        _tile_buffer_stride = 0;
+        _tile_columns = 1;
+        _tile_rows = 1;
+        _num_tiles = 1;
     }
     
-    inline int HPVPlayer::readCurrentFrame()
+    int HPVPlayer::decodeFrame(int64_t frame, unsigned char* dst)
     {
-        static uint64_t _before_read, _before_decode;
-        static uint64_t _after_read, _after_decode;
+        uint64_t before_read = 0;
         
         if (_gather_stats)
         {
-            _before_read = ns();
-            _before_decode = _before_read;
+            before_read = ns();
         }
         
-        _ifs.seekg(_frame_offsets_table[_curr_frame]);
+        HPVFrameIndexEntry entry = _index.entry(frame);
         
-        if (!_ifs.good())
+        if (0 == entry.size)
         {
-            HPV_ERROR("Failed to seek to %lu", _frame_offsets_table[_curr_frame]);
+            HPV_ERROR("No index entry for frame %" PRId64, frame);
             return HPV_RET_ERROR;
         }
         
-        // create local buffer for storing L4Z compressed frame
-        char * _l4z_buffer = new (std::nothrow) char[ _frame_sizes_table[_curr_frame] ];
+        // buffer for storing the L4Z compressed frame, not needed when the reader points straight into the file
+        char * scratch = nullptr;
+        
+        if (_reader->needsScratch())
+        {
+            scratch = getScratchBuffer(entry.size);
+            
+            if (!scratch)
+            {
+                HPV_ERROR("Couldn't create decompression buffer for frame %" PRId64, frame);
+                return HPV_RET_ERROR;
+            }
+        }
+        
+        // read L4Z data from disk, or get a pointer to it inside the mapping
+        const char * l4z_data = _reader->acquire(entry.offset, entry.size, scratch);
         
-        if (!_l4z_buffer)
+        if (!l4z_data)
         {
-            HPV_ERROR("Couldn't create decompression buffer for frame %" PRId64, _curr_frame);
+            HPV_ERROR("Failed to read frame %" PRId64, frame);
             return HPV_RET_ERROR;
         }
         
-        // read L4Z data from disk into buffer
-        _ifs.read(_l4z_buffer, _frame_sizes_table[_curr_frame]);
+        _num_bytes_read.fetch_add(entry.size, std::memory_order_relaxed);
         
-        if (!_ifs.good())
+        // the seek this frame was read for has been overtaken, don't spend the decompress on it
+        if (seekAbandoned())
         {
-            HPV_ERROR("Couldn't read compressed data from disk!");
             return HPV_RET_ERROR;
         }
         
+        return decompressFrame(l4z_data, entry.size, frame, dst, _gather_stats ? ns() - before_read : 0);
+    }
+    
+    int HPVPlayer::decompressFrame(const char* l4z_data, uint32_t l4z_size, int64_t frame, unsigned char* dst, uint64_t read_time)
+    {
+        uint64_t before_decode = 0;
+        
         if (_gather_stats)
         {
-            _after_read = ns();
-            
-            _decode_stats.hdd_read_time = _after_read - _before_read;
+            before_decode = ns();
         }
         
-        if (!_ifs.good())
+        if (!verifyFrame(l4z_data, frame))
         {
-            HPV_ERROR("Failed to read frame %" PRId64, _curr_frame);
             return HPV_RET_ERROR;
         }
         
-        if (_gather_stats)
+        // decompress L4Z, never reading past the frame: with a mapping that could be past the end of the file
+        int ret_decomp = 0;
+        
+        if (_num_slices > 1)
         {
-            _before_decode = ns();
+            ret_decomp = decompressSlices(l4z_data, frame, dst);
+        }
+        else if (LZ4_decompress_safe(l4z_data, (char *)dst, static_cast<int>(l4z_size), static_cast<int>(_bytes_per_frame)) == static_cast<int>(_bytes_per_frame))
+        {
+            ret_decomp = 1;
         }
         
-        // decompress L4Z
-        int ret_decomp = LZ4_decompress_fast((const char *)_l4z_buffer, (char *)_frame_buffer, static_cast<int>(_bytes_per_frame));
-        
-        if (ret_decomp == 0)
+        if (ret_decomp <= 0)
         {
-            HPV_ERROR("Failed to decompress frame %" PRId64, _curr_frame);
+            HPV_ERROR("Failed to decompress frame %" PRId64, frame);
             return HPV_RET_ERROR;
         }
         
         if (_gather_stats)
         {
-            _after_decode = ns();
-            
-            _decode_stats.l4z_decode_time = _after_decode - _before_decode;
+            recordFrameTiming(frame, read_time, ns() - before_decode);
         }
         
-        delete [] _l4z_buffer;
-        
-        _update_result.store(1, std::memory_order_relaxed);
-        
-        _curr_buffered_frame = _curr_frame;
-        
-        //HPV_VERBOSE("ID %d read frame %" PRId64, getID(), _curr_buffered_frame);
-        
         return HPV_RET_ERROR_NONE;
     }
     
-    void HPVPlayer::launchUpdateThread()
-    {
-        // start thread now that everything is set for this player
-        _should_update = true;
-        _update_thread = std::thread(&HPVPlayer::update, this);
-    }
-    
-    int HPVPlayer::play()
+    /*
+     *  Version 10 files with setVerifyFrames(true): checks the compressed frame against its CRC32C from the
+     *  index. Runs on the thread that decodes the frame, right before it's decompressed.
+     */
+    bool HPVPlayer::verifyFrame(const char* l4z_data, int64_t frame)
     {
-        if (!_ifs.is_open())
-        {
-            HPV_VERBOSE("Trying to play, but the file stream is not opened. Did you call init()?");
-            return HPV_RET_ERROR;
-        }
-        
-        if (isPlaying())
+        if (!_index.hasChecksums() || !_verify_frames.load(std::memory_order_relaxed))
         {
-            HPV_VERBOSE("Already playing");
-            return HPV_RET_ERROR;
+            return true;
         }
         
-        _new_frame_time = ns() + _local_time_per_frame;
+        HPVFrameIndexEntry entry = _index.entry(frame);
         
-        /* Rewind to first frame when we were stopped */
-        if (isStopped())
+        if (CRC32C(l4z_data, entry.size) != entry.crc)
         {
-            _curr_frame = _loop_in;
+            reportCorruptFrame(frame);
+            return false;
         }
         
-        _state = HPV_STATE_PLAYING;
-        
-        notifyHPVEvent(HPVEventType::HPV_EVENT_PLAY);
-        
-        return HPV_RET_ERROR_NONE;
+        return true;
     }
     
-    int HPVPlayer::play(int fps)
+    void HPVPlayer::reportCorruptFrame(int64_t frame)
     {
-        _global_time_per_frame = static_cast<uint64_t>(double(1.0 / fps) * 1e9);
-        _local_time_per_frame = _global_time_per_frame;
-        
-        return this->play();
+        HPV_ERROR("Frame %" PRId64 " of %s doesn't match its checksum, corrupt file", frame, _file_name.c_str());
+        _num_corrupt_frames.fetch_add(1, std::memory_order_relaxed);
+        notifyHPVEvent(HPVEventType::HPV_EVENT_CORRUPT_FRAME);
     }
     
-    int HPVPlayer::pause()
+    /*
+     *  Keeps the read and decode time of a decoded frame in the decode stats and latency histograms and hands
+     *  them to the timing sink
+     */
+    void HPVPlayer::recordFrameTiming(int64_t frame, uint64_t read_time, uint64_t decode_time)
     {
-        if (!isPlaying())
-        {
-            HPV_VERBOSE("Calling pause() on a video that's not playing");
-            return HPV_RET_ERROR;
-        }
+        _hdd_read_time.store(read_time, std::memory_order_relaxed);
+        _l4z_decode_time.store(decode_time, std::memory_order_relaxed);
+        _latency_stats.read.record(read_time);
+        _latency_stats.decode.record(decode_time);
         
-        if (isPaused())
+        ThreadSafe_Queue<HPVFrameTiming> * sink = _m_timing_sink.load(std::memory_order_acquire);
+        
+        if (sink)
         {
-            HPV_VERBOSE("Calling pause() on a video that's already paused");
-            return HPV_RET_ERROR;
+            HPVFrameTiming timing = { _id, frame, read_time, decode_time };
+            sink->push(timing);
         }
-        
-        _state = HPV_STATE_PAUSED;
-        
-        notifyHPVEvent(HPVEventType::HPV_EVENT_PAUSE);
-        
-        return HPV_RET_ERROR_NONE;
     }
     
-    int HPVPlayer::resume()
+    /*
+     *  Spreads the parts of one frame over the decode pool. With a thread per player the pool isn't started for
+     *  this: the parts run one after the other on the calling thread.
+     */
+    void HPVPlayer::parallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
     {
-        if (!isPaused())
+        if (HPVThreadingModel::HPV_THREADS_POOL == _threading_model)
         {
-            HPV_VERBOSE("Calling resume() on a video that's not paused");
-            return HPV_RET_ERROR;
+            ManagerSingleton()->getDecodePool()->parallelFor(count, func);
+            return;
         }
         
-        _new_frame_time = ns() + _local_time_per_frame;
-        
-        _state = HPV_STATE_PLAYING;
-        
-        notifyHPVEvent(HPVEventType::HPV_EVENT_RESUME);
-        
-        return HPV_RET_ERROR_NONE;
-    }
-    
-    int HPVPlayer::stop()
-    {
-        if (!isPlaying() && !isPaused())
+        for (uint32_t idx = 0; idx < count; ++idx)
         {
-            HPV_ERROR("Cannot stop because we're not playing or paused");
-            return HPV_RET_ERROR;
+            func(idx);
         }
-        
-        _state = HPV_STATE_STOPPED;
-        
-        _curr_frame = _loop_in;
-        
-        this->seek(_curr_frame);
-                
-        notifyHPVEvent(HPVEventType::HPV_EVENT_STOP);
-        
-        return HPV_RET_ERROR_NONE;
     }
     
-    int HPVPlayer::setLoopMode(uint8_t loop_mode)
+    unsigned HPVPlayer::getNumParallelThreads()
     {
-        _loop_mode = loop_mode;
-        
-        return HPV_RET_ERROR_NONE;
+        return (HPVThreadingModel::HPV_THREADS_POOL == _threading_model) ? ManagerSingleton()->getDecodePool()->getNumThreads() : 1;
     }
     
-    int HPVPlayer::setLoopInPoint(int64_t loop_in)
+    /*
+     *  Decompresses the slices of a version 8 frame concurrently on the decode pool, each straight into
+     *  its block rows of 'dst'. Returns a positive value on success.
+     */
+    int HPVPlayer::decompressSlices(const char* l4z_data, int64_t frame, unsigned char* dst)
     {
-        if (loop_in >= 0 && loop_in < _header.number_of_frames)
+        struct SliceJob
         {
-            _loop_in = loop_in;
-            
-            if (_curr_frame < _loop_in)
-            {
-                this->seek((int64_t)_loop_in);
-            }
+            const char *    src;
+            unsigned char * dst;
+            uint32_t        sizes[HPV_MAX_SLICES];
+            uint64_t        src_offsets[HPV_MAX_SLICES];
+            std::size_t     bytes_per_block_row;
+            std::size_t     bytes_per_frame;
+            uint32_t        block_rows;
+            uint32_t        num_slices;
+            std::atomic<bool> failed;
+        } job;
+        
+        if (_index.size(frame) < _num_slices * sizeof(uint32_t))
+        {
+            HPV_ERROR("Frame %" PRId64 " is smaller than its slice table, corrupt file", frame);
+            return 0;
         }
-        else
+        
+        // the slice table may sit at any offset in a mapping, copy it out
+        memcpy(job.sizes, l4z_data, _num_slices * sizeof(uint32_t));
+        
+        uint64_t offset = _num_slices * sizeof(uint32_t);
+        for (uint32_t slice = 0; slice < _num_slices; ++slice)
         {
-            _loop_in = 0;
+            job.src_offsets[slice] = offset;
+            offset += job.sizes[slice];
         }
         
-        return HPV_RET_ERROR_NONE;
-    }
-    
-    int HPVPlayer::setLoopOutPoint(int64_t loop_out)
-    {
-        if (loop_out > _loop_in && loop_out < _header.number_of_frames)
+        if (offset > _index.size(frame))
         {
-            _loop_out = loop_out;
+            HPV_ERROR("Slice table of frame %" PRId64 " exceeds the frame size, corrupt file", frame);
+            return 0;
+        }
+        
+        job.src = l4z_data;
+        job.dst = dst;
+        job.block_rows = (_header.video_height + 3) / 4;
+        job.num_slices = _num_slices;
+        job.bytes_per_frame = _bytes_per_frame;
+        job.bytes_per_block_row = _bytes_per_frame / job.block_rows;
+        job.failed.store(false, std::memory_order_relaxed);
+        
+        // one small capture, so the std::function doesn't allocate
+        parallelFor(_num_slices, [&job](uint32_t slice)
+        {
+            std::size_t begin = slice_first_block_row(slice, job.block_rows, job.num_slices) * job.bytes_per_block_row;
+            std::size_t end = (slice + 1 == job.num_slices) ? job.bytes_per_frame : slice_first_block_row(slice + 1, job.block_rows, job.num_slices) * job.bytes_per_block_row;
             
-            if (_curr_frame > _loop_out)
+            int ret = LZ4_decompress_safe(job.src + job.src_offsets[slice], (char *)job.dst + begin, static_cast<int>(job.sizes[slice]), static_cast<int>(end - begin));
+            
+            if (ret != static_cast<int>(end - begin))
             {
-                this->seek((int64_t)_loop_in);
+                job.failed.store(true, std::memory_order_relaxed);
             }
-        }
-        else
-        {
-            _loop_out = _header.number_of_frames-1;
-        }
+        });
         
-        return HPV_RET_ERROR_NONE;
+        return job.failed.load(std::memory_order_relaxed) ? 0 : static_cast<int>(_bytes_per_frame);
     }
     
     /*
-     *  Threaded function. Updates the times until a new frame should be read.
-     *
-     *  The result is stored in std::atomic<bool> updateResult. This way, the main thread
-     *  can query when a new frame is ready.
-     *  updateResult > 0    -> new frame is ready
-     *  updateResult = 0    -> not yet there, still iterating
-     *
+     *  Reads and decompresses the given tiles of a version 9 frame into their blocks of 'dst', the other tiles
+     *  are left untouched. Tiles that are next to each other in the file are fetched with one read, the tiles
+     *  of a read are decompressed concurrently on the decode pool.
      */
-    void HPVPlayer::update()
+    int HPVPlayer::decodeTiles(int64_t frame, unsigned char* dst, uint64_t tiles)
     {
-        while (_should_update)
+        struct TileJob
+        {
+            const char *    src;
+            unsigned char * dst;
+            unsigned char * tile_buffer;
+            std::size_t     tile_buffer_stride;
+            uint64_t        src_offsets[HPV_MAX_TILES + 1];     /* of every tile, relative to the start of the frame */
+            uint64_t        read_offset;                        /* of 'src', relative to the start of the frame */
+            std::size_t     bytes_per_block;
+            uint32_t        block_columns;
+            uint32_t        block_rows;
+            uint32_t        tile_columns;
+            uint32_t        tile_rows;
+            uint32_t        first_tile;
+            const uint32_t * tile_crcs;                         /* nullptr: not verified */
+            std::atomic<bool> failed;
+            std::atomic<bool> corrupt;
+        } job;
+        
+        HPVFrameIndexEntry entry = _index.entry(frame);
+        const uint32_t * tile_sizes = _index.tileSizes(frame);
+        bool verify = _index.hasChecksums() && _verify_frames.load(std::memory_order_relaxed);
+        
+        job.src_offsets[0] = 0;
+        for (uint32_t tile = 0; tile < _num_tiles; ++tile)
+        {
+            job.src_offsets[tile + 1] = job.src_offsets[tile] + tile_sizes[tile];
+        }
+        
+        // a lazy index only checks the tile sizes of the frames it reads
+        if (0 == entry.size || job.src_offsets[_num_tiles] != entry.size)
+        {
+            HPV_ERROR("Tile index doesn't match the size of frame %" PRId64 ", corrupt file", frame);
+            return HPV_RET_ERROR;
+        }
+        
+        job.dst = dst;
+        job.tile_buffer = _tile_buffer;
+        job.tile_buffer_stride = _tile_buffer_stride;
+        job.block_columns = _header.video_width / 4;
+        job.block_rows = _header.video_height / 4;
+        job.bytes_per_block = _bytes_per_frame / (job.block_columns * job.block_rows);
+        job.tile_columns = _tile_columns;
+        job.tile_rows = _tile_rows;
+        job.tile_crcs = verify ? _index.tileCRCs(frame) : nullptr;
+        job.failed.store(false, std::memory_order_relaxed);
+        job.corrupt.store(false, std::memory_order_relaxed);
+        
+        uint64_t read_time = 0;
+        uint64_t decode_time = 0;
+        uint32_t tile = 0;
+        
+        while (tile < _num_tiles)
         {
-            uint64_t now;
+            if (!(tiles & (uint64_t(1) << tile)))
+            {
+                ++tile;
+                continue;
+            }
             
-            if (_was_seeked.load())
+            // a run of wanted tiles, adjacent in the file
+            uint32_t first_tile = tile;
+            while (tile < _num_tiles && (tiles & (uint64_t(1) << tile)))
             {
-                 std::unique_lock<std::mutex> lock(_mtx);
-                
-                _curr_frame = _seeked_frame;
-                _was_seeked.store(false, std::memory_order_relaxed);
+                ++tile;
+            }
+            
+            std::size_t size = static_cast<std::size_t>(job.src_offsets[tile] - job.src_offsets[first_tile]);
+            uint64_t before_read = _gather_stats ? ns() : 0;
+            char * scratch = nullptr;
+            
+            if (_reader->needsScratch())
+            {
+                scratch = getScratchBuffer(size);
                 
-                /* Read the frame from the file */
-                if (!readCurrentFrame())
-                {
-                    _seek_result.store(-1, std::memory_order_relaxed);
-                }
-                else
+                if (!scratch)
                 {
-                    _seek_result.store(1, std::memory_order_relaxed);
+                    HPV_ERROR("Couldn't create decompression buffer for frame %" PRId64, frame);
+                    return HPV_RET_ERROR;
                 }
+            }
             
-                now = ns();
-    
-                lock.unlock();
-                _seeked_signal.notify_one();
-                
+            job.src = _reader->acquire(entry.offset + job.src_offsets[first_tile], size, scratch);
+            
+            if (!job.src)
+            {
+                HPV_ERROR("Failed to read tiles %u - %u of frame %" PRId64, first_tile, tile - 1, frame);
+                return HPV_RET_ERROR;
+            }
+            
+            _num_bytes_read.fetch_add(size, std::memory_order_relaxed);
+            
+            if (seekAbandoned())
+            {
+                return HPV_RET_ERROR;
+            }
+            
+            uint64_t before_decode = _gather_stats ? ns() : 0;
+            read_time += before_decode - before_read;
+            
+            job.read_offset = job.src_offsets[first_tile];
+            job.first_tile = first_tile;
+            
+            // one small capture, so the std::function doesn't allocate
+            parallelFor(tile - first_tile, [&job](uint32_t idx)
+            {
+                uint32_t tile = job.first_tile + idx;
+                uint32_t column = tile % job.tile_columns;
+                uint32_t row = tile / job.tile_columns;
+                
+                uint32_t first_block_column = tile_first_block(column, job.block_columns, job.tile_columns);
+                uint32_t first_block_row = tile_first_block(row, job.block_rows, job.tile_rows);
+                uint32_t num_block_rows = tile_first_block(row + 1, job.block_rows, job.tile_rows) - first_block_row;
+                
+                std::size_t frame_row_bytes = job.block_columns * job.bytes_per_block;
+                std::size_t tile_row_bytes = (tile_first_block(column + 1, job.block_columns, job.tile_columns) - first_block_column) * job.bytes_per_block;
+                std::size_t tile_bytes = tile_row_bytes * num_block_rows;
+                
+                unsigned char * frame_dst = job.dst + first_block_row * frame_row_bytes + first_block_column * job.bytes_per_block;
+                
+                // a tile as wide as the frame is contiguous in it, narrower ones go through the tile buffer
+                unsigned char * tile_dst = (1 == job.tile_columns) ? frame_dst : job.tile_buffer + tile * job.tile_buffer_stride;
+                
+                const char * tile_src = job.src + (job.src_offsets[tile] - job.read_offset);
+                uint32_t tile_src_size = static_cast<uint32_t>(job.src_offsets[tile + 1] - job.src_offsets[tile]);
+                
+                if (job.tile_crcs && CRC32C(tile_src, tile_src_size) != job.tile_crcs[tile])
+                {
+                    job.corrupt.store(true, std::memory_order_relaxed);
+                    job.failed.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                
+                int ret = LZ4_decompress_safe(tile_src, (char *)tile_dst, static_cast<int>(tile_src_size), static_cast<int>(tile_bytes));
+                
+                if (ret != static_cast<int>(tile_bytes))
+                {
+                    job.failed.store(true, std::memory_order_relaxed);
+                    return;
+                }
+                
+                if (tile_dst != frame_dst)
+                {
+                    for (uint32_t block_row = 0; block_row < num_block_rows; ++block_row)
+                    {
+                        memcpy(frame_dst + block_row * frame_row_bytes, tile_dst + block_row * tile_row_bytes, tile_row_bytes);
+                    }
+                }
+            });
+            
+            if (job.corrupt.load(std::memory_order_relaxed))
+            {
+                reportCorruptFrame(frame);
+                return HPV_RET_ERROR;
+            }
+            
+            if (job.failed.load(std::memory_order_relaxed))
+            {
+                HPV_ERROR("Failed to decompress tiles %u - %u of frame %" PRId64, first_tile, tile - 1, frame);
+                return HPV_RET_ERROR;
+            }
+            
+            if (_gather_stats)
+            {
+                decode_time += ns() - before_decode;
+            }
+        }
+        
+        if (_gather_stats)
+        {
+            recordFrameTiming(frame, read_time, decode_time);
+        }
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    /*
+     *  Tiled files: the wanted tiles that the slot doesn't hold yet. Always 0 for other files.
+     */
+    uint64_t HPVPlayer::missingTiles(int slot_idx)
+    {
+        if (_num_tiles <= 1)
+        {
+            return 0;
+        }
+        
+        return _decode_tiles.load(std::memory_order_acquire) & ~_frame_ring[slot_idx].tiles;
+    }
+    
+    /*
+     *  Decodes 'frame' into a slot of the ring. Of tiled files only the wanted tiles are decoded, and
+     *  when the slot already holds the frame only the wanted tiles it doesn't have yet.
+     */
+    int HPVPlayer::fillSlot(int slot_idx, int64_t frame)
+    {
+        HPVFrameSlot& slot = _frame_ring[slot_idx];
+        
+        if (slot.frame != frame)
+        {
+            // the slot is about to be overwritten, forget what it held in case decoding fails
+            slot.frame = -1;
+            slot.tiles = 0;
+        }
+        
+        int ret;
+        
+        if (_num_tiles > 1)
+        {
+            uint64_t missing = missingTiles(slot_idx);
+            
+            ret = decodeTiles(frame, slot.buffer, missing);
+            slot.tiles |= missing;
+        }
+        else
+        {
+            ret = decodeFrame(frame, slot.buffer);
+        }
+        
+        if (!ret)
+        {
+            slot.frame = -1;
+            slot.tiles = 0;
+            return HPV_RET_ERROR;
+        }
+        
+        slot.frame = frame;
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    /*
+     *  Returns a segment of the scratch buffer for compressed frame data. It is sized for the largest frame at open(),
+     *  so during playback this should never allocate; every allocation it does make is counted.
+     */
+    char * HPVPlayer::getScratchBuffer(std::size_t size, uint32_t segment)
+    {
+        if (segment >= _l4z_num_segments)
+        {
+            return nullptr;
+        }
+        
+        std::size_t alignment = _reader->getScratchAlignment();
+        std::size_t segment_size = static_cast<std::size_t>(align_up(size + _reader->getScratchPadding(), alignment));
+        
+        if (segment_size > _l4z_buffer_size)
+        {
+            char * grown = static_cast<char *>(AlignedAlloc(segment_size * _l4z_num_segments, alignment));
+            
+            if (!grown)
+            {
+                return nullptr;
+            }
+            
+            AlignedFree(_l4z_buffer);
+            _l4z_buffer = grown;
+            _l4z_buffer_size = segment_size;
+            _num_decode_allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        return _l4z_buffer + segment * _l4z_buffer_size;
+    }
+    
+    /*
+     *  Makes _curr_frame the presented frame. When the frame was already decoded ahead
+     *  of time it is taken straight from the ring, when it was shown a moment ago from the
+     *  frame cache, otherwise it is read and decoded now.
+     */
+    int HPVPlayer::readCurrentFrame()
+    {
+        int slot_idx = findSlot(_curr_frame);
+        
+        if (slot_idx < 0 || missingTiles(slot_idx))
+        {
+            if (slot_idx < 0)
+            {
+                slot_idx = findFreeSlot();
+                
+                if (slot_idx < 0)
+                {
+                    return HPV_RET_ERROR;
+                }
+                
+                if (_frame_cache.get(_curr_frame, _frame_ring[slot_idx].buffer))
+                {
+                    _frame_ring[slot_idx].frame = _curr_frame;
+                    _frame_ring[slot_idx].tiles = 0;
+                }
+                else if (!fillSlot(slot_idx, _curr_frame))
+                {
+                    return HPV_RET_ERROR;
+                }
+            }
+            else
+            {
+                // tiles that came into view are added to a copy when the renderer may be reading the frame
+                slot_idx = writableSlot(slot_idx);
+                
+                if (slot_idx < 0 || !fillSlot(slot_idx, _curr_frame))
+                {
+                    return HPV_RET_ERROR;
+                }
+            }
+        }
+        
+        // seq_cst: pairs with acquireFrame(), see there
+        _presented_slot.store(slot_idx);
+        
+        _update_result.store(1, std::memory_order_relaxed);
+        _num_presented_frames.fetch_add(1, std::memory_order_relaxed);
+        
+        _curr_buffered_frame = _curr_frame.load();
+        
+        //HPV_VERBOSE("ID %d read frame %" PRId64, getID(), _curr_buffered_frame);
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    /*
+     *  Keeps the frame on screen in the frame cache, so seeking back to it is a copy
+     */
+    void HPVPlayer::cachePresentedFrame()
+    {
+        HPVFrameSlot& slot = _frame_ring[_presented_slot.load(std::memory_order_relaxed)];
+        
+        // nothing was decoded yet right after open()
+        if (slot.frame >= 0 && slot.frame == _curr_buffered_frame)
+        {
+            _frame_cache.put(slot.frame, slot.buffer);
+        }
+    }
+    
+    /*
+     *  Grouped players: decodes _curr_frame like readCurrentFrame() does, but only stages it. The group presents
+     *  it once every player of the group has staged the same frame, see HPVPlayerGroup::update().
+     */
+    int HPVPlayer::stageCurrentFrame()
+    {
+        int slot_idx = findSlot(_curr_frame);
+        
+        if (slot_idx < 0 || missingTiles(slot_idx))
+        {
+            slot_idx = (slot_idx < 0) ? findFreeSlot() : writableSlot(slot_idx);
+            
+            // every slot is on screen or staged, the group is behind
+            if (slot_idx < 0 || !fillSlot(slot_idx, _curr_frame))
+            {
+                return HPV_RET_ERROR;
+            }
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(_slot_mtx);
+            
+            for (int i = HPV_NUM_STAGED_FRAMES - 1; i > 0; --i)
+            {
+                _staged[i] = _staged[i - 1];
+            }
+            
+            _staged[0].frame = _curr_frame;
+            _staged[0].slot = slot_idx;
+        }
+        
+        _curr_buffered_frame = _curr_frame.load();
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    bool HPVPlayer::isStaged(int slot_idx)
+    {
+        if (!_grouped.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        
+        std::lock_guard<std::mutex> lock(_slot_mtx);
+        
+        for (const HPVStagedFrame& staged : _staged)
+        {
+            if (staged.slot == slot_idx)
+            {
+                return true;
+            }
+        }
+        
+        return false;
+    }
+    
+    void HPVPlayer::clearStaged()
+    {
+        std::lock_guard<std::mutex> lock(_slot_mtx);
+        
+        for (HPVStagedFrame& staged : _staged)
+        {
+            staged.frame = -1;
+            staged.slot = -1;
+        }
+    }
+    
+    /*
+     *  Slot of a staged frame, -1 when 'frame' isn't staged. The caller holds _slot_mtx.
+     */
+    int HPVPlayer::findStaged(int64_t frame)
+    {
+        for (const HPVStagedFrame& staged : _staged)
+        {
+            if (staged.frame == frame && frame >= 0)
+            {
+                return staged.slot;
+            }
+        }
+        
+        return -1;
+    }
+    
+    /*
+     *  Called by the group with _slot_mtx held, on the thread that runs HPVManager::update()
+     */
+    void HPVPlayer::presentSlot(int slot_idx)
+    {
+        if (_presented_slot.load(std::memory_order_relaxed) == slot_idx)
+        {
+            return;
+        }
+        
+        _presented_slot.store(slot_idx);
+        _update_result.store(1, std::memory_order_relaxed);
+        _num_presented_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    int HPVPlayer::findSlot(int64_t frame)
+    {
+        int found = -1;
+        
+        for (std::size_t slot_idx = 0; slot_idx < _frame_ring.size(); ++slot_idx)
+        {
+            if (_frame_ring[slot_idx].frame == frame)
+            {
+                // of a tiled frame that got copied by writableSlot(), the copy with all tiles
+                if (!missingTiles(static_cast<int>(slot_idx)))
+                {
+                    return static_cast<int>(slot_idx);
+                }
+                
+                if (found < 0)
+                {
+                    found = static_cast<int>(slot_idx);
+                }
+            }
+        }
+        
+        return found;
+    }
+    
+    /*
+     *  Returns a slot that may be overwritten: never the one on screen and, when possible,
+     *  one that doesn't hold any of the frames we're about to show.
+     */
+    int HPVPlayer::findFreeSlot()
+    {
+        // acquire: a group presents on another thread, the renderer's reads of the slot it replaced come before
+        int presented = _presented_slot.load(std::memory_order_acquire);
+        int acquired = _acquired_slot.load();
+        int fallback = -1;
+        
+        // single slot ring: no look-ahead, we always overwrite the presented frame, unless the renderer reads it
+        if (_frame_ring.size() == 1)
+        {
+            return (0 == acquired) ? -1 : 0;
+        }
+        
+        for (std::size_t slot_idx = 0; slot_idx < _frame_ring.size(); ++slot_idx)
+        {
+            // staged frames of a grouped player may be presented any moment
+            if (static_cast<int>(slot_idx) == presented || static_cast<int>(slot_idx) == acquired || isStaged(static_cast<int>(slot_idx)))
+            {
+                continue;
+            }
+            
+            int64_t frame = _frame_ring[slot_idx].frame;
+            bool upcoming = false;
+            
+            for (uint32_t step = 1; frame >= 0 && step < _frame_ring.size(); ++step)
+            {
+                if (predictFrame(step) == frame)
+                {
+                    upcoming = true;
+                    break;
+                }
+            }
+            
+            if (!upcoming)
+            {
+                return static_cast<int>(slot_idx);
+            }
+            
+            if (fallback < 0)
+            {
+                fallback = static_cast<int>(slot_idx);
+            }
+        }
+        
+        return fallback;
+    }
+    
+    /*
+     *  'slot_idx' when the stepping thread may write to it, otherwise (on screen, with the renderer or staged)
+     *  a free slot with a copy of it. -1 when there is no free slot.
+     */
+    int HPVPlayer::writableSlot(int slot_idx)
+    {
+        if (slot_idx != _presented_slot.load(std::memory_order_acquire) && slot_idx != _acquired_slot.load() && !isStaged(slot_idx))
+        {
+            return slot_idx;
+        }
+        
+        int copy_idx = findFreeSlot();
+        
+        if (copy_idx < 0)
+        {
+            return -1;
+        }
+        
+        memcpy(_frame_ring[copy_idx].buffer, _frame_ring[slot_idx].buffer, _bytes_per_frame);
+        _frame_ring[copy_idx].frame = _frame_ring[slot_idx].frame;
+        _frame_ring[copy_idx].tiles = _frame_ring[slot_idx].tiles;
+        
+        return copy_idx;
+    }
+    
+    /*
+     *  Returns the frame that will be shown 'steps' frames after the current one, following the
+     *  playback direction and loop mode in the same way as update() does. -1 when playback will have stopped.
+     */
+    int64_t HPVPlayer::predictFrame(uint32_t steps)
+    {
+        int64_t frame = _curr_frame;
+        int direction = _direction;
+        
+        for (uint32_t step = 0; step < steps; ++step)
+        {
+            if (HPV_DIRECTION_FORWARDS == direction)
+            {
+                if (++frame > _loop_out)
+                {
+                    if (HPV_LOOPMODE_LOOP == _loop_mode)
+                    {
+                        frame = _loop_in;
+                    }
+                    else if (HPV_LOOPMODE_PALINDROME == _loop_mode)
+                    {
+                        frame = _loop_out;
+                        direction = HPV_DIRECTION_REVERSE;
+                    }
+                    else
+                    {
+                        return -1;
+                    }
+                }
+            }
+            else
+            {
+                if (--frame < _loop_in)
+                {
+                    if (HPV_LOOPMODE_LOOP == _loop_mode)
+                    {
+                        frame = _loop_out;
+                    }
+                    else if (HPV_LOOPMODE_PALINDROME == _loop_mode)
+                    {
+                        frame = _loop_in;
+                        direction = HPV_DIRECTION_FORWARDS;
+                    }
+                    else
+                    {
+                        return -1;
+                    }
+                }
+            }
+        }
+        
+        return frame;
+    }
+    
+    /*
+     *  Decodes the first upcoming frame that isn't in the ring yet, or that misses tiles that came into view.
+     *  Returns false when the ring already holds everything we can look ahead to.
+     */
+    bool HPVPlayer::prefetchNextFrame()
+    {
+        // tiled frames are read tile by tile, not in one batch
+        if (_reader->isAsync() && _num_tiles <= 1)
+        {
+            return prefetchBatch();
+        }
+        
+        for (uint32_t step = 1; step < _frame_ring.size(); ++step)
+        {
+            int64_t frame = predictFrame(step);
+            
+            if (frame < 0)
+            {
+                return false;
+            }
+            
+            int slot_idx = findSlot(frame);
+            
+            if (slot_idx >= 0 && !missingTiles(slot_idx))
+            {
+                continue;
+            }
+            
+            if (slot_idx < 0)
+            {
+                slot_idx = findFreeSlot();
+                
+                if (slot_idx < 0 || slot_idx == _presented_slot.load(std::memory_order_acquire))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                slot_idx = writableSlot(slot_idx);
+            }
+            
+            if (slot_idx < 0 || !fillSlot(slot_idx, frame))
+            {
+                return false;
+            }
+            
+            return true;
+        }
+        
+        return false;
+    }
+    
+    /*
+     *  Async variant of prefetchNextFrame(): the reads for all missing upcoming frames are submitted
+     *  at once, every frame is decompressed as soon as its read has completed.
+     */
+    bool HPVPlayer::prefetchBatch()
+    {
+        HPVReadRequest requests[HPV_MAX_FRAME_RING_SIZE];
+        HPVFrameIndexEntry entries[HPV_MAX_FRAME_RING_SIZE];
+        int slots[HPV_MAX_FRAME_RING_SIZE];
+        int64_t frames[HPV_MAX_FRAME_RING_SIZE];
+        std::size_t num_requests = 0;
+        std::size_t max_size = 0;
+        
+        for (uint32_t step = 1; step < _frame_ring.size(); ++step)
+        {
+            int64_t frame = predictFrame(step);
+            
+            if (frame < 0)
+            {
+                break;
+            }
+            
+            if (findSlot(frame) >= 0)
+            {
+                continue;
+            }
+            
+            int slot_idx = findFreeSlot();
+            
+            if (slot_idx < 0 || slot_idx == _presented_slot.load(std::memory_order_acquire))
+            {
+                break;
+            }
+            
+            entries[num_requests] = _index.entry(frame);
+            
+            if (0 == entries[num_requests].size)
+            {
+                break;
+            }
+            
+            // claim the slot right away, so it counts as upcoming for the next findFreeSlot()
+            _frame_ring[slot_idx].frame = frame;
+            
+            slots[num_requests] = slot_idx;
+            frames[num_requests] = frame;
+            max_size = std::max<std::size_t>(max_size, entries[num_requests].size);
+            ++num_requests;
+        }
+        
+        if (0 == num_requests)
+        {
+            return false;
+        }
+        
+        // grows the arena at most once for the whole batch
+        if (!getScratchBuffer(max_size))
+        {
+            for (std::size_t i = 0; i < num_requests; ++i)
+            {
+                _frame_ring[slots[i]].frame = -1;
+            }
+            
+            return false;
+        }
+        
+        for (std::size_t i = 0; i < num_requests; ++i)
+        {
+            requests[i].offset = entries[i].offset;
+            requests[i].size = entries[i].size;
+            requests[i].dst = getScratchBuffer(requests[i].size, static_cast<uint32_t>(i));
+        }
+        
+        uint64_t before_read = _gather_stats ? ns() : 0;
+        
+        if (!_reader->submit(requests, num_requests))
+        {
+            // reads that made it to the kernel still write into 'requests' and the scratch buffer
+            for (std::size_t i = 0; i < num_requests; ++i)
+            {
+                _reader->wait(&requests[i]);
+                _frame_ring[slots[i]].frame = -1;
+            }
+            
+            return false;
+        }
+        
+        bool decoded = false;
+        
+        for (std::size_t i = 0; i < num_requests; ++i)
+        {
+            if (!_reader->wait(&requests[i]))
+            {
+                _frame_ring[slots[i]].frame = -1;
+                continue;
+            }
+            
+            _num_bytes_read.fetch_add(requests[i].size, std::memory_order_relaxed);
+            
+            // the reads of a batch overlap, a frame's read time is how long we waited for it since the submit
+            uint64_t read_time = _gather_stats ? ns() - before_read : 0;
+            
+            if (!decompressFrame(requests[i].dst, static_cast<uint32_t>(requests[i].size), frames[i], _frame_ring[slots[i]].buffer, read_time))
+            {
+                _frame_ring[slots[i]].frame = -1;
                 continue;
             }
-            else
+            
+            decoded = true;
+        }
+        
+        return decoded;
+    }
+    
+    /*
+     *  Tells the reader about the current playback direction, so it can adapt its read-ahead
+     */
+    void HPVPlayer::adviseReader()
+    {
+        if (_advised_direction != _direction)
+        {
+            _advised_direction = _direction;
+            _reader->adviseDirection(_advised_direction);
+        }
+    }
+    
+    /*
+     *  Asks the reader to start fetching the frames that follow the ring. They come from predictFrame(), so
+     *  the window runs in the direction of playback and past the loop points: reverse playback doesn't depend
+     *  on kernel read-ahead, and the frames after a loop or palindrome turnaround are on their way before it.
+     *  Normally only the frame that just came into the window is new; after a seek or a change of direction
+     *  or loop points the whole window is.
+     */
+    void HPVPlayer::readAhead()
+    {
+        // tiles are read when they come into view, not whole frames
+        if (_num_tiles > 1)
+        {
+            return;
+        }
+        
+        uint32_t first = static_cast<uint32_t>(_frame_ring.size());
+        uint32_t last = first + _read_ahead_frames - 1;
+        bool slid = (_read_ahead_end >= 0 && predictFrame(last - 1) == _read_ahead_end);
+        
+        for (uint32_t step = slid ? last : first; step <= last; ++step)
+        {
+            int64_t frame = predictFrame(step);
+            
+            if (frame < 0)
+            {
+                break;
+            }
+            
+            HPVFrameIndexEntry entry = _index.entry(frame);
+            _reader->willNeed(entry.offset, entry.size);
+        }
+        
+        _read_ahead_end = predictFrame(last);
+    }
+    
+    void HPVPlayer::launchUpdateThread()
+    {
+        // start stepping now that everything is set for this player
+        _should_update = true;
+        
+        if (HPVThreadingModel::HPV_THREADS_POOL == _threading_model)
+        {
+            ManagerSingleton()->getDecodePool()->addPlayer(this);
+        }
+        else
+        {
+            _update_thread = std::thread(&HPVPlayer::update, this);
+        }
+    }
+    
+    int HPVPlayer::play()
+    {
+        if (!_reader || !_reader->isOpen())
+        {
+            HPV_VERBOSE("Trying to play, but the file stream is not opened. Did you call init()?");
+            return HPV_RET_ERROR;
+        }
+        
+        if (isPlaying())
+        {
+            HPV_VERBOSE("Already playing");
+            return HPV_RET_ERROR;
+        }
+        
+        _new_frame_time = ns() + static_cast<uint64_t>(_local_time_per_frame);
+        
+        // a stopped player was rewound by stop(), through a seek the stepping thread handles first
+        _state = HPV_STATE_PLAYING;
+        _clock_changed.store(true, std::memory_order_release);
+        
+        wake();
+        
+        notifyHPVEvent(HPVEventType::HPV_EVENT_PLAY);
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    int HPVPlayer::play(int fps)
+    {
+        _global_time_per_frame = 1e9 / fps;
+        _local_time_per_frame = _global_time_per_frame;
+        
+        return this->play();
+    }
+    
+    int HPVPlayer::pause()
+    {
+        if (!isPlaying())
+        {
+            HPV_VERBOSE("Calling pause() on a video that's not playing");
+            return HPV_RET_ERROR;
+        }
+        
+        if (isPaused())
+        {
+            HPV_VERBOSE("Calling pause() on a video that's already paused");
+            return HPV_RET_ERROR;
+        }
+        
+        _state = HPV_STATE_PAUSED;
+        
+        notifyHPVEvent(HPVEventType::HPV_EVENT_PAUSE);
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    int HPVPlayer::resume()
+    {
+        if (!isPaused())
+        {
+            HPV_VERBOSE("Calling resume() on a video that's not paused");
+            return HPV_RET_ERROR;
+        }
+        
+        _new_frame_time = ns() + static_cast<uint64_t>(_local_time_per_frame);
+        
+        _state = HPV_STATE_PLAYING;
+        _clock_changed.store(true, std::memory_order_release);
+        
+        wake();
+        
+        notifyHPVEvent(HPVEventType::HPV_EVENT_RESUME);
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    int HPVPlayer::stop()
+    {
+        if (!isPlaying() && !isPaused())
+        {
+            HPV_ERROR("Cannot stop because we're not playing or paused");
+            return HPV_RET_ERROR;
+        }
+        
+        _state = HPV_STATE_STOPPED;
+        
+        // rewound by the stepping thread, which is the only one moving _curr_frame
+        requestSeek(_loop_in, nullptr);
+                
+        notifyHPVEvent(HPVEventType::HPV_EVENT_STOP);
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    int HPVPlayer::setLoopMode(uint8_t loop_mode)
+    {
+        _loop_mode = loop_mode;
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    int HPVPlayer::setLoopInPoint(int64_t loop_in)
+    {
+        if (loop_in >= 0 && loop_in < _header.number_of_frames)
+        {
+            _loop_in = loop_in;
+            
+            if (_curr_frame < loop_in)
+            {
+                requestSeek(loop_in, nullptr);
+            }
+        }
+        else
+        {
+            _loop_in = 0;
+        }
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    int HPVPlayer::setLoopOutPoint(int64_t loop_out)
+    {
+        if (loop_out > _loop_in && loop_out < _header.number_of_frames)
+        {
+            _loop_out = loop_out;
+            
+            if (_curr_frame > loop_out)
+            {
+                requestSeek(_loop_in, nullptr);
+            }
+        }
+        else
+        {
+            _loop_out = _header.number_of_frames-1;
+        }
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    /*
+     *  Threaded function of the HPV_THREADS_PER_PLAYER model: steps the player until it is closed.
+     *  In between steps the thread blocks until the next step is due or until wake() is called,
+     *  an idle player doesn't use any CPU time.
+     */
+    void HPVPlayer::update()
+    {
+        while (_should_update)
+        {
+            uint64_t next_step = step();
+            
+            std::unique_lock<std::mutex> lock(_wake_mtx);
+            
+            if (HPV_STEP_WHEN_WOKEN == next_step)
+            {
+                _wake_signal.wait(lock, [this]{ return _wake_requested; });
+            }
+            else
+            {
+                uint64_t now = ns();
+                
+                if (next_step > now)
+                {
+                    _wake_signal.wait_for(lock, std::chrono::nanoseconds(next_step - now), [this]{ return _wake_requested; });
+                }
+            }
+            
+            _wake_requested = false;
+        }
+    }
+    
+    /*
+     *  Runs one step of the player and adds the CPU time it took to getCPUTime()
+     */
+    uint64_t HPVPlayer::step()
+    {
+        if (!_gather_stats)
+        {
+            return runStep();
+        }
+        
+        uint64_t cpu_before = thread_cpu_ns();
+        uint64_t next_step = runStep();
+        
+        _cpu_time.fetch_add(thread_cpu_ns() - cpu_before, std::memory_order_relaxed);
+        
+        return next_step;
+    }
+    
+    /*
+     *  Does one piece of work: handles a pending seek, advances to the next frame when it is due
+     *  or decodes an upcoming frame ahead of time. Called by the player's own update thread or by
+     *  the HPVDecodePool, never by two threads at once.
+     *
+     *  Returns the time (ns()) at which the player wants to be stepped again, HPV_STEP_WHEN_WOKEN when it has
+     *  nothing to do until the next wake().
+     *  The result of reading a frame is stored in std::atomic<int> updateResult. This way, the main thread
+     *  can query when a new frame is ready.
+     *  updateResult > 0    -> new frame is ready
+     *  updateResult = 0    -> not yet there, still iterating
+     *
+     */
+    uint64_t HPVPlayer::runStep()
+    {
+        uint64_t now;
+        
+        if (_was_seeked.load(std::memory_order_acquire))
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            
+            HPVSeekTicket ticket = _pending_seek;
+            HPVSeekCallback callback;
+            callback.swap(_seek_callback);
+            
+            _curr_frame = _seeked_frame;
+            _pending_seek = 0;
+            _was_seeked.store(false, std::memory_order_relaxed);
+            
+            // seeks that come in while this one decodes replace it, see seekAbandoned()
+            lock.unlock();
+            
+            /* Read the frame from the file */
+            _seeking = true;
+            int ret = readCurrentFrame();
+            _seeking = false;
+            
+            HPVSeekResult result = HPVSeekResult::HPV_SEEK_DONE;
+            
+            if (!ret)
+            {
+                result = _was_seeked.load(std::memory_order_acquire) ? HPVSeekResult::HPV_SEEK_DROPPED : HPVSeekResult::HPV_SEEK_FAILED;
+            }
+            
+            if (HPVSeekResult::HPV_SEEK_DROPPED == result)
+            {
+                _num_dropped_seeks.fetch_add(1, std::memory_order_relaxed);
+            }
+            
+            lock.lock();
+            _seek_result.store(ret ? 1 : -1, std::memory_order_relaxed);
+            _seek_result_ticket = ticket;
+            
+            // a newer seek may have been dropped meanwhile, finished tickets only ever go up
+            if (ticket > _finished_seek.load(std::memory_order_relaxed))
+            {
+                _finished_seek.store(ticket, std::memory_order_release);
+            }
+            lock.unlock();
+            
+            _seeked_signal.notify_all();
+            
+            if (callback)
+            {
+                callback(ticket, _curr_frame, result);
+            }
+            
+            now = ns();
+            
+            // only after the seek returned, copying into a new cache entry can take longer than the decode
+            cachePresentedFrame();
+            
+            return now;
+        }
+        
+        /* When not playing, paused or stopped: nothing to do until play(), resume() or seek() wakes us up */
+        if (!isPlaying() || isPaused() || isStopped())
+        {
+            // except for showing tiles that came into view, see setVisibleTiles()
+            if (missingTiles(_presented_slot.load(std::memory_order_relaxed)) && readCurrentFrame())
+            {
+                return ns();
+            }
+            
+            return HPV_STEP_WHEN_WOKEN;
+        }
+        
+        /* When playing: get delta time and check if we need to load next frame. */
+        now = ns();
+        
+        adviseReader();
+        
+        if (_clock_changed.exchange(false, std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(_clock_mtx);
+            
+            _step_clock = _clock;
+            _clock_locked = false;
+            
+            // find out where the clock is right away, free-running playback starts its schedule over
+            _scheduler.start(now, _local_time_per_frame);
+            _speed_changed.store(false, std::memory_order_relaxed);
+            _new_frame_time = now;
+        }
+        else if (_speed_changed.exchange(false, std::memory_order_acquire) && !_step_clock)
+        {
+            _scheduler.setTimePerFrame(now, _local_time_per_frame);
+            
+            if (_scheduler.getPresentedTick() >= 0)
+            {
+                _new_frame_time = _scheduler.getTickTime(_scheduler.getPresentedTick() + 1);
+            }
+        }
+        
+        if (!(now >= _new_frame_time))
+        {
+            //HPV_VERBOSE("%" PRIu64 " - %" PRIu64, now, _new_frame_time);
+            
+            // use the time left to decode upcoming frames, once the ring is full wait for the deadline
+            if (prefetchNextFrame())
+            {
+                return now;
+            }
+            
+            return _new_frame_time;
+        }
+        // the clock decides which frame is shown
+        else if (_step_clock)
+        {
+            return followClock(now);
+        }
+        
+        int64_t tick = _scheduler.getPresentedTick() + 1;
+        int64_t due_tick = _scheduler.getDueTick(now);
+        uint64_t due_time = _scheduler.getTickTime(tick);
+        HPVLatenessPolicy policy = _lateness_policy.load(std::memory_order_relaxed);
+        
+        // behind: go straight to the frame that is due now instead of showing each one late
+        int64_t num_skipped = (HPVLatenessPolicy::HPV_LATENESS_DECODE_ALL != policy && due_tick > tick) ? due_tick - tick : 0;
+        
+        for (int64_t i = 0; i < num_skipped; ++i)
+        {
+            if (!stepFrame())
+            {
+                return now;
+            }
+            
+            if (HPVLatenessPolicy::HPV_LATENESS_SKIP_KEEP_WARM == policy)
+            {
+                keepWarm(_curr_frame);
+            }
+        }
+        
+        if (!stepFrame())
+        {
+            return now;
+        }
+        
+        if (num_skipped > 0)
+        {
+            tick = due_tick;
+            due_time = _scheduler.getTickTime(tick);
+            _num_skipped_frames.fetch_add(num_skipped, std::memory_order_relaxed);
+        }
+        
+        /* Present the frame, decoded ahead of time when the ring was able to keep up */
+        readCurrentFrame();
+        readAhead();
+        
+        uint64_t presented_time = ns();
+        
+        if (_gather_stats)
+        {
+            _latency_stats.lateness.record(presented_time - due_time);
+        }
+        
+        /* Set future time when new frame is needed, counted from the start of playback so it doesn't drift */
+        _new_frame_time = _scheduler.present(tick, presented_time);
+        
+        cachePresentedFrame();
+        
+        return now;
+    }
+    
+    /*
+     *  Moves _curr_frame one frame in the direction of playback, through the loop points. False when playback
+     *  stopped at the end of the file.
+     */
+    bool HPVPlayer::stepFrame()
+    {
+        // next actions depening on playback direction: forwards / backwards
+        if (HPV_DIRECTION_FORWARDS == _direction)
+        {
+            ++_curr_frame;
+            
+            if (_curr_frame > _loop_out)
             {
-                /* When not playing, paused or stopped: sleep a bit an re-check condition */
-                if (!isPlaying() || isPaused() || isStopped())
+                notifyHPVEvent(HPVEventType::HPV_EVENT_LOOP);
+                if (HPV_LOOPMODE_NONE == _loop_mode)
                 {
-                    std::this_thread::sleep_for(std::chrono::nanoseconds(100));
-
-                    continue;
+                    // in range until the rewind of stop() is handled
+                    _curr_frame = _loop_out.load();
+                    stop();
+                    return false;
                 }
-                
-                /* When playing: get delta time and check if we need to load next frame. */
-                now = ns();
-                
-                if (!(now >= _new_frame_time))
+                else if (HPV_LOOPMODE_LOOP == _loop_mode)
                 {
-                    //HPV_VERBOSE("%" PRIu64 " - %" PRIu64, now, _new_frame_time);
-                    continue;
+                    _curr_frame = _loop_in.load();
+                    
                 }
-                // next actions depening on playback direction: forwards / backwards
-                else if (HPV_DIRECTION_FORWARDS == _direction)
+                else if (HPV_LOOPMODE_PALINDROME == _loop_mode)
                 {
-                    ++_curr_frame;
-                    
-                    if (_curr_frame > _loop_out)
-                    {
-                        notifyHPVEvent(HPVEventType::HPV_EVENT_LOOP);
-                        if (HPV_LOOPMODE_NONE == _loop_mode)
-                        {
-                            stop();
-                            continue;
-                        }
-                        else if (HPV_LOOPMODE_LOOP == _loop_mode)
-                        {
-                            _curr_frame = _loop_in;
-                            
-                        }
-                        else if (HPV_LOOPMODE_PALINDROME == _loop_mode)
-                        {
-                            _curr_frame = _loop_out;
-                            _direction = HPV_DIRECTION_REVERSE;
-                        }
-                        else
-                        {
-                            HPV_ERROR("Unhandled play mode.");
-                            continue;
-                        }
-                    }
+                    _curr_frame = _loop_out.load();
+                    _direction = HPV_DIRECTION_REVERSE;
                 }
                 else
                 {
-                    --_curr_frame;
-                    
-                    if (_curr_frame < _loop_in)
-                    {
-                        notifyHPVEvent(HPVEventType::HPV_EVENT_LOOP);
-                        if (HPV_LOOPMODE_NONE == _loop_mode)
-                        {
-                            stop();
-                            continue;
-                        }
-                        else if (HPV_LOOPMODE_LOOP == _loop_mode)
-                        {
-                            _curr_frame = _loop_out;
-                        }
-                        else if (HPV_LOOPMODE_PALINDROME == _loop_mode)
-                        {
-                            _curr_frame = _loop_in;
-                            _direction = HPV_DIRECTION_FORWARDS;
-                        }
-                        else
-                        {
-                            HPV_ERROR("Unhandled play mode.");
-                            continue;
-                        }
-                    }
+                    HPV_ERROR("Unhandled play mode.");
+                    return false;
                 }
+            }
+        }
+        else
+        {
+            --_curr_frame;
+            
+            if (_curr_frame < _loop_in)
+            {
+                notifyHPVEvent(HPVEventType::HPV_EVENT_LOOP);
+                if (HPV_LOOPMODE_NONE == _loop_mode)
+                {
+                    _curr_frame = _loop_in.load();
+                    stop();
+                    return false;
+                }
+                else if (HPV_LOOPMODE_LOOP == _loop_mode)
+                {
+                    _curr_frame = _loop_out.load();
+                }
+                else if (HPV_LOOPMODE_PALINDROME == _loop_mode)
+                {
+                    _curr_frame = _loop_in.load();
+                    _direction = HPV_DIRECTION_FORWARDS;
+                }
+                else
+                {
+                    HPV_ERROR("Unhandled play mode.");
+                    return false;
+                }
+            }
+        }
+        
+        return true;
+    }
+    
+    /*
+     *  HPV_LATENESS_SKIP_KEEP_WARM: a skipped frame that was decoded already goes to the frame cache, one that
+     *  wasn't is still read ahead, so the reader keeps streaming and going back to it is cheap
+     */
+    void HPVPlayer::keepWarm(int64_t frame)
+    {
+        int slot_idx = findSlot(frame);
+        
+        if (slot_idx >= 0 && !missingTiles(slot_idx))
+        {
+            _frame_cache.put(frame, _frame_ring[slot_idx].buffer);
+        }
+        else if (_num_tiles <= 1)
+        {
+            HPVFrameIndexEntry entry = _index.entry(frame);
+            _reader->willNeed(entry.offset, entry.size);
+        }
+    }
+    
+    /*
+     *  Playback that follows a clock: samples it when the next frame is due and shows the frame for its time.
+     *  The samples go through a predictor (last smoothed time + rate * elapsed) that filters out a position
+     *  that only moves in steps, like that of an audio player, and tells when the following frame is due, so
+     *  the ring decodes ahead exactly as it does for free-running playback. Only when the clock is off from the
+     *  prediction by more than HPV_CLOCK_MAX_ERROR it has jumped (seek, loop, restart) and the prediction starts over.
+     *  Returns the time of the next step.
+     */
+    uint64_t HPVPlayer::followClock(uint64_t now)
+    {
+        double time = _step_clock->getTime();
+        double rate = _step_clock->getRate();
+        bool jumped = true;
+        
+        if (_clock_locked)
+        {
+            double predicted = _clock_time + _clock_rate * (now - _clock_sample_time) / 1e9;
+            double error = time - predicted;
+            
+            if (std::abs(error) <= HPV_CLOCK_MAX_ERROR)
+            {
+                time = predicted + HPV_CLOCK_SMOOTHING * error;
+                jumped = false;
+            }
+        }
+        
+        _clock_locked = true;
+        _clock_time = time;
+        _clock_rate = rate;
+        _clock_sample_time = now;
+        
+        if (rate > 0.0)
+        {
+            _direction = HPV_DIRECTION_FORWARDS;
+        }
+        else if (rate < 0.0)
+        {
+            _direction = HPV_DIRECTION_REVERSE;
+        }
+        
+        double fps = static_cast<double>(_header.frame_rate);
+        int64_t frame = static_cast<int64_t>(std::floor(time * fps));
+        
+        // smoothing never takes a frame back, unless the clock really went back
+        bool behind = !jumped && ((rate >= 0.0) ? (frame < _clock_frame) : (frame > _clock_frame));
+        
+        if (jumped || (!behind && frame != _clock_frame))
+        {
+            uint64_t due_time = _new_frame_time;
+            
+            // the clock ran past frames the player didn't get to show
+            if (!jumped && std::abs(frame - _clock_frame) > 1)
+            {
+                _scheduler.drop(std::abs(frame - _clock_frame) - 1);
+            }
+            
+            _clock_frame = frame;
+            _curr_frame = clockFrame(frame);
+            
+            // after a jump the frame on screen may be the right one already
+            if (_curr_frame != _curr_buffered_frame && _grouped.load(std::memory_order_relaxed))
+            {
+                stageCurrentFrame();
+                readAhead();
+            }
+            else if (_curr_frame != _curr_buffered_frame)
+            {
+                readCurrentFrame();
+                readAhead();
                 
-                /* Set future time when new frame is needed */
-                //_new_frame_time = now + _local_time_per_frame;
-                _new_frame_time += _local_time_per_frame;
-                
-                /* Read the frame from the file */
-                if (!readCurrentFrame())
+                if (_gather_stats && !jumped)
                 {
-                    continue;
+                    _latency_stats.lateness.record(ns() - due_time);
                 }
-                                
-                // sleep thread and wake up in time for next frame, taking in account read time
-                std::this_thread::sleep_for(std::chrono::nanoseconds(_local_time_per_frame-(_decode_stats.hdd_read_time+_decode_stats.l4z_decode_time)-1000000));
+                
+                cachePresentedFrame();
+            }
+        }
+        
+        // sample again when the next frame starts, and at least once per frame of the file for stops and jumps
+        uint64_t frame_time = static_cast<uint64_t>(1e9 / fps);
+        uint64_t wait = frame_time;
+        
+        if (std::abs(rate) > 1e-6)
+        {
+            double boundary = static_cast<double>((rate > 0.0) ? (_clock_frame + 1) : _clock_frame) / fps;
+            double seconds = (boundary - _clock_time) / rate;
+            
+            if (seconds >= 0.0 && seconds * 1e9 < frame_time)
+            {
+                // just past the boundary, not on it
+                wait = static_cast<uint64_t>(seconds * 1e9) + 1000;
+            }
+        }
+        
+        _new_frame_time = now + wait;
+        
+        return now;
+    }
+    
+    /*
+     *  Frame of the file for a frame number of the clock: looped into the file in loop mode, held at its ends
+     *  otherwise, and kept inside the loop points
+     */
+    int64_t HPVPlayer::clockFrame(int64_t frame)
+    {
+        int64_t num_frames = static_cast<int64_t>(_header.number_of_frames);
+        
+        if (HPV_LOOPMODE_LOOP == _loop_mode)
+        {
+            frame = ((frame % num_frames) + num_frames) % num_frames;
+        }
+        
+        return clamp<int64_t>(frame, _loop_in, _loop_out);
+    }
+    
+    /*
+     *  Lets the thread that steps this player know there is work right now, instead of
+     *  waiting out the idle interval.
+     */
+    void HPVPlayer::wake()
+    {
+        if (HPVThreadingModel::HPV_THREADS_POOL == _threading_model)
+        {
+            ManagerSingleton()->getDecodePool()->wake(this);
+        }
+        else
+        {
+            {
+                std::lock_guard<std::mutex> lock(_wake_mtx);
+                _wake_requested = true;
             }
+            _wake_signal.notify_one();
         }
     }
     
@@ -661,17 +2156,111 @@ namespace HPV {
         // bwd
         else if (speed < -HPV_SPEED_EPSILON)
         {
-            _direction = HPV_DIRECTION_REVERSE;
+            _direction = HPV_DIRECTION_REVERSE;
+        }
+        
+        // the frame duration of course changes when the speed changes
+        _local_time_per_frame = _global_time_per_frame / std::abs(speed);
+        _speed_changed.store(true, std::memory_order_release);
+        
+        // start decoding ahead in the new direction right away
+        wake();
+        
+        // resume if we were paused earlier (speed +/- 0)
+        if (isPaused())
+        {
+            resume();
+        }
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    int HPVPlayer::setFrameRingSize(uint8_t num_slots)
+    {
+        if (_is_init)
+        {
+            HPV_ERROR("The frame ring size can only be changed before opening a file");
+            return HPV_RET_ERROR;
+        }
+        
+        _frame_ring_size = clamp<uint8_t>(num_slots, 1, HPV_MAX_FRAME_RING_SIZE);
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    /*
+     *  Keeps the most recently shown frames, up to 'num_bytes' of decompressed DXT data, so seeking back to
+     *  them skips reading and decompressing. Can be changed at any time, 0 (the default) turns the cache off.
+     *  The whole budget is allocated here or at open(), so filling the cache doesn't allocate; changing it
+     *  drops the cached frames. Has no effect on tiled files.
+     */
+    int HPVPlayer::setFrameCacheSize(std::size_t num_bytes)
+    {
+        _frame_cache.setBudget(num_bytes);
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    /*
+     *  Tiled files: from now on only the given set of tiles (see HPVTiles.h) is read and decoded. With
+     *  'prefetch_neighbours' the tiles around them are decoded as well, so they are ready when the view turns.
+     */
+    int HPVPlayer::setVisibleTiles(uint64_t tiles, bool prefetch_neighbours)
+    {
+        if (_num_tiles <= 1)
+        {
+            HPV_VERBOSE("Setting visible tiles on a file that isn't tiled");
+            return HPV_RET_ERROR;
+        }
+        
+        tiles &= AllTiles(_tile_columns, _tile_rows);
+        
+        uint64_t decode_tiles = tiles;
+        
+        if (prefetch_neighbours)
+        {
+            decode_tiles |= NeighbourTiles(tiles, _tile_columns, _tile_rows);
+        }
+        
+        _visible_tiles.store(tiles, std::memory_order_relaxed);
+        
+        // decode tiles that came into view right away, also when paused
+        if (_decode_tiles.exchange(decode_tiles, std::memory_order_acq_rel) != decode_tiles)
+        {
+            wake();
+        }
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    /*
+     *  While playing, the frame on screen is the one at the time of 'clock' instead of the next one every
+     *  1 / fps seconds: speed and direction come from the clock, the loop points only limit the frames shown.
+     *  The clock is followed by the player's own thread, see followClock(), nothing has to be seeked from the
+     *  main thread. Can be changed at any time, nullptr goes back to the frame rate of the file.
+     */
+    int HPVPlayer::setClock(HPVClockRef clock)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_clock_mtx);
+            _clock = clock;
         }
         
-        // the frame duration of course changes when the speed changes
-        _local_time_per_frame = static_cast<uint64_t>(_global_time_per_frame / std::abs(speed));
+        _clock_changed.store(true, std::memory_order_release);
         
-        // resume if we were paused earlier (speed +/- 0)
-        if (isPaused())
-        {
-            resume();
-        }
+        wake();
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    /*
+     *  What free-running playback does once it is more than a frame behind its schedule (a disk stall, a busy
+     *  CPU): show every frame anyway and run late until it has caught up, which it may never do when decoding
+     *  is as slow as the frame rate, or jump to the frame that is due. Playback that follows a clock always jumps.
+     */
+    int HPVPlayer::setLatenessPolicy(HPVLatenessPolicy policy)
+    {
+        _lateness_policy.store(policy, std::memory_order_relaxed);
         
         return HPV_RET_ERROR_NONE;
     }
@@ -687,6 +2276,8 @@ namespace HPV {
             _direction = HPV_DIRECTION_REVERSE;
         }
         
+        wake();
+        
         return HPV_RET_ERROR_NONE;
     }
     
@@ -695,28 +2286,17 @@ namespace HPV {
         if (pos < 0.0 || pos > 1.0)
             return HPV_RET_ERROR;
         
-        if (HPV::isNearlyEqual(pos, 0.0))
-        {
-            _seeked_frame = 0;
-        }
-        else if (HPV::isNearlyEqual(pos, 1.0))
-        {
-            _seeked_frame = _header.number_of_frames-1;
-        }
-        else
-        {
-            _seeked_frame = clamp<int64_t>(static_cast<int64_t>(std::floor( (_header.number_of_frames-1) * pos)), _loop_in, _loop_out);
-        }
+        int64_t frame = seekFrame(pos);
         
-        if (_seeked_frame == _curr_frame)
+        if (frame == _curr_frame && !_was_seeked.load(std::memory_order_acquire))
         {
             return HPV_RET_ERROR;
         }
-    
-        _was_seeked.store(true, std::memory_order_relaxed);
-
+        
+        HPVSeekTicket ticket = requestSeek(frame, nullptr);
+        
         if (sync)
-            return this->seekSync();
+            return this->seekSync(ticket);
         
         return HPV_RET_ERROR_NONE;
     }
@@ -726,29 +2306,120 @@ namespace HPV {
         if (frame < 0 || frame >= _header.number_of_frames)
             return HPV_RET_ERROR;
         
-        _seeked_frame = clamp<int64_t>(frame, _loop_in, _loop_out);
+        frame = clamp<int64_t>(frame, _loop_in, _loop_out);
         
-        if (_seeked_frame == _curr_frame)
+        if (frame == _curr_frame && !_was_seeked.load(std::memory_order_acquire))
         {
             return HPV_RET_ERROR;
         }
         
-        _was_seeked.store(true, std::memory_order_relaxed);
-
+        HPVSeekTicket ticket = requestSeek(frame, nullptr);
+        
         if (sync)
-            return this->seekSync();
+            return this->seekSync(ticket);
         
         return HPV_RET_ERROR_NONE;
     }
     
-    int HPVPlayer::seekSync()
+    /*
+     *  Non-blocking seek: returns a ticket right away and calls 'callback' once the frame is presented, or
+     *  when it never will be. Only the latest seek is decoded: one that is still waiting is dropped when a
+     *  newer one comes in, and one that is being read is abandoned before its decompress. Scrubbing faster
+     *  than frames can be decoded therefore shows the newest position as soon as it can, instead of working
+     *  through a backlog. Returns 0 when 'pos' is out of range.
+     */
+    HPVSeekTicket HPVPlayer::seekAsync(double pos, HPVSeekCallback callback)
+    {
+        if (pos < 0.0 || pos > 1.0)
+            return 0;
+        
+        return requestSeek(seekFrame(pos), std::move(callback));
+    }
+    
+    HPVSeekTicket HPVPlayer::seekAsync(int64_t frame, HPVSeekCallback callback)
     {
-        _seek_result.store(0, std::memory_order_relaxed);
+        if (frame < 0 || frame >= _header.number_of_frames)
+            return 0;
+        
+        return requestSeek(clamp<int64_t>(frame, _loop_in, _loop_out), std::move(callback));
+    }
+    
+    /*
+     *  True once the seek of 'ticket' is over: presented, dropped or failed
+     */
+    bool HPVPlayer::isSeekDone(HPVSeekTicket ticket)
+    {
+        return ticket <= _finished_seek.load(std::memory_order_acquire);
+    }
+    
+    int64_t HPVPlayer::seekFrame(double pos)
+    {
+        if (HPV::isNearlyEqual(pos, 0.0))
+        {
+            return 0;
+        }
+        else if (HPV::isNearlyEqual(pos, 1.0))
+        {
+            return _header.number_of_frames-1;
+        }
+        
+        return clamp<int64_t>(static_cast<int64_t>(std::floor( (_header.number_of_frames-1) * pos)), _loop_in, _loop_out);
+    }
+    
+    /*
+     *  Makes 'frame' the one seek for the stepping thread to handle, replacing the seek that was still waiting
+     */
+    HPVSeekTicket HPVPlayer::requestSeek(int64_t frame, HPVSeekCallback callback)
+    {
+        HPVSeekTicket ticket;
+        HPVSeekTicket dropped_ticket = 0;
+        int64_t dropped_frame = 0;
+        HPVSeekCallback dropped_callback;
+        
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            
+            if (_pending_seek)
+            {
+                dropped_ticket = _pending_seek;
+                dropped_frame = _seeked_frame;
+                dropped_callback.swap(_seek_callback);
+                
+                if (dropped_ticket > _finished_seek.load(std::memory_order_relaxed))
+                {
+                    _finished_seek.store(dropped_ticket, std::memory_order_release);
+                }
+                _num_dropped_seeks.fetch_add(1, std::memory_order_relaxed);
+            }
+            
+            ticket = ++_last_seek_ticket;
+            _pending_seek = ticket;
+            _seeked_frame = frame;
+            // moved, not copied: copying a callback with a large capture would allocate
+            _seek_callback = std::move(callback);
+            _was_seeked.store(true, std::memory_order_release);
+        }
+        
+        if (dropped_callback)
+        {
+            dropped_callback(dropped_ticket, dropped_frame, HPVSeekResult::HPV_SEEK_DROPPED);
+        }
         
+        wake();
+        
+        return ticket;
+    }
+    
+    /*
+     *  Waits up to 100 ms for the seek of 'ticket' to be presented
+     */
+    int HPVPlayer::seekSync(HPVSeekTicket ticket)
+    {
         std::unique_lock<std::mutex> lock(_mtx);
-        _seeked_signal.wait_for(lock, std::chrono::milliseconds(100), [this]{ return (_seek_result.load() != 0); });
+        _seeked_signal.wait_for(lock, std::chrono::milliseconds(100), [this, ticket]{ return isSeekDone(ticket); });
         
-        if (_seek_result.load() < 0)
+        // overtaken by a newer seek, or the frame couldn't be read
+        if (isSeekDone(ticket) && (_seek_result_ticket != ticket || _seek_result.load() < 0))
         {
             return HPV_RET_ERROR;
         }
@@ -756,6 +2427,14 @@ namespace HPV {
         return HPV_RET_ERROR_NONE;
     }
     
+    /*
+     *  On the stepping thread: true when the seek being decoded has been replaced by a newer one
+     */
+    bool HPVPlayer::seekAbandoned()
+    {
+        return _seeking && _was_seeked.load(std::memory_order_acquire);
+    }
+    
     void HPVPlayer::resetPlayer()
     {
         _local_time_per_frame = _global_time_per_frame;
@@ -808,9 +2487,131 @@ namespace HPV {
         return _bytes_per_frame;
     }
     
+    /*
+     *  The presented frame right now, the stepping thread may reuse it any moment after. Use acquireFrame() to
+     *  read it while the player runs.
+     */
     unsigned char* HPVPlayer::getBufferPtr()
     {
-        return _frame_buffer;
+        if (_frame_ring.empty())
+        {
+            return nullptr;
+        }
+        
+        return _frame_ring[_presented_slot.load(std::memory_order_acquire)].buffer;
+    }
+    
+    /*
+     *  Hands the presented frame to the renderer: until releaseFrame() the stepping thread decodes into other
+     *  slots, so the data can be uploaded or copied while the player moves on, and the frame number belongs to
+     *  that data. The player never waits for the renderer; with the renderer holding a slot that is no longer
+     *  presented, one slot fewer is left for decoding ahead. One renderer per player, a second acquireFrame()
+     *  replaces the first.
+     *
+     *  Lock-free: the slot is announced in _acquired_slot and taken once it is still the presented one after
+     *  that. Both sides use seq_cst, so either findFreeSlot() sees the announcement or the renderer sees the
+     *  slot was replaced and tries the new one.
+     */
+    HPVAcquiredFrame HPVPlayer::acquireFrame()
+    {
+        HPVAcquiredFrame acquired;
+        acquired.buffer = nullptr;
+        acquired.frame = -1;
+        
+        if (_frame_ring.empty())
+        {
+            return acquired;
+        }
+        
+        int slot_idx = _presented_slot.load();
+        
+        while (true)
+        {
+            _acquired_slot.store(slot_idx);
+            
+            int presented = _presented_slot.load();
+            
+            if (presented == slot_idx)
+            {
+                break;
+            }
+            
+            slot_idx = presented;
+        }
+        
+        HPVFrameSlot& slot = _frame_ring[slot_idx];
+        
+        // right after open(), nothing is decoded yet
+        if (slot.frame >= 0)
+        {
+            acquired.buffer = slot.buffer;
+            acquired.frame = slot.frame;
+        }
+        
+        return acquired;
+    }
+    
+    void HPVPlayer::releaseFrame()
+    {
+        _acquired_slot.store(-1, std::memory_order_release);
+    }
+    
+    /*
+     *  Decompresses the presented frame into 'rgba', getWidth() * getHeight() * 4 bytes, for when there's no
+     *  GPU to hand the DXT blocks to. Bands of block rows are spread over the decode pool.
+     */
+    int HPVPlayer::decodePixels(unsigned char* rgba)
+    {
+        if (!rgba)
+        {
+            return HPV_RET_ERROR;
+        }
+        
+        HPVAcquiredFrame acquired = acquireFrame();
+        const unsigned char * dxt = acquired.buffer;
+        
+        if (!dxt)
+        {
+            releaseFrame();
+            return HPV_RET_ERROR;
+        }
+        
+        struct
+        {
+            const unsigned char *   dxt;
+            unsigned char *         rgba;
+            uint32_t                width;
+            uint32_t                height;
+            HPVCompressionType      type;
+            uint32_t                block_rows;
+            uint32_t                num_bands;
+            std::atomic<bool>       failed;
+        } job;
+        
+        job.dxt = dxt;
+        job.rgba = rgba;
+        job.width = _header.video_width;
+        job.height = _header.video_height;
+        job.type = _header.compression_type;
+        job.block_rows = job.height / 4;
+        // a few bands per worker, so a worker that is busy stepping a player doesn't hold up the frame
+        job.num_bands = std::max(1u, std::min(job.block_rows, 4 * getNumParallelThreads()));
+        job.failed.store(false, std::memory_order_relaxed);
+        
+        parallelFor(job.num_bands, [&job](uint32_t band)
+        {
+            uint32_t first = slice_first_block_row(band, job.block_rows, job.num_bands);
+            uint32_t last = slice_first_block_row(band + 1, job.block_rows, job.num_bands);
+            
+            if (!DecompressBlockRowsDXT(job.dxt, job.width, job.height, job.type, first, last - first, job.rgba))
+            {
+                job.failed.store(true, std::memory_order_relaxed);
+            }
+        });
+        
+        releaseFrame();
+        
+        return job.failed.load(std::memory_order_relaxed) ? HPV_RET_ERROR : HPV_RET_ERROR_NONE;
     }
     
     int HPVPlayer::getFrameRate()
@@ -843,6 +2644,11 @@ namespace HPV {
         return _file_path;
     }
     
+    HPVReadMode HPVPlayer::getReadMode()
+    {
+        return _read_mode;
+    }
+    
     int64_t HPVPlayer::getCurrentFrameNumber()
     {
         return _curr_buffered_frame;
@@ -853,6 +2659,128 @@ namespace HPV {
         return _header.number_of_frames;
     }
     
+    uint8_t HPVPlayer::getFrameRingSize()
+    {
+        return _frame_ring_size;
+    }
+    
+    std::size_t HPVPlayer::getFrameCacheSize()
+    {
+        return _frame_cache.getBudget();
+    }
+    
+    std::size_t HPVPlayer::getNumCachedFrames()
+    {
+        return _frame_cache.getNumFrames();
+    }
+    
+    uint64_t HPVPlayer::getNumFrameCacheHits()
+    {
+        return _frame_cache.getNumHits();
+    }
+    
+    uint64_t HPVPlayer::getNumFrameCacheMisses()
+    {
+        return _frame_cache.getNumMisses();
+    }
+    
+    uint64_t HPVPlayer::getNumDecodeAllocations()
+    {
+        return _num_decode_allocations.load(std::memory_order_relaxed);
+    }
+    
+    uint64_t HPVPlayer::getNumDroppedSeeks()
+    {
+        return _num_dropped_seeks.load(std::memory_order_relaxed);
+    }
+    
+    /*
+     *  Frames that came on screen after the next one was already due
+     */
+    uint64_t HPVPlayer::getNumLateFrames()
+    {
+        return _scheduler.getNumLateFrames();
+    }
+    
+    /*
+     *  Frames of the timeline that were never shown
+     */
+    uint64_t HPVPlayer::getNumDroppedFrames()
+    {
+        return _scheduler.getNumDroppedFrames();
+    }
+    
+    /*
+     *  Frame periods in which no new frame came in, so the previous one stayed on screen
+     */
+    uint64_t HPVPlayer::getNumRepeatedFrames()
+    {
+        return _scheduler.getNumRepeatedFrames();
+    }
+    
+    /*
+     *  Frames passed over by HPV_LATENESS_SKIP(_KEEP_WARM), they count as dropped frames too
+     */
+    uint64_t HPVPlayer::getNumSkippedFrames()
+    {
+        return _num_skipped_frames.load(std::memory_order_relaxed);
+    }
+    
+    uint64_t HPVPlayer::getNumPresentedFrames()
+    {
+        return _num_presented_frames.load(std::memory_order_relaxed);
+    }
+    
+    uint64_t HPVPlayer::getCPUTime()
+    {
+        return _cpu_time.load(std::memory_order_relaxed);
+    }
+    
+    /*
+     *  Compressed frame data read from the file since open()
+     */
+    uint64_t HPVPlayer::getNumBytesRead()
+    {
+        return _num_bytes_read.load(std::memory_order_relaxed);
+    }
+    
+    bool HPVPlayer::isTiled()
+    {
+        return _num_tiles > 1;
+    }
+    
+    uint32_t HPVPlayer::getTileColumns()
+    {
+        return _tile_columns;
+    }
+    
+    uint32_t HPVPlayer::getTileRows()
+    {
+        return _tile_rows;
+    }
+    
+    uint64_t HPVPlayer::getVisibleTiles()
+    {
+        return _visible_tiles.load(std::memory_order_relaxed);
+    }
+    
+    HPVClockRef HPVPlayer::getClock()
+    {
+        std::lock_guard<std::mutex> lock(_clock_mtx);
+        
+        return _clock;
+    }
+    
+    HPVLatenessPolicy HPVPlayer::getLatenessPolicy()
+    {
+        return _lateness_policy.load(std::memory_order_relaxed);
+    }
+    
+    HPVThreadingModel HPVPlayer::getThreadingModel()
+    {
+        return _threading_model;
+    }
+    
     std::string HPVPlayer::getFilename()
     {
         if (isLoaded())
@@ -865,7 +2793,7 @@ namespace HPV {
         }
     }
     
-    uint8_t HPVPlayer::getID()
+    HPVHandle HPVPlayer::getID()
     {
         return _id;
     }
@@ -882,7 +2810,7 @@ namespace HPV {
     
     float HPVPlayer::getSpeed()
     {
-        return static_cast<float>(_global_time_per_frame / static_cast<float>(_local_time_per_frame));
+        return static_cast<float>(_global_time_per_frame / _local_time_per_frame);
     }
     
     bool HPVPlayer::hasNewFrame()
@@ -905,6 +2833,70 @@ namespace HPV {
         return HPV_RET_ERROR_NONE;
     }
     
+    /*
+     *  Checks every frame against its CRC32C before it's decompressed, for files of version 10 and up. A frame
+     *  that doesn't match isn't shown, it's logged, counted in getNumCorruptFrames() and posted as an
+     *  HPV_EVENT_CORRUPT_FRAME event.
+     */
+    int HPVPlayer::setVerifyFrames(bool verify)
+    {
+        _verify_frames.store(verify, std::memory_order_relaxed);
+        
+        if (verify && _is_init && !_index.hasChecksums())
+        {
+            HPV_VERBOSE("%s (version %u) has no frame checksums to verify", _file_name.c_str(), _header.version);
+        }
+        
+        return HPV_RET_ERROR_NONE;
+    }
+    
+    bool HPVPlayer::hasFrameChecksums()
+    {
+        return _index.hasChecksums();
+    }
+    
+    uint64_t HPVPlayer::getNumCorruptFrames()
+    {
+        return _num_corrupt_frames.load(std::memory_order_relaxed);
+    }
+    
+    /*
+     *  Called by the render bridge after it uploaded a frame of this player to the GPU
+     */
+    void HPVPlayer::recordUploadTime(uint64_t upload_time)
+    {
+        _gpu_upload_time.store(upload_time, std::memory_order_relaxed);
+        _latency_stats.upload.record(upload_time);
+    }
+    
+    /*
+     *  Copy of the most recent read, decode and upload time, safe to call from any thread
+     */
+    HPVDecodeStats HPVPlayer::getDecodeStats()
+    {
+        HPVDecodeStats stats;
+        stats.hdd_read_time = _hdd_read_time.load(std::memory_order_relaxed);
+        stats.l4z_decode_time = _l4z_decode_time.load(std::memory_order_relaxed);
+        stats.gpu_upload_time = _gpu_upload_time.load(std::memory_order_relaxed);
+        
+        return stats;
+    }
+    
+    /*
+     *  Copy of the read, decode, upload and lateness histograms, safe to call from any thread
+     */
+    HPVLatencySnapshot HPVPlayer::getLatencySnapshot()
+    {
+        return _latency_stats.snapshot();
+    }
+    
+    void HPVPlayer::resetLatencyStats()
+    {
+        _latency_stats.reset();
+        _scheduler.resetCounters();
+        _num_skipped_frames.store(0, std::memory_order_relaxed);
+    }
+    
     std::string HPVPlayer::getFileSummary()
     {
         if (_is_init)
@@ -923,6 +2915,12 @@ namespace HPV {
                 << HPVCompressionTypeStrings[(uint8_t)_header.compression_type]
                 << " | version: "
                 << _header.version
+                << " | slices: "
+                << _num_slices
+                << " | tiles: "
+                << _tile_columns << "x" << _tile_rows
+                << " | index: "
+                << (_index.isLazy() ? "lazy" : "eager")
                 << " ] ";
             
             return ss.str();
@@ -933,6 +2931,15 @@ namespace HPV {
         }
     }
     
+    /*
+     *  Every frame this player decodes from now on, with its read and decode time, is pushed to 'sink'
+     *  (when stats are enabled). nullptr stops it. For benchmarks and tools that want every sample.
+     */
+    void HPVPlayer::setFrameTimingSink(ThreadSafe_Queue<HPVFrameTiming> * sink)
+    {
+        _m_timing_sink.store(sink, std::memory_order_release);
+    }
+    
     void HPVPlayer::addHPVEventSink(ThreadSafe_Queue<HPVEvent> * sink)
     {
         _m_event_sink = sink;
@@ -19,10 +19,19 @@
 #include <cmath>
 #include <memory>
 #include <algorithm>
+#include <functional>
 
 #include "Log.h"
 #include "HPVHeader.h"
 #include "HPVEvent.h"
+#include "HPVFileReader.h"
+#include "HPVDecodePool.h"
+#include "HPVTiles.h"
+#include "HPVHistogram.h"
+#include "HPVFrameIndex.h"
+#include "HPVFrameCache.h"
+#include "HPVClock.h"
+#include "HPVFrameScheduler.h"
 #include "ThreadSafeQueue.h"
 #include "Timer.h"
 
@@ -44,6 +53,18 @@
 
 #define HPV_SPEED_EPSILON           0.05
 
+#define HPV_DEFAULT_FRAME_RING_SIZE 3       /* One slot being shown + two frames decoded ahead of the playhead */
+#define HPV_MAX_FRAME_RING_SIZE     16
+#define HPV_READ_AHEAD_BYTES        (32 << 20)  /* the reader is asked to fetch this much beyond the ring, in the direction of playback */
+#define HPV_MAX_READ_AHEAD_FRAMES   64
+#define HPV_NUM_STAGED_FRAMES       2       /* grouped players: decoded frames the group may present, the newest first */
+
+#define HPV_INVALID_HANDLE          0xFFFFFFFF
+#define HPV_HANDLE_INDEX_BITS       16
+#define HPV_HANDLE_INDEX_MASK       0xFFFF
+
+#define HPV_STEP_WHEN_WOKEN         UINT64_MAX  /* step() result of an idle player: step again after the next wake() */
+
 /* --------------------------------------------------------------------------------- */
 namespace HPV {
     
@@ -64,6 +85,15 @@ namespace HPV {
 #endif
     }
     
+    /* 32-bit player handle: slot in the HPVManager's player slab (low bits) + generation of that slab (high bits) */
+    typedef uint32_t HPVHandle;
+    
+    inline uint32_t HPVHandleIndex(HPVHandle handle)
+    {
+        return handle & HPV_HANDLE_INDEX_MASK;
+    }
+    
+    /* Most recent sample of every latency (ns), see HPVPlayer::getLatencySnapshot() for the distributions */
     typedef struct
     {
         uint64_t hdd_read_time;
@@ -71,12 +101,67 @@ namespace HPV {
         uint64_t gpu_upload_time;
     } HPVDecodeStats;
     
+    /* Read and decode time (ns) of one decoded frame, see HPVPlayer::setFrameTimingSink() */
+    typedef struct
+    {
+        HPVHandle player;
+        int64_t frame;
+        uint64_t read_time;
+        uint64_t decode_time;
+    } HPVFrameTiming;
+    
+    /* What free-running playback does when it has fallen behind its schedule, see HPVPlayer::setLatenessPolicy() */
+    enum class HPVLatenessPolicy : std::uint8_t
+    {
+        HPV_LATENESS_DECODE_ALL = 0,    /* show every frame, late, until playback has caught up */
+        HPV_LATENESS_SKIP,              /* jump to the frame that is due now */
+        HPV_LATENESS_SKIP_KEEP_WARM     /* jump, but keep the skipped frames in the frame cache or at least read them ahead */
+    };
+    
+    /* A seek handed out by HPVPlayer::seekAsync(): the tickets of a player count up from 1, 0 is a seek that was refused */
+    typedef uint64_t HPVSeekTicket;
+    
+    enum class HPVSeekResult : std::uint8_t
+    {
+        HPV_SEEK_DONE = 0,      /* the frame is presented */
+        HPV_SEEK_DROPPED,       /* a newer seek came in before the frame was presented */
+        HPV_SEEK_FAILED         /* the frame couldn't be read */
+    };
+    
+    /* Called once per ticket, from the player's thread or, for a seek dropped while still waiting, from the thread of the newer seek */
+    typedef std::function<void(HPVSeekTicket ticket, int64_t frame, HPVSeekResult result)> HPVSeekCallback;
+    
+    /* A frame of a grouped player that is decoded and waits for its group to present it, see HPVPlayerGroup */
+    typedef struct
+    {
+        int64_t frame;
+        int slot;
+    } HPVStagedFrame;
+    
+    /* The presented frame as the renderer got it from HPVPlayer::acquireFrame(), its data stays as it is until releaseFrame() */
+    typedef struct
+    {
+        const unsigned char * buffer;       /* getBytesPerFrame() bytes, nullptr when there is no frame */
+        int64_t frame;
+    } HPVAcquiredFrame;
+    
+    class HPVPlayerGroup;
+    
+    /* One slot of the decode-ahead ring: a decompressed frame and the frame number it holds */
+    typedef struct
+    {
+        unsigned char* buffer;
+        int64_t frame;
+        uint64_t tiles;         /* tiled files: the tiles of 'frame' decoded into the buffer */
+    } HPVFrameSlot;
+    
     class HPVPlayer
     {
     public:
         HPVPlayer();
         ~HPVPlayer();
-        int             open(const std::string& filepath);
+        int             open(const std::string& filepath, HPVReadMode read_mode = HPVReadMode::HPV_READ_STREAM,
+                             HPVIndexMode index_mode = HPVIndexMode::HPV_INDEX_AUTO);
         int             play();
         int             play(int fps);
         int             pause();
@@ -91,21 +176,54 @@ namespace HPV {
         int             setSpeed(double speed);
         int             seek(double pos, bool sync = true);
         int             seek(int64_t frame, bool sync = true);
+        HPVSeekTicket   seekAsync(double pos, HPVSeekCallback callback = nullptr);
+        HPVSeekTicket   seekAsync(int64_t frame, HPVSeekCallback callback = nullptr);
+        bool            isSeekDone(HPVSeekTicket ticket);
+        int             setFrameRingSize(uint8_t num_slots);
+        int             setFrameCacheSize(std::size_t num_bytes);
+        int             setVisibleTiles(uint64_t tiles, bool prefetch_neighbours = true);
+        int             setClock(HPVClockRef clock);
+        int             setLatenessPolicy(HPVLatenessPolicy policy);
         
         int             getWidth();
         int             getHeight();
         std::size_t     getBytesPerFrame();
         unsigned char*  getBufferPtr();
+        HPVAcquiredFrame acquireFrame();
+        void            releaseFrame();
+        int             decodePixels(unsigned char* rgba);
         int64_t         getCurrentFrameNumber();
         uint64_t        getNumberOfFrames();
+        uint8_t         getFrameRingSize();
+        std::size_t     getFrameCacheSize();
+        std::size_t     getNumCachedFrames();
+        uint64_t        getNumFrameCacheHits();
+        uint64_t        getNumFrameCacheMisses();
+        uint64_t        getNumDecodeAllocations();
+        uint64_t        getNumPresentedFrames();
+        uint64_t        getNumDroppedSeeks();
+        uint64_t        getNumLateFrames();
+        uint64_t        getNumDroppedFrames();
+        uint64_t        getNumRepeatedFrames();
+        uint64_t        getNumSkippedFrames();
+        uint64_t        getCPUTime();
+        uint64_t        getNumBytesRead();
+        bool            isTiled();
+        uint32_t        getTileColumns();
+        uint32_t        getTileRows();
+        uint64_t        getVisibleTiles();
+        HPVClockRef     getClock();
+        HPVLatenessPolicy getLatenessPolicy();
         std::string     getFilename();
-        uint8_t         getID();
+        HPVHandle       getID();
         
         void            addHPVEventSink(ThreadSafe_Queue<HPVEvent> * sink);
+        void            setFrameTimingSink(ThreadSafe_Queue<HPVFrameTiming> * sink);
         void            notifyHPVEvent(HPVEventType type);
         
         void            launchUpdateThread();
         void            update();
+        uint64_t        step();
         bool            hasNewFrame();
         void            resetPlayer();
         
@@ -118,59 +236,162 @@ namespace HPV {
         int64_t         getLoopOut();
         
         std::string     getFilePath();
+        HPVReadMode     getReadMode();
+        HPVThreadingModel getThreadingModel();
         
         int             isLoaded();
         int             isPlaying();
         int             isPaused();
         int             isStopped();
         
-        uint8_t         _id;
+        HPVHandle       _id;
         bool            _gather_stats;
-        HPVDecodeStats  _decode_stats;
         int             enableStats(bool get_stats);
+        HPVDecodeStats  getDecodeStats();
+        int             setVerifyFrames(bool verify);
+        bool            hasFrameChecksums();
+        uint64_t        getNumCorruptFrames();
+        void            recordUploadTime(uint64_t upload_time);
+        HPVLatencySnapshot getLatencySnapshot();
+        void            resetLatencyStats();
         
         std::string     getFileSummary();
         
     private:
-
+        friend class HPVPlayerGroup;
        
-        std::ifstream   _ifs;
+        std::unique_ptr<HPVFileReader> _reader;
+        HPVReadMode     _read_mode;
+        int             _advised_direction;
+        uint32_t        _read_ahead_frames;
+        int64_t         _read_ahead_end;        /* last frame of the read-ahead window, -1 when there is none */
         std::string     _file_path;
         std::string     _file_name;
         uint32_t        _num_bytes_in_header;
-        uint32_t        _num_bytes_in_sizes_table;
+        uint32_t        _frame_alignment;
+        uint32_t        _num_slices;
+        uint32_t        _tile_columns;
+        uint32_t        _tile_rows;
+        uint32_t        _num_tiles;
+        unsigned char * _tile_buffer;
+        std::size_t     _tile_buffer_stride;
+        std::atomic<uint64_t> _visible_tiles;
+        std::atomic<uint64_t> _decode_tiles;
         size_t          _filesize;
-        uint32_t *      _frame_sizes_table;
-        uint64_t *      _frame_offsets_table;
-        unsigned char*  _frame_buffer;
+        HPVFrameIndex   _index;
+        HPVFrameCache   _frame_cache;
+        std::atomic<bool> _verify_frames;
+        std::atomic<uint64_t> _num_corrupt_frames;
+        char *          _l4z_buffer;
+        std::size_t     _l4z_buffer_size;
+        uint32_t        _l4z_num_segments;
+        std::atomic<uint64_t> _num_decode_allocations;
+        std::atomic<uint64_t> _num_presented_frames;
+        std::atomic<uint64_t> _cpu_time;
+        std::atomic<uint64_t> _num_bytes_read;
+        std::vector<HPVFrameSlot> _frame_ring;
+        uint8_t         _frame_ring_size;
+        std::atomic<int> _presented_slot;
+        std::atomic<int> _acquired_slot;        /* read by the renderer, -1 when none: never written while acquired */
         size_t          _bytes_per_frame;
         uint64_t        _new_frame_time;
-        uint64_t        _global_time_per_frame;
-        uint64_t        _local_time_per_frame;
-        int64_t         _curr_frame;
-        int64_t         _curr_buffered_frame;
+        double          _global_time_per_frame; /* ns, not rounded so the schedule doesn't drift */
+        std::atomic<double> _local_time_per_frame;     /* set by setSpeed() while the stepping thread reads it */
+        HPVFrameScheduler _scheduler;           /* free-running playback, only touched by the stepping thread */
+        std::atomic<bool> _speed_changed;       /* _local_time_per_frame changed, the schedule has to follow */
+        std::atomic<HPVLatenessPolicy> _lateness_policy;
+        std::atomic<uint64_t> _num_skipped_frames;
+        std::atomic<int64_t> _curr_frame;       /* only written by the stepping thread, read by any */
+        std::atomic<int64_t> _curr_buffered_frame;  /* frame on screen, getCurrentFrameNumber() */
         int64_t         _seeked_frame;
-        int64_t         _loop_in;
-        int64_t         _loop_out;
-        uint8_t         _loop_mode;
-        int             _state;
-        int             _direction;
+        std::atomic<int64_t> _loop_in;          /* set by the control setters while the stepping thread reads them */
+        std::atomic<int64_t> _loop_out;
+        std::atomic<uint8_t> _loop_mode;
+        std::atomic<int> _state;
+        std::atomic<int> _direction;            /* set by the control setters, turned around by palindrome loops */
         bool            _is_init;
-        volatile bool   _should_update;
+        std::atomic<bool> _should_update;      /* cleared by close() to end the thread of HPV_THREADS_PER_PLAYER */
+        HPVThreadingModel _threading_model;
+        std::mutex      _wake_mtx;
+        std::condition_variable _wake_signal;
+        bool            _wake_requested;
         std::atomic<int> _update_result;
         std::atomic<int> _seek_result;
         std::atomic<bool> _was_seeked;
+        HPVSeekTicket   _last_seek_ticket;      /* handed out last, guarded by _mtx as are the next three */
+        HPVSeekTicket   _pending_seek;          /* waiting for the stepping thread, 0 when there is none */
+        HPVSeekCallback _seek_callback;         /* of _pending_seek */
+        HPVSeekTicket   _seek_result_ticket;    /* the seek _seek_result belongs to */
+        std::atomic<HPVSeekTicket> _finished_seek;  /* every ticket up to this one is done, dropped or failed; only grows, written under _mtx */
+        std::atomic<uint64_t> _num_dropped_seeks;
+        bool            _seeking;               /* the stepping thread decodes the target of a seek */
         std::thread     _update_thread;
         std::mutex      _mtx;
         std::condition_variable _seeked_signal;
+        HPVLatencyStats _latency_stats;
+        std::atomic<uint64_t> _hdd_read_time;   /* most recent samples, see getDecodeStats() */
+        std::atomic<uint64_t> _l4z_decode_time;
+        std::atomic<uint64_t> _gpu_upload_time;
+        HPVClockRef     _clock;
+        std::mutex      _clock_mtx;             /* guards _clock */
+        std::atomic<bool> _clock_changed;       /* set, or playback (re)started: the stepping thread has to lock on again */
+        
+        // clock following, only touched by the stepping thread
+        HPVClockRef     _step_clock;
+        bool            _clock_locked;
+        double          _clock_time;            /* smoothed media time at _clock_sample_time */
+        double          _clock_rate;
+        uint64_t        _clock_sample_time;
+        int64_t         _clock_frame;           /* frame of _clock_time before wrapping to the file */
+        
+        // grouped players present what their group says, see HPVPlayerGroup
+        std::atomic<bool> _grouped;
+        std::mutex      _slot_mtx;              /* guards _staged, and the group presenting one of them */
+        HPVStagedFrame  _staged[HPV_NUM_STAGED_FRAMES];
 
         HPVHeader       _header;
         
-        void            populateFrameOffsets(uint32_t);
+        void            freeFileBuffers();
         int             readCurrentFrame();
-        int             seekSync();
+        void            cachePresentedFrame();
+        int             stageCurrentFrame();
+        bool            isStaged(int slot_idx);
+        void            clearStaged();
+        int             findStaged(int64_t frame);
+        void            presentSlot(int slot_idx);
+        int             decodeFrame(int64_t frame, unsigned char* dst);
+        int             decompressFrame(const char* l4z_data, uint32_t l4z_size, int64_t frame, unsigned char* dst, uint64_t read_time);
+        void            recordFrameTiming(int64_t frame, uint64_t read_time, uint64_t decode_time);
+        bool            verifyFrame(const char* l4z_data, int64_t frame);
+        void            reportCorruptFrame(int64_t frame);
+        void            parallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+        unsigned        getNumParallelThreads();
+        int             decompressSlices(const char* l4z_data, int64_t frame, unsigned char* dst);
+        int             decodeTiles(int64_t frame, unsigned char* dst, uint64_t tiles);
+        int             fillSlot(int slot_idx, int64_t frame);
+        uint64_t        missingTiles(int slot_idx);
+        int             findSlot(int64_t frame);
+        int             findFreeSlot();
+        int             writableSlot(int slot_idx);
+        int64_t         predictFrame(uint32_t steps);
+        bool            prefetchNextFrame();
+        bool            prefetchBatch();
+        void            adviseReader();
+        void            readAhead();
+        char *          getScratchBuffer(std::size_t size, uint32_t segment = 0);
+        int64_t         seekFrame(double pos);
+        HPVSeekTicket   requestSeek(int64_t frame, HPVSeekCallback callback);
+        int             seekSync(HPVSeekTicket ticket);
+        bool            seekAbandoned();
+        void            wake();
+        uint64_t        runStep();
+        bool            stepFrame();
+        void            keepWarm(int64_t frame);
+        uint64_t        followClock(uint64_t now);
+        int64_t         clockFrame(int64_t frame);
         
         ThreadSafe_Queue<HPVEvent> * _m_event_sink;
+        std::atomic<ThreadSafe_Queue<HPVFrameTiming> *> _m_timing_sink;
     };
     
     typedef std::shared_ptr<HPV::HPVPlayer> HPVPlayerRef;
@@ -0,0 +1,237 @@
+#include <algorithm>
+
+#include "HPVPlayerGroup.h"
+
+namespace HPV {
+
+    HPVPlayerGroup::HPVPlayerGroup()
+    : _own_clock(std::make_shared<HPVSystemClock>(0.0, 0.0))
+    , _presented_frame(-1)
+    , _num_presented_frames(0)
+    , _num_held_updates(0)
+    {
+        _clock = _own_clock;
+    }
+
+    HPVPlayerGroup::~HPVPlayerGroup()
+    {
+        clear();
+    }
+
+    /*
+     *  From now on the player follows the group's clock and only shows what the group presents
+     */
+    int HPVPlayerGroup::add(HPVPlayerRef player)
+    {
+        if (!player || !player->isLoaded())
+        {
+            HPV_ERROR("Only loaded players can be added to a group");
+            return HPV_RET_ERROR;
+        }
+
+        if (std::find(_players.begin(), _players.end(), player) != _players.end())
+        {
+            return HPV_RET_ERROR;
+        }
+
+        if (!_players.empty() && _players[0]->getFrameRate() != player->getFrameRate())
+        {
+            HPV_ERROR("'%s' plays at %d fps, the group at %d fps", player->getFilename().c_str(), player->getFrameRate(), _players[0]->getFrameRate());
+            return HPV_RET_ERROR;
+        }
+
+        player->clearStaged();
+        player->_grouped.store(true, std::memory_order_release);
+        player->setClock(_clock);
+
+        _players.push_back(player);
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    int HPVPlayerGroup::remove(HPVPlayerRef player)
+    {
+        std::vector<HPVPlayerRef>::iterator it = std::find(_players.begin(), _players.end(), player);
+
+        if (it == _players.end())
+        {
+            return HPV_RET_ERROR;
+        }
+
+        player->_grouped.store(false, std::memory_order_release);
+        player->clearStaged();
+        player->setClock(nullptr);
+
+        _players.erase(it);
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    void HPVPlayerGroup::clear()
+    {
+        while (!_players.empty())
+        {
+            remove(_players.back());
+        }
+
+        _presented_frame = -1;
+    }
+
+    int HPVPlayerGroup::setClock(HPVClockRef clock)
+    {
+        _clock = clock ? clock : HPVClockRef(_own_clock);
+
+        for (HPVPlayerRef& player : _players)
+        {
+            player->setClock(_clock);
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    HPVClockRef HPVPlayerGroup::getClock()
+    {
+        return _clock;
+    }
+
+    /*
+     *  Starts the players that aren't playing yet and, when the group runs on its own clock, that clock
+     */
+    int HPVPlayerGroup::play()
+    {
+        for (HPVPlayerRef& player : _players)
+        {
+            if (player->isPaused())
+            {
+                player->resume();
+            }
+            else if (!player->isPlaying())
+            {
+                player->play();
+            }
+        }
+
+        if (_clock == _own_clock)
+        {
+            _own_clock->setRate(1.0);
+        }
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    /*
+     *  Stops the group's own clock: the players keep their thread awake but all hold the same frame
+     */
+    int HPVPlayerGroup::pause()
+    {
+        if (_clock != _own_clock)
+        {
+            HPV_VERBOSE("A group that follows an external clock pauses with that clock");
+            return HPV_RET_ERROR;
+        }
+
+        _own_clock->setRate(0.0);
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    int HPVPlayerGroup::seek(int64_t frame)
+    {
+        if (_clock != _own_clock || _players.empty())
+        {
+            return HPV_RET_ERROR;
+        }
+
+        // the middle of the frame, so the players don't disagree about which side of a boundary it is
+        _own_clock->setTime((frame + 0.5) / _players[0]->getFrameRate());
+
+        return HPV_RET_ERROR_NONE;
+    }
+
+    /*
+     *  Presents the newest frame that all players have staged on all of them, or leaves every player on the
+     *  frame it shows. Runs on the thread of HPVManager::update(), right before the renderer takes new frames.
+     */
+    void HPVPlayerGroup::update()
+    {
+        if (_players.empty())
+        {
+            return;
+        }
+
+        for (HPVPlayerRef& player : _players)
+        {
+            if (!player->isLoaded())
+            {
+                return;
+            }
+        }
+
+        // always in the same order, the player threads only ever take their own
+        for (HPVPlayerRef& player : _players)
+        {
+            player->_slot_mtx.lock();
+        }
+
+        int64_t frame = findCommonFrame();
+
+        if (frame >= 0)
+        {
+            if (frame != _presented_frame)
+            {
+                for (HPVPlayerRef& player : _players)
+                {
+                    player->presentSlot(player->findStaged(frame));
+                }
+
+                _presented_frame = frame;
+                ++_num_presented_frames;
+            }
+        }
+        else if (_players[0]->_staged[0].frame >= 0)
+        {
+            ++_num_held_updates;
+        }
+
+        for (HPVPlayerRef& player : _players)
+        {
+            player->_slot_mtx.unlock();
+        }
+    }
+
+    /*
+     *  The newest staged frame of one of the players that all others have staged too, -1 when there is none.
+     *  A player that is a frame behind still has the frame the others staged before their newest.
+     */
+    int64_t HPVPlayerGroup::findCommonFrame()
+    {
+        for (HPVPlayerRef& candidate : _players)
+        {
+            int64_t frame = candidate->_staged[0].frame;
+
+            if (frame < 0)
+            {
+                continue;
+            }
+
+            bool everywhere = true;
+
+            for (HPVPlayerRef& player : _players)
+            {
+                if (player->findStaged(frame) < 0)
+                {
+                    everywhere = false;
+                    break;
+                }
+            }
+
+            if (everywhere)
+            {
+                return frame;
+            }
+        }
+
+        return -1;
+    }
+
+} /* End HPV namespace */
@@ -0,0 +1,68 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+#include "HPVPlayer.h"
+#include "HPVClock.h"
+
+namespace HPV {
+
+    /*
+     *  HPVPlayerGroup: players that show the same frame number at the same moment, e.g. the parts of a video
+     *  wall. All players follow one clock, so the player threads (or the decode pool) decode frame N of every
+     *  player against the same deadline. A decoded frame isn't shown right away but staged: update(), called
+     *  by HPVManager::update() before the renderer looks for new frames, presents frame N on all players at
+     *  once as soon as every player has staged it, and keeps the previous frame on all of them until then.
+     *
+     *  The group's own clock is an HPVSystemClock that play(), pause() and seek() act on; setClock() replaces it,
+     *  e.g. by an audio clock. The players have to be loaded and of the same frame rate, their frame rings need
+     *  room for the frame on screen and HPV_NUM_STAGED_FRAMES staged frames. Don't seek or pause a player of a
+     *  group on its own. Call everything from the thread that runs HPVManager::update().
+     */
+    class HPVPlayerGroup
+    {
+    public:
+        HPVPlayerGroup();
+        ~HPVPlayerGroup();
+
+        int                 add(HPVPlayerRef player);
+        int                 remove(HPVPlayerRef player);
+        void                clear();
+        std::size_t         getNumPlayers() { return _players.size(); }
+
+        int                 setClock(HPVClockRef clock);    /* nullptr: back to the group's own clock */
+        HPVClockRef         getClock();
+
+        int                 play();
+        int                 pause();
+        int                 seek(int64_t frame);            /* own clock only */
+
+        void                update();
+        int64_t             getPresentedFrame() { return _presented_frame; }
+        uint64_t            getNumPresentedFrames() { return _num_presented_frames; }
+        uint64_t            getNumHeldUpdates() { return _num_held_updates; }
+
+    private:
+        int64_t             findCommonFrame();
+
+        std::vector<HPVPlayerRef> _players;
+        std::shared_ptr<HPVSystemClock> _own_clock;
+        HPVClockRef         _clock;
+        int64_t             _presented_frame;
+        uint64_t            _num_presented_frames;
+        uint64_t            _num_held_updates;          /* updates on which the players had staged different frames */
+    };
+
+    typedef std::shared_ptr<HPV::HPVPlayerGroup> HPVPlayerGroupRef;
+
+} /* End HPV namespace */
@@ -80,22 +80,56 @@ namespace HPV {
         setRenderer(HPVRendererType::RENDERER_NONE);
     }
 
-    int HPVRenderBridge::initPlayer(uint8_t node_id)
+    /*
+     *  Render data lives in a slab indexed like the players of the HPVManager
+     */
+    HPVRenderData * HPVRenderBridge::getRenderData(HPVHandle handle)
     {
-        m_render_data.insert(std::pair<uint8_t, HPVRenderData>(node_id, HPVRenderData()));
+        uint32_t slot = HPVHandleIndex(handle);
+        
+        if (HPV_INVALID_HANDLE == handle || slot >= m_render_data.size() || !m_render_data[slot].allocated)
+        {
+            return nullptr;
+        }
+        
+        return &m_render_data[slot];
+    }
+
+    int HPVRenderBridge::initPlayer(HPVHandle handle)
+    {
+        if (HPV_INVALID_HANDLE == handle)
+        {
+            return HPV_RET_ERROR;
+        }
+        
+        uint32_t slot = HPVHandleIndex(handle);
+        
+        if (slot >= m_render_data.size())
+        {
+            m_render_data.resize(slot + 1);
+        }
+        
+        if (!m_render_data[slot].allocated)
+        {
+            m_render_data[slot] = HPVRenderData();
+            m_render_data[slot].allocated = true;
+        }
+        
         return HPV_RET_ERROR_NONE;
     }
 
-    int HPVRenderBridge::createGPUResources(uint8_t node_id)
+    int HPVRenderBridge::createGPUResources(HPVHandle handle)
     {
-        if (m_render_data.find(node_id) == m_render_data.end())
+        HPVRenderData * render_data = getRenderData(handle);
+        
+        if (!render_data)
         {
-            HPV_ERROR("Can't create resources, player %d was not allocated!", node_id);
+            HPV_ERROR("Can't create resources, player %u was not allocated!", HPVHandleIndex(handle));
             return HPV_RET_ERROR;
         }
 
-        HPVRenderData& data = m_render_data.at(node_id);
-        data.player = ManagerSingleton()->getPlayer(node_id);
+        HPVRenderData& data = *render_data;
+        data.player = ManagerSingleton()->getPlayer(handle);
         data.stats.after_upload = 0;
         data.stats.before_upload = 0;
         data.gpu_resources_need_init = true;
@@ -145,7 +179,7 @@ namespace HPV {
 
             data.gpu_resources_need_init = false;
             
-            this->setRenderState(node_id, HPVRenderState::STATE_BLIT);
+            this->setRenderState(handle, HPVRenderState::STATE_BLIT);
 
             ReportGLError();
 
@@ -155,24 +189,26 @@ namespace HPV {
         return HPV_RET_ERROR_NONE;
     }
 
-    int HPVRenderBridge::nodeHasResources(uint8_t node_id)
+    int HPVRenderBridge::nodeHasResources(HPVHandle handle)
     {
-        return static_cast<int>(!m_render_data[node_id].gpu_resources_need_init);
+        HPVRenderData * render_data = getRenderData(handle);
+        
+        return static_cast<int>(render_data && !render_data->gpu_resources_need_init);
     }
 
     int HPVRenderBridge::deleteGPUResources()
     {
         for (auto& data : m_render_data)
         {
-            if (data.second.gpu_resources_need_init)
+            if (!data.allocated || data.gpu_resources_need_init)
             {
                 continue;
             }
 
             if (HPVRendererType::RENDERER_OPENGLCORE == m_renderer)
             {
-                glDeleteTextures(1, &data.second.opengl.tex);
-                glDeleteBuffers(2, &data.second.opengl.pboIds[0]);
+                glDeleteTextures(1, &data.opengl.tex);
+                glDeleteBuffers(2, &data.opengl.pboIds[0]);
             }
         }
 
@@ -183,18 +219,22 @@ namespace HPV {
         return HPV_RET_ERROR_NONE;
     }
 
-    intptr_t HPVRenderBridge::getTexturePtr(uint8_t node_id)
+    intptr_t HPVRenderBridge::getTexturePtr(HPVHandle handle)
     {
-        if (HPVRendererType::RENDERER_OPENGLCORE == m_renderer)
+        HPVRenderData * render_data = getRenderData(handle);
+        
+        if (render_data && HPVRendererType::RENDERER_OPENGLCORE == m_renderer)
         {
-            return m_render_data[node_id].opengl.tex;
+            return render_data->opengl.tex;
         }
         else return 0;
     }
     
-    GLenum HPVRenderBridge::getGLInternalFormat(uint8_t node_id)
+    GLenum HPVRenderBridge::getGLInternalFormat(HPVHandle handle)
     {
-        return (m_render_data[node_id].opengl.gl_format);
+        HPVRenderData * render_data = getRenderData(handle);
+        
+        return (render_data ? render_data->opengl.gl_format : 0);
     }
 
     HPVRendererType HPVRenderBridge::getRenderer()
@@ -211,15 +251,20 @@ namespace HPV {
         
         HPV_VERBOSE("HPV::Buffering...");
         
+        // the player keeps decoding into other slots while the frame is copied
+        HPVAcquiredFrame frame = data->player->acquireFrame();
+        
         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, data->opengl.pboIds[BACK]);
-        glBufferData(GL_PIXEL_UNPACK_BUFFER, data->player->getBytesPerFrame(), data->player->getBufferPtr(), GL_STREAM_DRAW);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, data->player->getBytesPerFrame(), frame.buffer, GL_STREAM_DRAW);
+        
+        data->player->releaseFrame();
         
         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, data->opengl.pboIds[FRONT]);
         glBufferData(GL_PIXEL_UNPACK_BUFFER, data->player->getBytesPerFrame(), 0, GL_STREAM_DRAW);
 
         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
         
-        data->cpu_framenum = data->player->getCurrentFrameNumber();
+        data->cpu_framenum = frame.frame;
         data->opengl.tex_fill_index = FRONT;
         data->render_state = HPVRenderState::STATE_STREAM;
         data->render_func = m_render_funcs[(uint8_t)data->render_state];
@@ -258,8 +303,15 @@ namespace HPV {
         
         if (ptr)
         {
-            data->cpu_framenum = data->player->getCurrentFrameNumber();
-            memcpy(ptr, data->player->getBufferPtr(), data->player->getBytesPerFrame());
+            HPVAcquiredFrame frame = data->player->acquireFrame();
+            
+            if (frame.buffer)
+            {
+                data->cpu_framenum = frame.frame;
+                memcpy(ptr, frame.buffer, data->player->getBytesPerFrame());
+            }
+            
+            data->player->releaseFrame();
             glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
         }
         
@@ -273,15 +325,23 @@ namespace HPV {
             return;
         }
         
-        glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, data->player->getWidth(), data->player->getHeight(), data->opengl.gl_format, static_cast<GLsizei>(data->player->getBytesPerFrame()), data->player->getBufferPtr());
+        HPVAcquiredFrame frame = data->player->acquireFrame();
         
-        data->cpu_framenum = data->player->getCurrentFrameNumber();
-        data->gpu_framenum = data->cpu_framenum;
+        if (frame.buffer)
+        {
+            // from client memory, GL has read the data by the time this returns
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, data->player->getWidth(), data->player->getHeight(), data->opengl.gl_format, static_cast<GLsizei>(data->player->getBytesPerFrame()), frame.buffer);
+            
+            data->cpu_framenum = frame.frame;
+            data->gpu_framenum = data->cpu_framenum;
+        }
+        
+        data->player->releaseFrame();
     }
     
-    void HPVRenderBridge::setRenderState(uint8_t node_idx, HPVRenderState state)
+    void HPVRenderBridge::setRenderState(HPVHandle handle, HPVRenderState state)
     {
-        if (!m_render_data.count(node_idx))
+        if (!getRenderData(handle))
         {
             return;
         }
@@ -290,7 +350,7 @@ namespace HPV {
             return;
         }
         
-        HPVRenderData& render_data = m_render_data[node_idx];
+        HPVRenderData& render_data = *getRenderData(handle);
         
         switch (state) {
             case HPVRenderState::STATE_BUFFER:
@@ -320,17 +380,26 @@ namespace HPV {
 
     void HPVRenderBridge::updateTextures()
     {
-        std::vector<bool> update_flags = ManagerSingleton()->update();
+        const std::vector<uint64_t>& dirty_bits = ManagerSingleton()->update();
 
-        for (uint8_t player_idx = 0; player_idx < update_flags.size(); ++player_idx)
+        /* Only visit the players that have a new frame, straight from the bitset */
+        for (std::size_t word_idx = 0; word_idx < dirty_bits.size(); ++word_idx)
         {
-            if (update_flags[player_idx])
+            uint64_t word = dirty_bits[word_idx];
+            
+            while (word)
             {
+                uint32_t slot = static_cast<uint32_t>(word_idx * 64 + CountTrailingZeros(word));
+                word &= word - 1;
+                
+                if (slot >= m_render_data.size() || !m_render_data[slot].allocated)
+                    continue;
+                
                 /* Get specifics for this player */
-                HPVRenderData& render_data = m_render_data[player_idx];
+                HPVRenderData& render_data = m_render_data[slot];
 
                 if (render_data.gpu_resources_need_init)
-                    return;
+                    continue;
 
                 if (HPVRendererType::RENDERER_OPENGLCORE == m_renderer)
                 {
@@ -349,23 +418,20 @@ namespace HPV {
                     if (render_data.player->_gather_stats)
                     {
                         render_data.stats.after_upload = ns();
-                        render_data.player->_decode_stats.gpu_upload_time = render_data.stats.after_upload - render_data.stats.before_upload;
+                        render_data.player->recordUploadTime(render_data.stats.after_upload - render_data.stats.before_upload);
                     }
                 }
-                
-                if (render_data.player->isStopped() && render_data.gpu_framenum != render_data.player->getCurrentFrameNumber())
-                {
-                    update_flags[player_idx] = true;
-                }
             }
         }
     }
     
-    uint32_t HPVRenderBridge::getCPUFrameForNode(uint8_t node_idx)
+    uint32_t HPVRenderBridge::getCPUFrameForNode(HPVHandle handle)
     {
-        if (m_render_data.count(node_idx))
+        HPVRenderData * render_data = getRenderData(handle);
+        
+        if (render_data)
         {
-            return m_render_data[node_idx].cpu_framenum;
+            return render_data->cpu_framenum;
         }
         else
         {
@@ -373,11 +439,13 @@ namespace HPV {
         }
     }
     
-    uint32_t HPVRenderBridge::getGPUFrameForNode(uint8_t node_idx)
+    uint32_t HPVRenderBridge::getGPUFrameForNode(HPVHandle handle)
     {
-        if (m_render_data.count(node_idx))
+        HPVRenderData * render_data = getRenderData(handle);
+        
+        if (render_data)
         {
-            return m_render_data[node_idx].gpu_framenum;
+            return render_data->gpu_framenum;
         }
         else
         {
@@ -385,21 +453,25 @@ namespace HPV {
         }
     }
     
-    HPVRenderState HPVRenderBridge::getRenderState(uint8_t node_idx)
+    HPVRenderState HPVRenderBridge::getRenderState(HPVHandle handle)
     {
-        if (m_render_data.count(node_idx))
+        HPVRenderData * render_data = getRenderData(handle);
+        
+        if (render_data)
         {
-            return m_render_data[node_idx].render_state;
+            return render_data->render_state;
         }
         
         return HPVRenderState::NUM_RENDER_STATES;
     }
     
-    bool HPVRenderBridge::needsBuffering(uint8_t node_idx)
+    bool HPVRenderBridge::needsBuffering(HPVHandle handle)
     {
-        if (m_render_data.count(node_idx))
+        HPVRenderData * render_data = getRenderData(handle);
+        
+        if (render_data)
         {
-            return m_render_data[node_idx].needs_buffer;
+            return render_data->needs_buffer;
         }
         else
         {
@@ -92,6 +92,7 @@ namespace HPV {
         /* Abstract Render Statistics */
         HPVRenderStats stats;
         
+        bool allocated;
         bool gpu_resources_need_init;
         bool needs_buffer;
         uint32_t cpu_framenum;
@@ -99,6 +100,7 @@ namespace HPV {
 
         HPVRenderData()
         {
+            allocated = false;
             gpu_resources_need_init = true;
             cpu_framenum = 0;
             gpu_framenum = 0;
@@ -119,20 +121,20 @@ namespace HPV {
         void load();
         void unload();
 
-        int initPlayer(uint8_t node_id);
+        int initPlayer(HPVHandle handle);
         void setRenderer(HPVRendererType renderer);
         HPVRendererType getRenderer();
 
-        int createGPUResources(uint8_t node_id);
+        int createGPUResources(HPVHandle handle);
         int deleteGPUResources();
-        int nodeHasResources(uint8_t node_id);
-        intptr_t getTexturePtr(uint8_t node_id);
+        int nodeHasResources(HPVHandle handle);
+        intptr_t getTexturePtr(HPVHandle handle);
         
-        GLenum getGLInternalFormat(uint8_t node_id);
+        GLenum getGLInternalFormat(HPVHandle handle);
 
         void updateTextures();
-        uint32_t getCPUFrameForNode(uint8_t);
-        uint32_t getGPUFrameForNode(uint8_t);
+        uint32_t getCPUFrameForNode(HPVHandle handle);
+        uint32_t getGPUFrameForNode(HPVHandle handle);
 
         bool s3tc_supported;
         bool pbo_supported;
@@ -141,16 +143,18 @@ namespace HPV {
         void stream_func(HPVRenderData * const);
         void blit_func(HPVRenderData * const);
         
-        HPVRenderState getRenderState(uint8_t node_idx);
-        void setRenderState(uint8_t node_idx, HPVRenderState state);
+        HPVRenderState getRenderState(HPVHandle handle);
+        void setRenderState(HPVHandle handle, HPVRenderState state);
         
-        bool needsBuffering(uint8_t node_idx);
+        bool needsBuffering(HPVHandle handle);
                 
     private:
+        HPVRenderData * getRenderData(HPVHandle handle);
+        
         HPVRendererType m_renderer;
         HPVRenderFunc m_render_func;
         HPVRenderFunc m_render_funcs[(uint8_t)HPVRenderState::NUM_RENDER_STATES];
-        std::map<uint8_t, HPVRenderData> m_render_data;
+        std::vector<HPVRenderData> m_render_data;
 
         bool b_needs_buffer;
     };
@@ -0,0 +1,82 @@
+#include <cmath>
+#include <algorithm>
+
+#include "HPVTiles.h"
+
+namespace HPV {
+
+    uint64_t NeighbourTiles(uint64_t tiles, uint32_t tile_columns, uint32_t tile_rows)
+    {
+        uint64_t neighbours = 0;
+        
+        for (uint32_t row = 0; row < tile_rows; ++row)
+        {
+            for (uint32_t column = 0; column < tile_columns; ++column)
+            {
+                if (!(tiles & TileBit(column, row, tile_columns)))
+                {
+                    continue;
+                }
+                
+                uint32_t first_row = (row > 0) ? row - 1 : row;
+                uint32_t last_row = (row + 1 < tile_rows) ? row + 1 : row;
+                
+                for (uint32_t n_row = first_row; n_row <= last_row; ++n_row)
+                {
+                    neighbours |= TileBit((column + tile_columns - 1) % tile_columns, n_row, tile_columns);
+                    neighbours |= TileBit(column, n_row, tile_columns);
+                    neighbours |= TileBit((column + 1) % tile_columns, n_row, tile_columns);
+                }
+            }
+        }
+        
+        return neighbours & ~tiles;
+    }
+    
+    uint64_t EquirectVisibleTiles(uint32_t tile_columns, uint32_t tile_rows, float yaw, float pitch, float h_fov, float v_fov)
+    {
+        // sample the view on a grid that is finer than any tile, so every tile the view touches gets hit
+        const int num_samples = 32;
+        const double pi = 3.14159265358979323846;
+        const double to_rad = pi / 180.0;
+        
+        double tan_h = std::tan(0.5 * h_fov * to_rad);
+        double tan_v = std::tan(0.5 * v_fov * to_rad);
+        double cos_yaw = std::cos(yaw * to_rad);
+        double sin_yaw = std::sin(yaw * to_rad);
+        double cos_pitch = std::cos(pitch * to_rad);
+        double sin_pitch = std::sin(pitch * to_rad);
+        
+        uint64_t tiles = 0;
+        
+        for (int j = 0; j <= num_samples; ++j)
+        {
+            for (int i = 0; i <= num_samples; ++i)
+            {
+                // ray through the view plane at z = 1, pitched around x, then turned around y
+                double x = (2.0 * i / num_samples - 1.0) * tan_h;
+                double y = (2.0 * j / num_samples - 1.0) * tan_v;
+                
+                double y_p = y * cos_pitch + sin_pitch;
+                double z_p = cos_pitch - y * sin_pitch;
+                
+                double x_w = x * cos_yaw + z_p * sin_yaw;
+                double z_w = z_p * cos_yaw - x * sin_yaw;
+                
+                double longitude = std::atan2(x_w, z_w);
+                double latitude = std::atan2(y_p, std::sqrt(x_w * x_w + z_w * z_w));
+                
+                double u = longitude / (2.0 * pi) + 0.5;
+                double v = 0.5 - latitude / pi;
+                
+                uint32_t column = std::min(static_cast<uint32_t>(u * tile_columns), tile_columns - 1);
+                uint32_t row = std::min(static_cast<uint32_t>(v * tile_rows), tile_rows - 1);
+                
+                tiles |= TileBit(column, row, tile_columns);
+            }
+        }
+        
+        return tiles;
+    }
+    
+} /* End HPV namespace */
@@ -0,0 +1,41 @@
+/**********************************************************
+* Holo_ToolSet
+* http://github.com/HasseltVR/Holo_ToolSet
+* http://www.uhasselt.be/edm
+*
+* Distributed under LGPL v2.1 Licence
+* http ://www.gnu.org/licenses/old-licenses/lgpl-2.1.html
+**********************************************************/
+#pragma once
+
+#include <stdint.h>
+
+#include "HPVHeader.h"
+
+/*
+ *  Helpers for the tile sets of tiled HPV files (HPV_VERSION_0_0_9). A tile set is a uint64_t with
+ *  bit (row * tile_columns + column) set for every tile in it, see HPVPlayer::setVisibleTiles().
+ */
+namespace HPV {
+
+    inline uint64_t TileBit(uint32_t column, uint32_t row, uint32_t tile_columns)
+    {
+        return uint64_t(1) << (row * tile_columns + column);
+    }
+    
+    /* The set of all tiles of a grid */
+    inline uint64_t AllTiles(uint32_t tile_columns, uint32_t tile_rows)
+    {
+        uint32_t num_tiles = tile_columns * tile_rows;
+        return (num_tiles >= HPV_MAX_TILES) ? ~uint64_t(0) : ((uint64_t(1) << num_tiles) - 1);
+    }
+    
+    /* The tiles bordering on the set, diagonals included. Columns wrap around: the left and right edge
+     * of an equirectangular frame meet. */
+    uint64_t NeighbourTiles(uint64_t tiles, uint32_t tile_columns, uint32_t tile_rows);
+    
+    /* The tiles of an equirectangular frame seen by a view looking at 'yaw' degrees (0 = center of the frame,
+     * positive = to the right) and 'pitch' degrees (positive = up), with the given field of view in degrees */
+    uint64_t EquirectVisibleTiles(uint32_t tile_columns, uint32_t tile_rows, float yaw, float pitch, float h_fov, float v_fov);
+    
+} /* End HPV namespace */
@@ -13,12 +13,14 @@
 #include <mutex>
 #include <condition_variable>
 #include <vector>
-#include <queue>
 
 /*
  * ThreadSafe Queue: allows for threadsafe adding elements to a FIFO queue. It also allows for multiple
  * threads to process items for the queue without having race conditions. 
  *
+ * The items are kept in a ring that only grows when it is full, so a queue that is drained regularly
+ * stops allocating: players push events and frame timings into these from their decode threads.
+ *
  * Based on "C++ Concurrency in Action" by Anthony Williams ISBN: 978-1-933988-77-1
  */
 template<typename T>
@@ -26,77 +28,114 @@ class ThreadSafe_Queue
 {
 private:
     mutable std::mutex mtx;
-    std::queue<T> data_queue;
+    std::vector<T> ring;
+    std::size_t head = 0;       /* index of the oldest item */
+    std::size_t count = 0;
     std::condition_variable data_cond;
     
+    /* Doubles the ring, oldest item first; called with the lock held. The new slots are filled with 'fill'. */
+    void grow(const T& fill)
+    {
+        std::vector<T> bigger;
+        bigger.reserve(ring.empty() ? 16 : ring.size() * 2);
+        
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            bigger.push_back(ring[(head + i) % ring.size()]);
+        }
+        
+        bigger.resize(bigger.capacity(), fill);
+        ring.swap(bigger);
+        head = 0;
+    }
+    
+    /* Called with the lock held and at least one item queued */
+    void pop_front(T& value)
+    {
+        value = ring[head];
+        head = (head + 1) % ring.size();
+        --count;
+    }
+    
 public:
     ThreadSafe_Queue() {}
     ThreadSafe_Queue(ThreadSafe_Queue const& other)
     {
         std::lock_guard<std::mutex> lock(other.mtx);
-        data_queue=other.data_queue;
+        ring = other.ring;
+        head = other.head;
+        count = other.count;
     }
     
     void push(T new_value)
     {
         std::lock_guard<std::mutex> lock(mtx);
-        data_queue.push(new_value);
+        
+        if (count == ring.size())
+        {
+            grow(new_value);
+        }
+        
+        ring[(head + count) % ring.size()] = new_value;
+        ++count;
         data_cond.notify_one();
     }
     
     void wait_and_pop(T& value)
     {
         std::unique_lock<std::mutex> lock(mtx);
-        data_cond.wait(lock,[this]{return !data_queue.empty();});
-        value=data_queue.front();
-        data_queue.pop();
+        data_cond.wait(lock,[this]{return count > 0;});
+        pop_front(value);
     }
     
     std::shared_ptr<T> wait_and_pop()
     {
         std::unique_lock<std::mutex> lock(mtx);
-        data_cond.wait(lock,[this]{return !data_queue.empty();});
-        std::shared_ptr<T> res(std::make_shared<T>(data_queue.front()));
-        data_queue.pop();
+        data_cond.wait(lock,[this]{return count > 0;});
+        std::shared_ptr<T> res(std::make_shared<T>(ring[head]));
+        head = (head + 1) % ring.size();
+        --count;
         return res;
     }
     
     bool try_pop(T& value)
     {
         std::lock_guard<std::mutex> lock(mtx);
-        if(data_queue.empty())
+        if(0 == count)
             return false;
-        value=data_queue.front();
-        data_queue.pop();
+        pop_front(value);
         return true;
     }
     
     std::shared_ptr<T> try_pop()
     {
         std::lock_guard<std::mutex> lock(mtx);
-        if(data_queue.empty())
+        if(0 == count)
             return std::shared_ptr<T>();
-        std::shared_ptr<T> res(std::make_shared<T>(data_queue.front()));
-        data_queue.pop();
+        std::shared_ptr<T> res(std::make_shared<T>(ring[head]));
+        head = (head + 1) % ring.size();
+        --count;
         return res;
     }
     
     bool empty() const
     {
         std::lock_guard<std::mutex> lock(mtx);
-        return data_queue.empty();
+        return 0 == count;
     }
     
     std::size_t size()
     {
         std::lock_guard<std::mutex> lock(mtx);
-        return data_queue.size();
+        return count;
     }
 
+    /* Drops the items and frees the ring */
     void clear()
     {
         std::lock_guard<std::mutex> lock(mtx);
-        std::queue<T> empty;
-        std::swap(data_queue, empty);
+        std::vector<T>().swap(ring);
+        head = 0;
+        count = 0;
     }
 };
\ No newline at end of file
@@ -23,6 +23,7 @@
 #elif defined(__APPLE__)
 #  define HAVE_MACH_TIMER
 #  include <mach/mach_time.h>
+#  include <time.h>
 #elif defined(_WIN32)
 #  define WIN32_LEAN_AND_MEAN
 #  include <windows.h>
@@ -63,3 +64,22 @@ inline uint64_t ns() {
     return (uint64_t) ((1e9 * now.QuadPart)  / win_frequency.QuadPart);
 #endif
 }
+
+/* CPU time (user + system) used so far by the calling thread, in ns */
+inline uint64_t thread_cpu_ns() {
+#if defined(_WIN32)
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) {
+        return 0;
+    }
+    uint64_t kernel = ((uint64_t)kernel_time.dwHighDateTime << 32) | kernel_time.dwLowDateTime;
+    uint64_t user = ((uint64_t)user_time.dwHighDateTime << 32) | user_time.dwLowDateTime;
+    return (kernel + user) * 100;
+#else
+    struct timespec spec;
+    if (0 != clock_gettime(CLOCK_THREAD_CPUTIME_ID, &spec)) {
+        return 0;
+    }
+    return (uint64_t)spec.tv_sec * 1000000000ull + spec.tv_nsec;
+#endif
+}
@@ -24,6 +24,7 @@ static const GLchar* vert_CT_CoCg_Y = R"(
     }
 )";
 
+// ConvertCoCgYToRGBA() in HPVDXT.cpp is the CPU version of this shader, keep the two in sync
 static const GLchar* frag_CT_CoCg_Y = R"(
     #version 410
 
@@ -62,16 +63,24 @@ ofxHPVPlayer::~ofxHPVPlayer()
 void ofxHPVPlayer::init(HPVPlayerRef internal_hpv_player)
 {
     m_hpv_player = internal_hpv_player;
+    
+    if (!m_hpv_player)
+    {
+        HPV_ERROR("No HPV player to init, the maximum of %u players was reached", HPV::MAX_NUMBER_OF_PLAYERS);
+        return;
+    }
+    
     RendererSingleton()->initPlayer(m_hpv_player->getID());
 }
 
 ////////////////////////////////////////////////////////////////////////
 // HPV specific functions
 ////////////////////////////////////////////////////////////////////////
-// Opens the video file
-bool ofxHPVPlayer::load(string name)
+// Opens the video file, optionally memory-mapped (HPVReadMode::HPV_READ_MMAP). Long files get a lazy index
+// (HPVIndexMode::HPV_INDEX_LAZY) that opens in constant time.
+bool ofxHPVPlayer::load(string name, HPVReadMode read_mode, HPVIndexMode index_mode)
 {
-    int ret = m_hpv_player->open(ofToDataPath(name, true).c_str());
+    int ret = m_hpv_player->open(ofToDataPath(name, true).c_str(), read_mode, index_mode);
 
     if (ret == HPV_RET_ERROR_NONE)
     {
@@ -108,9 +117,9 @@ bool ofxHPVPlayer::load(string name)
     return ret;
 }
 
-bool ofxHPVPlayer::loadAsync(string name)
+bool ofxHPVPlayer::loadAsync(string name, HPVReadMode read_mode, HPVIndexMode index_mode)
 {
-    return this->load(name);
+    return this->load(name, read_mode, index_mode);
 }
 
 void ofxHPVPlayer::play()
@@ -355,6 +364,17 @@ void ofxHPVPlayer::seekToFrame(int64_t frame, bool sync)
     m_hpv_player->seek(frame, sync);
 }
 
+// seek without waiting, a newer seek replaces this one if it isn't shown yet
+HPVSeekTicket ofxHPVPlayer::seekToPosAsync(double pos, HPVSeekCallback callback)
+{
+    return m_hpv_player->seekAsync(pos, callback);
+}
+
+HPVSeekTicket ofxHPVPlayer::seekToFrameAsync(int64_t frame, HPVSeekCallback callback)
+{
+    return m_hpv_player->seekAsync(frame, callback);
+}
+
 bool ofxHPVPlayer::needsDoubleBuffering() const
 {
     return RendererSingleton()->needsBuffering(m_hpv_player->getID());
@@ -372,10 +392,109 @@ void ofxHPVPlayer::setDoubleBuffered(bool bDoubleBuffer)
     }
 }
 
-// get pointer to stats struct report
+// set the amount of frames decoded ahead of the playhead (+1 for the frame on screen), call before load()
+void ofxHPVPlayer::setFrameRingSize(int num_slots)
+{
+    m_hpv_player->setFrameRingSize(static_cast<uint8_t>(HPV::clamp<int>(num_slots, 1, HPV_MAX_FRAME_RING_SIZE)));
+}
+
+// keep recently shown frames for scrubbing, 0 turns the cache off
+void ofxHPVPlayer::setFrameCacheSize(std::size_t num_bytes)
+{
+    m_hpv_player->setFrameCacheSize(num_bytes);
+}
+
+// follow a clock instead of the frame rate, no need to seek every update
+void ofxHPVPlayer::setClock(HPVClockRef clock)
+{
+    m_hpv_player->setClock(clock);
+}
+
+// skip frames to get back on schedule instead of running late
+void ofxHPVPlayer::setLatenessPolicy(HPVLatenessPolicy policy)
+{
+    m_hpv_player->setLatenessPolicy(policy);
+}
+
+uint64_t ofxHPVPlayer::getNumSkippedFrames() const
+{
+    return m_hpv_player->getNumSkippedFrames();
+}
+
+uint64_t ofxHPVPlayer::getNumFrameCacheHits() const
+{
+    return m_hpv_player->getNumFrameCacheHits();
+}
+
+uint64_t ofxHPVPlayer::getNumFrameCacheMisses() const
+{
+    return m_hpv_player->getNumFrameCacheMisses();
+}
+
+bool ofxHPVPlayer::isTiled() const
+{
+    return m_hpv_player->isTiled();
+}
+
+void ofxHPVPlayer::setVisibleTiles(uint64_t tiles, bool prefetch_neighbours)
+{
+    m_hpv_player->setVisibleTiles(tiles, prefetch_neighbours);
+}
+
+void ofxHPVPlayer::setViewDirection(float yaw, float pitch, float h_fov, float v_fov)
+{
+    if (m_hpv_player->isTiled())
+    {
+        uint32_t columns = m_hpv_player->getTileColumns();
+        uint32_t rows = m_hpv_player->getTileRows();
+        
+        m_hpv_player->setVisibleTiles(HPV::EquirectVisibleTiles(columns, rows, yaw, pitch, h_fov, v_fov));
+    }
+}
+
+// most recent read, decode and upload time, in ns
+HPVDecodeStats ofxHPVPlayer::getDecodeStats() const
+{
+    return m_hpv_player->getDecodeStats();
+}
+
+// get pointer to stats struct report, a copy taken by this call
 HPVDecodeStats * ofxHPVPlayer::getDecodeStatsPtr() const
 {
-    return &m_hpv_player->_decode_stats;
+    m_decode_stats = m_hpv_player->getDecodeStats();
+    return &m_decode_stats;
+}
+
+// read, decode, upload and lateness histograms, e.g. getLatencySnapshot().decode.percentile(99) in ns
+HPVLatencySnapshot ofxHPVPlayer::getLatencySnapshot() const
+{
+    return m_hpv_player->getLatencySnapshot();
+}
+
+// frames shown after their slot, never shown, and frame periods without a new frame
+uint64_t ofxHPVPlayer::getNumLateFrames() const
+{
+    return m_hpv_player->getNumLateFrames();
+}
+
+uint64_t ofxHPVPlayer::getNumDroppedFrames() const
+{
+    return m_hpv_player->getNumDroppedFrames();
+}
+
+uint64_t ofxHPVPlayer::getNumRepeatedFrames() const
+{
+    return m_hpv_player->getNumRepeatedFrames();
+}
+
+void ofxHPVPlayer::setVerifyFrames(bool verify)
+{
+    m_hpv_player->setVerifyFrames(verify);
+}
+
+uint64_t ofxHPVPlayer::getNumCorruptFrames() const
+{
+    return m_hpv_player->getNumCorruptFrames();
 }
 
 std::string ofxHPVPlayer::getFileSummary()
@@ -388,6 +507,48 @@ ofPixelFormat ofxHPVPlayer::getPixelFormat() const
     return OF_PIXELS_RGBA;
 }
 
+ofPixels& ofxHPVPlayer::getPixels()
+{
+    return const_cast<ofPixels&>(static_cast<const ofxHPVPlayer *>(this)->getPixels());
+}
+
+const ofPixels& ofxHPVPlayer::getPixels() const
+{
+    if (!m_hpv_player || !m_hpv_player->isLoaded())
+    {
+        return m_pixels;
+    }
+    
+    uint64_t presented = m_hpv_player->getNumPresentedFrames();
+    int64_t frame = m_hpv_player->getCurrentFrameNumber();
+    int width = m_hpv_player->getWidth();
+    int height = m_hpv_player->getHeight();
+    
+    bool same_size = m_pixels.isAllocated() && static_cast<int>(m_pixels.getWidth()) == width && static_cast<int>(m_pixels.getHeight()) == height;
+    
+    if (same_size && presented == m_pixels_presented && frame == m_pixels_frame)
+    {
+        return m_pixels;
+    }
+    
+    if (!same_size)
+    {
+        m_pixels.allocate(width, height, OF_PIXELS_RGBA);
+    }
+    
+    if (m_hpv_player->decodePixels(m_pixels.getData()))
+    {
+        m_pixels_presented = presented;
+        m_pixels_frame = frame;
+    }
+    else
+    {
+        HPV_ERROR("Couldn't decode frame %" PRId64 " to pixels", frame);
+    }
+    
+    return m_pixels;
+}
+
 void ofxHPVPlayer::draw(float x, float y, float width, float height)
 {
     if (m_texture.isAllocated())
@@ -21,9 +21,10 @@ public:
     ~ofxHPVPlayer();
     
     void init(HPVPlayerRef internal_hpv_player);
+    HPVPlayerRef getHPVPlayer() const { return m_hpv_player; }
 
-    bool                load(string name);
-    bool                loadAsync(string name);
+    bool                load(string name, HPVReadMode read_mode = HPVReadMode::HPV_READ_STREAM, HPVIndexMode index_mode = HPVIndexMode::HPV_INDEX_AUTO);
+    bool                loadAsync(string name, HPVReadMode read_mode = HPVReadMode::HPV_READ_STREAM, HPVIndexMode index_mode = HPVIndexMode::HPV_INDEX_AUTO);
     
     void                play();
     void                stop();
@@ -53,11 +54,10 @@ public:
     
     bool                needsDoubleBuffering() const;
     
-    /* 
-     * NOT SUPPORTED, HPV is purely GPU oriented!
-     * ofPixels&           getPixels();
-     * const ofPixels&     getPixels() const;
-     */
+    /* The current frame decoded to RGBA on the CPU, only when it changed since the last call. For headless
+     * use and pixel readback: drawing should go through the texture, which gets the DXT blocks as they are. */
+    ofPixels&           getPixels();
+    const ofPixels&     getPixels() const;
     
     bool                isPaused() const;
     bool                isLoaded() const;
@@ -75,15 +75,46 @@ public:
     void                setPlayDirection(bool direction);
     void                seekToPos(double pos, bool sync = true);
     void                seekToFrame(int64_t frame, bool sync = true);
+    /* Return right away, only the newest of several seeks in a row is decoded. 'callback' runs on the player's thread. */
+    HPVSeekTicket       seekToPosAsync(double pos, HPVSeekCallback callback = nullptr);
+    HPVSeekTicket       seekToFrameAsync(int64_t frame, HPVSeekCallback callback = nullptr);
     
     void                setDoubleBuffered(bool bDoubleBuffer);
+    void                setFrameRingSize(int num_slots);
+    
+    /* Recently shown frames are kept up to this many bytes, so scrubbing back to them skips the disk and LZ4 */
+    void                setFrameCacheSize(std::size_t num_bytes);
+    uint64_t            getNumFrameCacheHits() const;
+    uint64_t            getNumFrameCacheMisses() const;
+    
+    /* Show the frame at the time of a clock (audio position, timecode, ...) while playing, followed by the
+     * player's own thread. nullptr plays at the frame rate of the file again. */
+    void                setClock(HPVClockRef clock);
+    
+    /* Behind schedule: show every frame late (default), or skip to the frame that is due now */
+    void                setLatenessPolicy(HPVLatenessPolicy policy);
+    uint64_t            getNumSkippedFrames() const;
+    
+    /* Tiled (equirectangular) files: only decode what a view in this direction sees, angles in degrees */
+    bool                isTiled() const;
+    void                setVisibleTiles(uint64_t tiles, bool prefetch_neighbours = true);
+    void                setViewDirection(float yaw, float pitch, float h_fov, float v_fov);
      
     void                firstFrame();
     void                nextFrame();
     void                previousFrame();
     void                lastFrame();
    
+    HPVDecodeStats      getDecodeStats() const;
     HPVDecodeStats *    getDecodeStatsPtr() const;
+    HPVLatencySnapshot  getLatencySnapshot() const;
+    uint64_t            getNumLateFrames() const;
+    uint64_t            getNumDroppedFrames() const;
+    uint64_t            getNumRepeatedFrames() const;
+    
+    /* Version 10 files: check every frame against its CRC32C before decoding it */
+    void                setVerifyFrames(bool verify);
+    uint64_t            getNumCorruptFrames() const;
     
     std::string         getFileSummary();
     
@@ -94,4 +125,9 @@ private:
     ofShader            m_shader;
     ofTexture           m_texture;
     HPVPlayerRef        m_hpv_player;
+    
+    mutable HPVDecodeStats m_decode_stats;           /* what getDecodeStatsPtr() points to */
+    mutable ofPixels    m_pixels;
+    mutable uint64_t    m_pixels_presented = 0;     /* presented frame count and frame number of m_pixels */
+    mutable int64_t     m_pixels_frame = -1;
 };